@@ -12,6 +12,8 @@ static constexpr int MAX_IO{1000};
 
 #include <array>
 #include <memory>
+#include <stdexcept>
+#include <vector>
 /**the co-simulation functions need an array of the derivative order, which for the primary function
 calls will be all identical, so there was no need to have to reconstruct this every time so this
 function just builds a common case to handle a large majority of cases without any additional
@@ -39,17 +41,35 @@ fmi2CoSimObject::fmi2CoSimObject(const std::string& fmuname,
 {
 }
 
-void fmi2CoSimObject::setInputDerivatives(int /*order*/, const fmi2Real /*dIdt*/[])
+void fmi2CoSimObject::setInputDerivatives(int order, const fmi2Real dIdt[])
 {
-    /*auto ret = CoSimFunctions->fmi2SetRealInputDerivatives(comp,
-                                                           activeInputs.getValueRef(),
-                                                           activeInputs.getVRcount(),
-                                                           derivOrder[order].data(),
-                                                           dIdt);
+    FmiVariableSet vrset;
+    vrset.reserve(activeInputs.size());
+    for (const auto& input : activeInputs) {
+        vrset.push(input.vRef);
+    }
+    setInputDerivatives(vrset, order, dIdt);
+}
+
+void fmi2CoSimObject::setInputDerivatives(const FmiVariableSet& vrset,
+                                          int order,
+                                          const fmi2Real dIdt[])
+{
+    if (order < 1 || order > MAX_DERIV_ORDER) {
+        throw(std::invalid_argument("invalid input derivative order"));
+    }
+    const auto count = vrset.getVRcount();
+    std::vector<fmi2Integer> orders;
+    const fmi2Integer* orderData = derivOrder[order].data();
+    if (count > MAX_IO) {
+        orders.assign(count, order);
+        orderData = orders.data();
+    }
+    auto ret = CoSimFunctions->fmi2SetRealInputDerivatives(
+        comp, vrset.getValueRef(), count, orderData, dIdt);
     if (ret != fmi2Status::fmi2OK) {
         handleNonOKReturnValues(ret);
     }
-    */
 }
 void fmi2CoSimObject::getOutputDerivatives(int /*order*/, fmi2Real /*dOdt*/[]) const
 {
@@ -214,6 +214,14 @@ bool fmi2Object::setFlag(const std::string& param, bool val)
         noFree = val;
         return true;
     }
+    if (param == "local_outputs") {
+        localOutputs = val;
+        return true;
+    }
+    if (param == "default_local_outputs") {
+        defaultLocalOutputs = val;
+        return true;
+    }
     const auto& ref = info->getVariableInfo(param);
     fmi2Status ret{fmi2Status::fmi2Discard};
     switch (ref.type._value) {
@@ -247,6 +255,18 @@ void fmi2Object::setFMUState(fmi2FMUstate FMUstate)
     }
 }
 
+void fmi2Object::freeFMUState(fmi2FMUstate* FMUstate)
+{
+    if (FMUstate == nullptr || *FMUstate == nullptr) {
+        return;
+    }
+    auto ret = commonFunctions->fmi2FreeFMUstate(comp, FMUstate);
+    if (ret != fmi2Status::fmi2OK) {
+        handleNonOKReturnValues(ret);
+    }
+    *FMUstate = nullptr;
+}
+
 size_t fmi2Object::serializedStateSize(fmi2FMUstate FMUstate)
 {
     size_t size;
@@ -305,12 +325,12 @@ static bool isInput(const VariableInformation& vInfo)
     return ((vInfo.index >= 0) && (vInfo.causality._value == fmi_causality::input));
 }
 
-/** check if an output is real and actually is an output*/
-static bool isOutput(const VariableInformation& vInfo)
+/** check if a variable is an output or a local variable if locals are allowed*/
+static bool isOutput(const VariableInformation& vInfo, bool allowLocal)
 {
     return ((vInfo.index >= 0) &&
             (fmi_causality::output == vInfo.causality._value ||
-             fmi_causality::local == vInfo.causality._value));
+             (allowLocal && fmi_causality::local == vInfo.causality._value)));
 }
 
 /** check if an output is real and actually is an output*/
@@ -322,13 +342,6 @@ static bool isOutput(const VariableInformation& vInfo)
 }
 */
 
-/** check if an input is real and actually is an input*/
-static bool isRealInput(const VariableInformation& vInfo)
-{
-    return ((vInfo.index >= 0) && (vInfo.type._value == fmi_variable_type::real) &&
-            (vInfo.causality._value == fmi_causality::input));
-}
-
 void fmi2Object::setOutputVariables(const std::vector<std::string>& outNames)
 {
     if (outNames.size() == 1) {
@@ -380,7 +393,7 @@ static const FmiVariable emptyVariable{static_cast<fmi2ValueReference>(-1),
 const FmiVariable& fmi2Object::addOutputVariable(const std::string& outputName)
 {
     const auto& vInfo = info->getVariableInfo(outputName);
-    if (isOutput(vInfo)) {
+    if (isOutput(vInfo, localOutputs)) {
         return activeOutputs.emplace_back(vInfo.valueRef, vInfo.type, vInfo.index);
     }
     return emptyVariable;
@@ -388,7 +401,7 @@ const FmiVariable& fmi2Object::addOutputVariable(const std::string& outputName)
 const FmiVariable& fmi2Object::addOutputVariable(int index)
 {
     const auto& vInfo = info->getVariableInfo(index);
-    if (isOutput(vInfo)) {
+    if (isOutput(vInfo, localOutputs)) {
         return activeOutputs.emplace_back(vInfo.valueRef, vInfo.type, vInfo.index);
     }
     return emptyVariable;
@@ -404,7 +417,7 @@ const FmiVariable& fmi2Object::addInputVariable(const std::string& inputName)
 const FmiVariable& fmi2Object::addInputVariable(int index)
 {
     const auto& vInfo = info->getVariableInfo(index);
-    if (isRealInput(vInfo)) {
+    if (isInput(vInfo)) {
         return activeInputs.emplace_back(vInfo.valueRef, vInfo.type, vInfo.index);
     }
     return emptyVariable;
@@ -417,7 +430,17 @@ void fmi2Object::setDefaultInputs()
 
 void fmi2Object::setDefaultOutputs()
 {
-    setOutputVariables(info->getVariableNames("output"));
+    setOutputVariables(getDefaultOutputNames());
+}
+
+std::vector<std::string> fmi2Object::getDefaultOutputNames() const
+{
+    auto names = info->getVariableNames("output");
+    if (localOutputs && defaultLocalOutputs) {
+        auto locals = info->getVariableNames("local");
+        names.insert(names.end(), locals.begin(), locals.end());
+    }
+    return names;
 }
 
 FmiVariableSet fmi2Object::getVariableSet(const std::string& variable) const
@@ -439,11 +462,21 @@ const FmiVariable& fmi2Object::getOutput(int index) const
     return activeOutputs.at(index);
 }
 
+std::vector<std::string> fmi2Object::getAvailableOutputNames() const
+{
+    auto names = info->getVariableNames("output");
+    if (localOutputs) {
+        auto locals = info->getVariableNames("local");
+        names.insert(names.end(), locals.begin(), locals.end());
+    }
+    return names;
+}
+
 std::vector<std::string> fmi2Object::getOutputNames() const
 {
     std::vector<std::string> oVec;
     if (activeOutputs.empty()) {
-        oVec = info->getVariableNames("output");
+        oVec = getDefaultOutputNames();
     } else {
         oVec.reserve(activeOutputs.size());
         for (const auto& output : activeOutputs) {
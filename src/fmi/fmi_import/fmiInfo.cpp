@@ -275,6 +275,24 @@ const std::vector<std::pair<index_t, int>>& FmiInfo::getDerivDependencies(int va
 {
     return derivDep.getSet(variableIndex);
 }
+
+bool FmiInfo::hasDeclaredOutputDependencies(int variableIndex) const
+{
+    return (variableIndex >= 0 && variableIndex < static_cast<int>(outputDepDeclared.size())) ?
+        outputDepDeclared[variableIndex] :
+        false;
+}
+
+units::precise_unit FmiInfo::getUnit(const std::string& unitName) const
+{
+    for (const auto& unitDef : units) {
+        if (unitDef.name == unitName) {
+            return unitDef.unitValue;
+        }
+    }
+    return units::unit_from_string(unitName);
+}
+
 const std::vector<std::pair<index_t, int>>& FmiInfo::getOutputDependencies(int variableIndex) const
 {
     return outputDep.getSet(variableIndex);
@@ -300,6 +318,10 @@ void FmiInfo::loadFmiHeader(std::shared_ptr<readerElement>& reader)
     if (versionFind != headerInfo.end()) {
         fmiVersion = std::stod(versionFind->second);
     }
+    auto eventFind = headerInfo.find("numberofeventindicators");
+    if (eventFind != headerInfo.end()) {
+        eventIndicators = std::stoi(eventFind->second);
+    }
     if (reader->hasElement("ModelExchange")) {
         capabilities.set(modelExchangeCapable, true);
         reader->moveToFirstChild("ModelExchange");
@@ -387,8 +409,7 @@ static void loadUnitInfo(std::shared_ptr<readerElement>& reader, FmiUnit& unitIn
                                                                        {"mol", units::precise::mol},
                                                                        {"rad", units::precise::rad},
                                                                        {"cd", units::precise::cd},
-                                                                       {"K",
-                                                                        units::precise::candela},
+                                                                       {"K", units::precise::K},
                                                                        {"A", units::precise::A}};
     unitInfo.name = reader->getAttributeText("name");
     if (reader->hasElement("BaseUnit")) {
@@ -419,7 +440,7 @@ static void loadUnitInfo(std::shared_ptr<readerElement>& reader, FmiUnit& unitIn
         }
         reader->moveToParent();
     }
-    [[maybe_unused]] auto def = units::unit_from_string(unitInfo.name);
+    auto def = units::unit_from_string(unitInfo.name);
     units::precise_unit build = units::precise::one;
     for (const auto& udef : unitInfo.baseUnits) {
         auto fnd = baseUnitMap.find(udef.name);
@@ -428,6 +449,12 @@ static void loadUnitInfo(std::shared_ptr<readerElement>& reader, FmiUnit& unitIn
         }
     }
     build = units::precise_unit(unitInfo.factor, build);
+    // the named unit is preferred since it can capture offsets such as degC
+    if (units::is_valid(def) && (unitInfo.baseUnits.empty() || def.has_same_base(build))) {
+        unitInfo.unitValue = def;
+    } else {
+        unitInfo.unitValue = build;
+    }
 }
 
 static void loadTypeInfo(std::shared_ptr<readerElement>& reader, FmiTypeDefinition& typeInfo);
@@ -502,7 +529,7 @@ static void loadTypeInfo(std::shared_ptr<readerElement>& reader, FmiTypeDefiniti
                 typeInfo.max = att.getValue();
 
             } else if (att.getName() == "nominal") {
-                typeInfo.unit = att.getValue();
+                typeInfo.nominal = att.getValue();
 
             } else if (att.getName() == "unbounded") {
                 typeInfo.unbounded = att.getValue() != 0;
@@ -571,6 +598,8 @@ void FmiInfo::loadVariables(std::shared_ptr<readerElement>& reader)
         reader->moveToNextSibling(ScalarVString);
     }
     variables.resize(vcount);
+    // room for the names and their lower case aliases
+    variableLookup.reserve(2 * static_cast<std::size_t>(vcount));
     reader->moveToParent();
     // now load the variables
     reader->moveToFirstChild(ScalarVString);
@@ -578,6 +607,15 @@ void FmiInfo::loadVariables(std::shared_ptr<readerElement>& reader)
     while (reader->isValid()) {
         loadVariableInfo(reader, variables[index]);
         variables[index].index = index;
+        if (variables[index].unit.empty() && !variables[index].declType.empty()) {
+            // the unit can be inherited from the type definition
+            for (const auto& tdef : types) {
+                if (tdef.name == variables[index].declType) {
+                    variables[index].unit = tdef.unit;
+                    break;
+                }
+            }
+        }
         auto res = variableLookup.emplace(variables[index].name, index);
         if (!res.second) {  // if we failed on the emplace operation, then we need to override
             // this should be unusual but it is possible
@@ -642,6 +680,8 @@ static void loadVariableInfo(std::shared_ptr<readerElement>& reader, VariableInf
                 vInfo.min = att.getValue();
             } else if (att.getName() == "max") {
                 vInfo.max = att.getValue();
+            } else if (att.getName() == "nominal") {
+                vInfo.nominal = att.getValue();
             }
             att = reader->getNextAttribute();
         }
@@ -737,7 +777,8 @@ static const std::string depKindString("dependenciesKind");
 
 static void loadDependencies(std::shared_ptr<readerElement>& reader,
                              std::vector<int>& store,
-                             matrixData<int>& depData)
+                             matrixData<int>& depData,
+                             std::vector<bool>* declared = nullptr)
 {
     reader->moveToFirstChild(unknownString);
     while (reader->isValid()) {
@@ -745,6 +786,10 @@ static void loadDependencies(std::shared_ptr<readerElement>& reader,
         auto attDep = reader->getAttribute(depString);
         auto attDepKind = reader->getAttribute(depKindString);
         auto row = static_cast<index_t>(att.getValue());
+        if (declared != nullptr && attDep.isValid() && row > 0 &&
+            static_cast<std::size_t>(row) <= declared->size()) {
+            (*declared)[row - 1] = true;
+        }
         auto dep = gmlc::utilities::str2vector<int>(attDep.getText(), 0, " ");
         gmlc::utilities::stringVector depknd = (attDepKind.isValid()) ?
             gmlc::utilities::stringOps::splitline(
@@ -770,8 +815,9 @@ void FmiInfo::loadStructure(std::shared_ptr<readerElement>& reader)
     reader->moveToFirstChild("ModelStructure");
 
     reader->moveToFirstChild("Outputs");
+    outputDepDeclared.assign(variables.size(), false);
     if (reader->isValid()) {
-        loadDependencies(reader, outputs, outputDep);
+        loadDependencies(reader, outputs, outputDep, &outputDepDeclared);
     }
     reader->moveToParent();
     // get the derivative dependencies
@@ -28,6 +28,7 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -62,6 +63,7 @@ class VariableInformation {
     double start = 0;
     double min = -1e48;
     double max = 1e48;
+    double nominal = 1.0;
 };
 
 class FmiUnitDef {
@@ -172,12 +174,14 @@ class FmiInfo {
     /// the information about the specified default experiment
     FmuDefaultExperiment defaultExperiment;
 
-    /// map translating strings to indices into the variables array
-    std::map<std::string, int> variableLookup;
+    /// hash map translating strings to indices into the variables array
+    std::unordered_map<std::string, int> variableLookup;
     /// the output dependency information
     matrixDataOrdered<sparse_ordering::row_ordered, int> outputDep;
     /// the derivative dependency information
     matrixDataOrdered<sparse_ordering::row_ordered, int> derivDep;
+    /// flags for the variables with an explicit list of output dependencies
+    std::vector<bool> outputDepDeclared;
     /// the initial unknown dependency information
     matrixDataOrdered<sparse_ordering::row_ordered, int> unknownDep;
     std::vector<int> outputs;  //!< a list of the output indices
@@ -225,10 +229,17 @@ class FmiInfo {
     @return a vector of ints with the indices of the variables
     */
     const std::vector<int>& getVariableIndices(const std::string& type) const;
+    /** get the unit matching a unit name used in the FMU
+    @details units from the UnitDefinitions are used if available otherwise the name is parsed
+    directly, the result is invalid if the unit is not understood*/
+    units::precise_unit getUnit(const std::string& unitName) const;
     /** get the variable indices of the derivative dependencies*/
     const std::vector<std::pair<index_t, int>>& getDerivDependencies(int variableIndex) const;
     const std::vector<std::pair<index_t, int>>& getOutputDependencies(int variableIndex) const;
     const std::vector<std::pair<index_t, int>>& getUnknownDependencies(int variableIndex) const;
+    /** check if an output declared its dependencies in the ModelStructure
+    @details outputs without a dependency list must be assumed to depend on all known variables*/
+    bool hasDeclaredOutputDependencies(int variableIndex) const;
 
   private:
     void loadFmiHeader(std::shared_ptr<readerElement>& reader);
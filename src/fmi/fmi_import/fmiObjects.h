@@ -181,6 +181,8 @@ class fmi2Object {
     bool setFlag(const std::string& param, bool val);
     void getFMUState(fmi2FMUstate* FMUState);
     void setFMUState(fmi2FMUstate FMUState);
+    /** free a state returned by getFMUState and reset the pointer to null*/
+    void freeFMUState(fmi2FMUstate* FMUState);
 
     size_t serializedStateSize(fmi2FMUstate FMUState);
     void serializeState(fmi2FMUstate FMUState, fmi2Byte serializedState[], size_t size);
@@ -202,6 +204,12 @@ class fmi2Object {
     const FmiVariable& addOutputVariable(int index);
     const FmiVariable& addInputVariable(const std::string& inputName);
     const FmiVariable& addInputVariable(int index);
+    /** reserve space for the active inputs and outputs before adding many variables*/
+    void reserveVariables(std::size_t inputCount, std::size_t outputCount)
+    {
+        activeInputs.reserve(inputCount);
+        activeOutputs.reserve(outputCount);
+    }
 
     FmiVariableSet getVariableSet(const std::string& variable) const;
     FmiVariableSet getVariableSet(int index) const;
@@ -216,6 +224,8 @@ class fmi2Object {
 
     std::vector<std::string> getOutputNames() const;
     std::vector<std::string> getInputNames() const;
+    /** get the names of all the variables which can be added as outputs*/
+    std::vector<std::string> getAvailableOutputNames() const;
 
     bool isParameter(const std::string& param, fmi_variable_type type = fmi_variable_type::numeric);
     bool isVariable(const std::string& var, fmi_variable_type type = fmi_variable_type::numeric);
@@ -258,6 +268,8 @@ class fmi2Object {
     void setDefaultInputs();
     /** set the outputs to be all defined outputs*/
     void setDefaultOutputs();
+    /** get the names of the outputs used if none are specified*/
+    std::vector<std::string> getDefaultOutputNames() const;
 
   private:
     /// flag indicating that an exception should be thrown when an input is discarded
@@ -266,6 +278,10 @@ class fmi2Object {
     bool exceptionOnWarning{false};
     /// @brief  flag indicating that the free function should not be called on destructor
     bool noFree{false};
+    /// flag indicating that local variables can be used as outputs
+    bool localOutputs{true};
+    /// flag indicating that local variables are included in the default outputs
+    bool defaultLocalOutputs{false};
     std::shared_ptr<const fmiCommonFunctions> commonFunctions;
     const std::string name;
     std::shared_ptr<FmiLogger> logger;
@@ -348,6 +364,13 @@ class fmi2CoSimObject: public fmi2Object {
     @param[in] dIdt the input derivatives must be the size of the number of inputs
     */
     void setInputDerivatives(int order, const fmi2Real dIdt[]);
+    /** set the input derivatives of a particular order for a set of real inputs
+    @param[in] vrset the value references of the inputs
+    @param[in] order the numerical order of the derivative to set
+    @param[in] dIdt the input derivatives must be the size of the set
+    @throw std::invalid_argument if the order is not between 1 and 10
+    */
+    void setInputDerivatives(const FmiVariableSet& vrset, int order, const fmi2Real dIdt[]);
     /** get the output derivatives of a particular order
     @param[in] order the order of the derivatives to retrieve
     @param[out] dOdt the output derivatives
@@ -0,0 +1,261 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "FmiCheckpoint.hpp"
+
+#include "FmiHelics.hpp"
+#include "zlib.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+namespace helicsfmi {
+
+static constexpr char checkpointMagic[8] = {'H', 'F', 'M', 'I', 'C', 'K', 'P', '1'};
+
+/** append the bytes of a trivially copyable value to a buffer*/
+template<typename ValueType>
+static void appendValue(std::string& buffer, ValueType value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void appendString(std::string& buffer, const std::string& value)
+{
+    appendValue(buffer, static_cast<std::uint32_t>(value.size()));
+    buffer.append(value);
+}
+
+/** sequential reader of the values in a decompressed record*/
+class RecordReader {
+  public:
+    explicit RecordReader(const std::string& record): data(record) {}
+    template<typename ValueType>
+    ValueType value()
+    {
+        ValueType val{};
+        std::memcpy(&val, take(sizeof(val)), sizeof(val));
+        return val;
+    }
+    std::string string()
+    {
+        const auto length = value<std::uint32_t>();
+        return {take(length), length};
+    }
+    const char* take(std::size_t bytes)
+    {
+        if (bytes > data.size() - position) {
+            throw(Error("Checkpoint", "checkpoint record is truncated", -102));
+        }
+        const char* start = data.data() + position;
+        position += bytes;
+        return start;
+    }
+
+  private:
+    const std::string& data;
+    std::size_t position{0};
+};
+
+/** encode and compress the record of a federate
+@details the compressed record is prefixed with its size and the size of the encoded record
+@return the compressed record or an empty string if the compression failed*/
+static std::string compressRecord(const FederateCheckpoint& point)
+{
+    std::string record;
+    appendString(record, point.name);
+    appendValue(record, point.time);
+    appendValue(record, static_cast<std::uint64_t>(point.state.size()));
+    record.append(point.state.data(), point.state.size());
+    appendValue(record, static_cast<std::uint32_t>(point.values.size()));
+    for (const auto& [name, value] : point.values) {
+        appendString(record, name);
+        appendString(record, value);
+    }
+    appendValue(record, static_cast<std::uint32_t>(point.vectors.size()));
+    for (const auto& [name, elements] : point.vectors) {
+        appendString(record, name);
+        appendValue(record, static_cast<std::uint32_t>(elements.size()));
+        record.append(reinterpret_cast<const char*>(elements.data()),
+                      elements.size() * sizeof(double));
+    }
+
+    uLongf compressedBytes = compressBound(static_cast<uLong>(record.size()));
+    std::string output(2 * sizeof(std::uint64_t) + compressedBytes, '\0');
+    if (compress2(reinterpret_cast<Bytef*>(output.data() + 2 * sizeof(std::uint64_t)),
+                  &compressedBytes,
+                  reinterpret_cast<const Bytef*>(record.data()),
+                  static_cast<uLong>(record.size()),
+                  Z_BEST_SPEED) != Z_OK) {
+        return {};
+    }
+    const std::array<std::uint64_t, 2> sizes{static_cast<std::uint64_t>(compressedBytes),
+                                             static_cast<std::uint64_t>(record.size())};
+    std::memcpy(output.data(), sizes.data(), sizeof(sizes));
+    output.resize(sizeof(sizes) + compressedBytes);
+    return output;
+}
+
+static FederateCheckpoint decodeRecord(const std::string& record)
+{
+    RecordReader reader(record);
+    FederateCheckpoint point;
+    point.name = reader.string();
+    point.time = reader.value<double>();
+    const auto stateBytes = reader.value<std::uint64_t>();
+    const char* state = reader.take(stateBytes);
+    point.state.assign(state, state + stateBytes);
+    const auto valueCount = reader.value<std::uint32_t>();
+    for (std::uint32_t ii = 0; ii < valueCount; ++ii) {
+        auto name = reader.string();
+        point.values.emplace_back(std::move(name), reader.string());
+    }
+    const auto vectorCount = reader.value<std::uint32_t>();
+    for (std::uint32_t ii = 0; ii < vectorCount; ++ii) {
+        auto name = reader.string();
+        std::vector<double> elements(reader.value<std::uint32_t>());
+        std::memcpy(elements.data(),
+                    reader.take(elements.size() * sizeof(double)),
+                    elements.size() * sizeof(double));
+        point.vectors.emplace_back(std::move(name), std::move(elements));
+    }
+    return point;
+}
+
+CheckpointWriter::CheckpointWriter(std::string file, double interval, std::size_t federates):
+    fileName(std::move(file)), period(interval), federateCount(federates)
+{
+    if (period <= 0.0) {
+        throw(Error("Checkpoint", "the checkpoint interval must be positive", -101));
+    }
+}
+
+double CheckpointWriter::nextTime(double time) const
+{
+    // the tolerance keeps a time on a checkpoint from rounding down to the previous interval
+    return period * (std::floor(time / period + 1e-9) + 1.0);
+}
+
+bool CheckpointWriter::add(const FederateCheckpoint& point)
+{
+    // records are compressed on the thread of the federate before the lock is taken
+    auto record = compressRecord(point);
+    if (record.empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    auto& records = pending[point.time];
+    records.push_back(std::move(record));
+    if (records.size() < federateCount) {
+        return true;
+    }
+    const bool result = write(point.time, records);
+    if (result) {
+        ++written;
+        lastTime = point.time;
+    }
+    // a federate that missed an earlier checkpoint leaves it incomplete so it is discarded
+    const auto end = pending.upper_bound(point.time);
+    discarded += static_cast<std::uint64_t>(std::distance(pending.begin(), end)) - 1U;
+    pending.erase(pending.begin(), end);
+    return result;
+}
+
+std::uint64_t CheckpointWriter::getCount() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return written;
+}
+
+std::uint64_t CheckpointWriter::getDiscardedCount() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return discarded;
+}
+
+double CheckpointWriter::getLastTime() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return lastTime;
+}
+
+bool CheckpointWriter::write(double time, const std::vector<std::string>& records) const
+{
+    const std::string tempFile = fileName + ".tmp";
+    {
+        std::ofstream output(tempFile, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!output.is_open()) {
+            return false;
+        }
+        const auto count = static_cast<std::uint32_t>(records.size());
+        output.write(checkpointMagic, sizeof(checkpointMagic));
+        output.write(reinterpret_cast<const char*>(&time), sizeof(time));
+        output.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const auto& record : records) {
+            output.write(record.data(), static_cast<std::streamsize>(record.size()));
+        }
+        output.flush();
+        if (!output) {
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempFile, fileName, error);
+    return !error;
+}
+
+std::vector<FederateCheckpoint> loadCheckpoint(const std::string& fileName)
+{
+    std::ifstream input(fileName, std::ios::in | std::ios::binary);
+    if (!input.is_open()) {
+        throw(Error("Checkpoint", fmt::format("unable to open checkpoint {}", fileName), -101));
+    }
+    char magic[sizeof(checkpointMagic)] = {};
+    double time{0.0};
+    std::uint32_t count{0};
+    input.read(magic, sizeof(magic));
+    input.read(reinterpret_cast<char*>(&time), sizeof(time));
+    input.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!input || std::memcmp(magic, checkpointMagic, sizeof(checkpointMagic)) != 0) {
+        throw(Error("Checkpoint", fmt::format("{} is not a checkpoint file", fileName), -102));
+    }
+    std::vector<FederateCheckpoint> points;
+    std::string compressed;
+    std::string record;
+    for (std::uint32_t ii = 0; ii < count; ++ii) {
+        std::array<std::uint64_t, 2> sizes{};
+        input.read(reinterpret_cast<char*>(sizes.data()), sizeof(sizes));
+        if (!input) {
+            throw(Error("Checkpoint", fmt::format("{} is truncated", fileName), -102));
+        }
+        compressed.resize(sizes[0]);
+        input.read(compressed.data(), static_cast<std::streamsize>(sizes[0]));
+        record.resize(sizes[1]);
+        auto recordBytes = static_cast<uLongf>(sizes[1]);
+        if (!input ||
+            uncompress(reinterpret_cast<Bytef*>(record.data()),
+                       &recordBytes,
+                       reinterpret_cast<const Bytef*>(compressed.data()),
+                       static_cast<uLong>(sizes[0])) != Z_OK ||
+            recordBytes != sizes[1]) {
+            throw(Error("Checkpoint",
+                        fmt::format("invalid federate record in {}", fileName),
+                        -102));
+        }
+        points.push_back(decodeRecord(record));
+        points.back().time = time;
+    }
+    return points;
+}
+
+}  // namespace helicsfmi
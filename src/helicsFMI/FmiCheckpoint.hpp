@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace helicsfmi {
+
+/** the state of a co-simulation federate at a checkpoint*/
+struct FederateCheckpoint {
+    std::string name;  //!< the name of the federate
+    double time{0.0};  //!< the simulation time of the checkpoint
+    std::vector<char> state;  //!< the serialized FMU state
+    /// the last published value of each scalar publication by publication name
+    std::vector<std::pair<std::string, std::string>> values;
+    /// the last published elements of each vector publication by publication name
+    std::vector<std::pair<std::string, std::vector<double>>> vectors;
+};
+
+/** collect the checkpoints of a set of federates into a single compressed file
+@details each federate compresses its own record when it reaches a checkpoint time, once every
+federate has added a record for the same time the file is replaced with the complete checkpoint so
+an interrupted write never leaves a partial checkpoint, the methods are thread safe*/
+class CheckpointWriter {
+  private:
+    std::string fileName;
+    double period{0.0};  //!< the simulated time between checkpoints
+    std::size_t federateCount{0};  //!< the number of records in a complete checkpoint
+    mutable std::mutex lock;  //!< protects the pending records and the counters
+    /// the compressed records of the incomplete checkpoints by checkpoint time
+    std::map<double, std::vector<std::string>> pending;
+    std::uint64_t written{0};  //!< the number of complete checkpoints written
+    std::uint64_t discarded{0};  //!< the number of incomplete checkpoints discarded
+    double lastTime{-1.0};  //!< the time of the last complete checkpoint
+
+  public:
+    /** create a writer
+    @param file the checkpoint file
+    @param interval the simulated time between checkpoints
+    @param federates the number of federates adding records to each checkpoint*/
+    CheckpointWriter(std::string file, double interval, std::size_t federates);
+    /** get the simulated time between checkpoints*/
+    [[nodiscard]] double getInterval() const { return period; }
+    /** get the first checkpoint time after a simulation time*/
+    [[nodiscard]] double nextTime(double time) const;
+    /** add the record of a federate to the checkpoint at the time of the record
+    @details completing a checkpoint discards any earlier checkpoint that is still incomplete
+    @return false if the record could not be compressed or the complete checkpoint could not be
+    written to the file*/
+    bool add(const FederateCheckpoint& point);
+    /** get the number of complete checkpoints written*/
+    [[nodiscard]] std::uint64_t getCount() const;
+    /** get the number of incomplete checkpoints discarded because a later one completed*/
+    [[nodiscard]] std::uint64_t getDiscardedCount() const;
+    /** get the time of the last complete checkpoint, negative if none were written*/
+    [[nodiscard]] double getLastTime() const;
+    /** get the name of the checkpoint file*/
+    [[nodiscard]] const std::string& getFileName() const { return fileName; }
+
+  private:
+    /** write a complete checkpoint to a temporary file and move it over the checkpoint file*/
+    bool write(double time, const std::vector<std::string>& records) const;
+};
+
+/** load the federate records of a checkpoint file
+@throw Error if the file cannot be read or is not a valid checkpoint*/
+std::vector<FederateCheckpoint> loadCheckpoint(const std::string& fileName);
+
+}  // namespace helicsfmi
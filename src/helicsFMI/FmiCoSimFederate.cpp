@@ -13,13 +13,49 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 #include "gmlc/utilities/stringConversion.h"
 
 #include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <fmt/format.h>
-#include <fstream>
 #include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 namespace helicsfmi {
+InputExtrapolation getInputExtrapolation(std::string_view method)
+{
+    if (method == "hold" || method == "none") {
+        return InputExtrapolation::hold;
+    }
+    if (method == "linear") {
+        return InputExtrapolation::linear;
+    }
+    if (method == "quadratic") {
+        return InputExtrapolation::quadratic;
+    }
+    throw(Error("CoSimFederate",
+                fmt::format("unrecognized extrapolation method {}", method),
+                -102));
+}
+
+OutputAggregation getOutputAggregation(std::string_view method)
+{
+    if (method == "last") {
+        return OutputAggregation::last;
+    }
+    if (method == "average" || method == "mean") {
+        return OutputAggregation::average;
+    }
+    if (method == "min" || method == "minimum") {
+        return OutputAggregation::minimum;
+    }
+    if (method == "max" || method == "maximum") {
+        return OutputAggregation::maximum;
+    }
+    throw(Error("CoSimFederate", fmt::format("unrecognized aggregation method {}", method), -102));
+}
+
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
 CoSimFederate::CoSimFederate(std::string_view name,
                              const std::string& configFile,
@@ -105,122 +141,421 @@ void CoSimFederate::loadFMUInformation()
     }
 }
 
-static inline int getUnused(const std::vector<int>& usedList)
+void CoSimFederate::configure(helics::Time step, helics::Time startTime)
 {
-    auto ind = std::find(usedList.begin(), usedList.end(), 0);
-    return ind - usedList.begin();
+    timeBias = startTime;
+    logLevel = fed.getIntegerProperty(HELICS_PROPERTY_INT_LOG_LEVEL);
+
+    if (std::any_of(input_list.begin(), input_list.end(), isVariablePattern)) {
+        input_list =
+            expandVariablePatterns(input_list, cs->fmuInformation().getVariableNames("input"));
+    }
+    if (std::any_of(output_list.begin(), output_list.end(), isVariablePattern)) {
+        output_list = expandVariablePatterns(output_list, cs->getAvailableOutputNames());
+    }
+    if (!inputGroups.empty()) {
+        loadGroups(inputGroups, cs->fmuInformation().getVariableNames("input"), input_list);
+    }
+    if (!outputGroups.empty()) {
+        loadGroups(outputGroups, cs->getAvailableOutputNames(), output_list);
+    }
+    cs->reserveVariables(input_list.size() + fed.getInputCount(),
+                         output_list.size() + fed.getPublicationCount());
+    configureInputs();
+    configureOutputs();
+    for (const auto& group : inputGroups) {
+        groupInputs.emplace_back(&fed, group.name, helics::DataType::HELICS_VECTOR);
+    }
+    for (const auto& group : outputGroups) {
+        auto& pub = groupPubs.emplace_back(&fed, group.name, helics::DataType::HELICS_VECTOR);
+        std::string elements;
+        for (const auto& variable : group.variables) {
+            elements.append(variable).push_back(',');
+        }
+        if (!elements.empty()) {
+            elements.pop_back();
+        }
+        pub.setTag("elements", elements);
+    }
+    if (interfaceTiming) {
+        setInterfaceTiming();
+    }
+    if (variableQueries) {
+        loadQueries();
+    }
+
+    const auto& def = cs->fmuInformation().getExperiment();
+
+    if (step <= helics::timeZero) {
+        step = def.stepSize;
+    }
+    if (step <= helics::timeZero) {
+        auto tstep = fed.getTimeProperty(HELICS_PROPERTY_TIME_PERIOD);
+        step = (tstep > helics::timeEpsilon) ? tstep : helics::Time(0.2);
+    }
+    stepTime = step;
+    variableSteps =
+        cs->fmuInformation().checkFlag(fmuCapabilityFlags::canHandleVariableCommunicationStepSize);
+    if (adaptiveStep && !variableSteps) {
+        fed.logWarningMessage(
+            "FMU cannot handle variable communication step sizes, using a fixed step");
+        adaptiveStep = false;
+    }
+    if (adaptiveStep) {
+        if (minStepTime <= helics::timeZero) {
+            minStepTime = std::min(stepTime, maxStepTime);
+        }
+        maxStepTime = std::max(minStepTime, maxStepTime);
+        nextStepTime = std::clamp(stepTime, minStepTime, maxStepTime);
+        // the granted times must allow any multiple of the minimum step
+        step = minStepTime;
+        LOG_FED_SUMMARY(fmt::format("adaptive step between {} and {} with tolerance {}",
+                                    static_cast<double>(minStepTime),
+                                    static_cast<double>(maxStepTime),
+                                    stepTolerance));
+    }
+    fed.setProperty(HELICS_PROPERTY_TIME_PERIOD, step);
+    if (eventDriven) {
+        if (adaptiveStep) {
+            fed.logWarningMessage("adaptive stepping is not used in event triggered mode");
+            adaptiveStep = false;
+        }
+        LOG_FED_SUMMARY("event triggered mode, the FMU is only stepped when inputs are updated");
+    }
+    if (maxDiscardRetries > 0) {
+        if (!variableSteps) {
+            fed.logWarningMessage(
+                "FMU cannot handle variable communication step sizes, discarded steps are not "
+                "retried");
+            maxDiscardRetries = 0;
+        } else {
+            discardRollback =
+                cs->fmuInformation().checkFlag(fmuCapabilityFlags::canGetAndSetFMUstate);
+            LOG_FED_SUMMARY(fmt::format("up to {} retries of discarded steps{}",
+                                        maxDiscardRetries,
+                                        discardRollback ? " with state rollback" : ""));
+        }
+    }
+    if (maxIterations > 0) {
+        if (!cs->fmuInformation().checkFlag(fmuCapabilityFlags::canGetAndSetFMUstate)) {
+            fed.logWarningMessage("FMU cannot get and set its state, steps are not iterated");
+            maxIterations = 0;
+        } else if (adaptiveStep || eventDriven) {
+            fed.logWarningMessage("iterative steps require a fixed step size");
+            maxIterations = 0;
+        } else {
+            LOG_FED_SUMMARY(fmt::format("up to {} iterations per step with tolerance {}",
+                                        maxIterations,
+                                        iterationTolerance));
+        }
+    }
+    interpolateInputs =
+        cs->fmuInformation().checkFlag(fmuCapabilityFlags::canInterpolateInputs);
+    subStepCount = 1;
+    if (subStepTime > helics::timeZero && subStepTime < stepTime) {
+        if (adaptiveStep || eventDriven) {
+            fed.logWarningMessage("sub-steps require a fixed step size");
+        } else {
+            subStepCount = static_cast<int>(
+                std::lround(static_cast<double>(stepTime) / static_cast<double>(subStepTime)));
+            LOG_FED_SUMMARY(fmt::format("{} FMU steps of {} per federate step",
+                                        subStepCount,
+                                        static_cast<double>(stepTime) / subStepCount));
+        }
+    }
+    // output frames hold numeric values only
+    bool stringOutputs{false};
+    for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
+        if (getHelicsType(cs->getOutput(static_cast<int>(ii)).type) ==
+            helics::DataType::HELICS_STRING) {
+            stringOutputs = true;
+        }
+    }
+    if (runAheadFrames > 0) {
+        if (fed.getInputCount() > 0) {
+            fed.logWarningMessage("run-ahead stepping requires a federate without inputs");
+            runAheadFrames = 0;
+        } else if (adaptiveStep || eventDriven || maxIterations > 0) {
+            fed.logWarningMessage("run-ahead stepping requires fixed steps without iteration");
+            runAheadFrames = 0;
+        } else if (stringOutputs) {
+            fed.logWarningMessage("run-ahead stepping does not support string outputs");
+            runAheadFrames = 0;
+        } else {
+            LOG_FED_SUMMARY(
+                fmt::format("FMU stepped up to {} steps ahead of the time grants", runAheadFrames));
+        }
+    }
+    if (speculativeStep) {
+        if (!cs->fmuInformation().checkFlag(fmuCapabilityFlags::canGetAndSetFMUstate)) {
+            fed.logWarningMessage("FMU cannot get and set its state, steps are not speculative");
+            speculativeStep = false;
+        } else if (adaptiveStep || eventDriven || maxIterations > 0) {
+            fed.logWarningMessage("speculative steps require fixed steps without iteration");
+            speculativeStep = false;
+        } else if (stringOutputs) {
+            fed.logWarningMessage("speculative steps do not support string outputs");
+            speculativeStep = false;
+        } else {
+            LOG_FED_SUMMARY(fmt::format(
+                "next step computed while waiting for grants with input tolerance {}",
+                speculationTolerance));
+        }
+    }
+
+    loadOutputPlan();
+    configured = true;
+    if (!groupPubs.empty() || !groupInputs.empty()) {
+        LOG_FED_SUMMARY(fmt::format("{} vector publications and {} vector inputs for grouped "
+                                    "variables",
+                                    groupPubs.size(),
+                                    groupInputs.size()));
+    }
+    LOG_FED_SUMMARY(fmt::format("\n  co sim federate:\n\t{} inputs\n\t{} publications "
+                                "({} continuous, {} discrete, {} tunable, {} read once)"
+                                "\n\tstep size={}",
+                                inputs.size(),
+                                pubs.size(),
+                                stepOutputs.size(),
+                                discreteOutputs.size(),
+                                tunableOutputs.size(),
+                                dependencies.staticCount(),
+                                static_cast<double>(stepTime)));
 }
 
-static inline int findMatch(const std::vector<std::string>& list, const std::string& match)
+void CoSimFederate::loadGroups(std::vector<VariableGroup>& groups,
+                               const std::vector<std::string>& candidates,
+                               std::vector<std::string>& list)
 {
-    auto ind = std::find(list.begin(), list.end(), match);
-    return ind - list.begin();
+    const auto& info = cs->fmuInformation();
+    const std::unordered_set<std::string_view> available(candidates.begin(), candidates.end());
+    std::unordered_set<std::string> grouped;
+    for (auto& group : groups) {
+        std::vector<std::string> members;
+        group.vrset.clear();
+        for (auto& variable : expandVariablePatterns(group.variables, candidates)) {
+            const auto& varInfo = info.getVariableInfo(variable);
+            if (available.count(variable) == 0 || varInfo.type != +fmi_variable_type::real) {
+                fed.logWarningMessage(fmt::format("{} is not a real valued variable for group {}",
+                                                  variable,
+                                                  group.name));
+                continue;
+            }
+            group.vrset.push(varInfo.valueRef);
+            grouped.insert(variable);
+            members.push_back(std::move(variable));
+        }
+        group.values.assign(members.size(), 0.0);
+        group.variables = std::move(members);
+        LOG_FED_INTERFACES(
+            fmt::format("group {} has {} elements", group.name, group.values.size()));
+    }
+    // the grouped variables are not also given scalar interfaces
+    auto isGrouped = [&grouped](const std::string& name) { return grouped.count(name) > 0; };
+    list.erase(std::remove_if(list.begin(), list.end(), isGrouped), list.end());
 }
 
-void CoSimFederate::configure(helics::Time step, helics::Time startTime)
+void CoSimFederate::configureInputs()
 {
-    timeBias = startTime;
-    logLevel = fed.getIntegerProperty(HELICS_PROPERTY_INT_LOG_LEVEL);
-
+    const auto& info = cs->fmuInformation();
+    std::unordered_map<std::string_view, std::size_t> listIndex;
+    listIndex.reserve(input_list.size());
+    for (std::size_t ii = 0; ii < input_list.size(); ++ii) {
+        listIndex.emplace(input_list[ii], ii);
+    }
+    std::vector<char> used(input_list.size(), 0);
+    std::size_t nextUnused{0};
     const int icount = fed.getInputCount();
-    std::vector<int> input_list_used(input_list.size(), 0);
+    inputs.reserve(inputs.size() + input_list.size() + static_cast<std::size_t>(icount));
     // get the already configured inputs
     for (int ii = 0; ii < icount; ++ii) {
         auto& inp = fed.getInput(ii);
         const auto& iname = inp.getInfo();
         if (!iname.empty()) {
-            const auto& inputInfo = cs->addInputVariable(iname);
-            if (inputInfo.index >= 0) {
-                auto index = findMatch(input_list, iname);
-                if (index < static_cast<int>(input_list.size())) {
-                    input_list_used[ii] = 1;
-                }
-            } else {
+            if (cs->addInputVariable(iname).index < 0) {
                 fed.logWarningMessage(iname + " is not a recognized input");
                 continue;
             }
+            auto listed = listIndex.find(iname);
+            if (listed != listIndex.end()) {
+                used[listed->second] = 1;
+            }
         } else {
-            auto index = getUnused(input_list_used);
-            if (index < static_cast<int>(input_list.size())) {
-                cs->addInputVariable(input_list[index]);
-                input_list_used[ii] = 1;
+            // an input without a variable name uses the next unused name of the list
+            while (nextUnused < input_list.size() && used[nextUnused] != 0) {
+                ++nextUnused;
+            }
+            if (nextUnused < input_list.size()) {
+                cs->addInputVariable(input_list[nextUnused]);
+                used[nextUnused] = 1;
             }
         }
         inputs.push_back(inp);
     }
-    int inputIndex = 0;
-    for (const auto& input : input_list) {
-        if (input_list_used[inputIndex] == 0) {
-            const auto& inputInfo = cs->addInputVariable(input);
-            if (inputInfo.index >= 0) {
-                auto iType = helicsfmi::getHelicsType(inputInfo.type);
-                inputs.emplace_back(&fed, input, iType);
-                LOG_FED_INTERFACES(fmt::format("created input {}", inputs.back().getName()));
-            } else {
-                fed.logWarningMessage(input + " is not a recognized input");
-            }
+    for (std::size_t ii = 0; ii < input_list.size(); ++ii) {
+        if (used[ii] != 0) {
+            continue;
         }
-        ++inputIndex;
+        const auto& input = input_list[ii];
+        const auto& varInfo = info.getVariableInfo(input);
+        const auto& inputInfo = cs->addInputVariable(varInfo.index);
+        if (inputInfo.index < 0) {
+            fed.logWarningMessage(input + " is not a recognized input");
+            continue;
+        }
+        inputs.emplace_back(&fed, input, helicsfmi::getHelicsType(inputInfo.type), varInfo.unit);
+        LOG_FED_INTERFACES(fmt::format("created input {}", inputs.back().getName()));
     }
+}
 
+void CoSimFederate::configureOutputs()
+{
+    const auto& info = cs->fmuInformation();
+    std::unordered_map<std::string_view, std::size_t> listIndex;
+    listIndex.reserve(output_list.size());
+    for (std::size_t ii = 0; ii < output_list.size(); ++ii) {
+        listIndex.emplace(output_list[ii], ii);
+    }
+    std::vector<char> used(output_list.size(), 0);
+    std::size_t nextUnused{0};
     const int ocount = fed.getPublicationCount();
-    std::vector<int> output_list_used(output_list.size(), 0);
-    // get the already configured inputs
+    pubs.reserve(pubs.size() + output_list.size() + static_cast<std::size_t>(ocount));
+    // get the already configured publications
     for (int ii = 0; ii < ocount; ++ii) {
         auto& pub = fed.getPublication(ii);
         const auto& iname = pub.getInfo();
         if (!iname.empty()) {
-            const auto& outputInfo = cs->addOutputVariable(iname);
-            if (outputInfo.index >= 0) {
-                auto index = findMatch(output_list, iname);
-                if (index < static_cast<int>(output_list.size())) {
-                    output_list_used[ii] = 1;
-                }
-            } else {
+            if (cs->addOutputVariable(iname).index < 0) {
                 fed.logWarningMessage(iname + " is not a recognized output");
                 continue;
             }
+            auto listed = listIndex.find(iname);
+            if (listed != listIndex.end()) {
+                used[listed->second] = 1;
+            }
         } else {
-            auto index = getUnused(output_list_used);
-            if (index < static_cast<int>(output_list.size())) {
-                cs->addOutputVariable(output_list[index]);
-                output_list_used[ii] = 1;
+            // a publication without a variable name uses the next unused name of the list
+            while (nextUnused < output_list.size() && used[nextUnused] != 0) {
+                ++nextUnused;
+            }
+            if (nextUnused < output_list.size()) {
+                cs->addOutputVariable(output_list[nextUnused]);
+                used[nextUnused] = 1;
             }
         }
         pubs.push_back(pub);
     }
-    int outIndex = 0;
-
-    for (const auto& output : output_list) {
-        if (output_list_used[outIndex] == 0) {
-            const auto& outputInfo = cs->addOutputVariable(output);
-            if (outputInfo.index >= 0) {
-                auto iType = helicsfmi::getHelicsType(outputInfo.type);
-                pubs.emplace_back(&fed, output, iType);
-                LOG_FED_INTERFACES(fmt::format("created publication {}", pubs.back().getName()));
-            } else {
-                fed.logWarningMessage(output + " is not a recognized output");
-            }
+    for (std::size_t ii = 0; ii < output_list.size(); ++ii) {
+        if (used[ii] != 0) {
+            continue;
         }
-        ++outIndex;
+        const auto& output = output_list[ii];
+        const auto& varInfo = info.getVariableInfo(output);
+        const auto& outputInfo = cs->addOutputVariable(varInfo.index);
+        if (outputInfo.index < 0) {
+            fed.logWarningMessage(output + " is not a recognized output");
+            continue;
+        }
+        pubs.emplace_back(&fed, output, helicsfmi::getHelicsType(outputInfo.type), varInfo.unit);
+        LOG_FED_INTERFACES(fmt::format("created publication {}", pubs.back().getName()));
     }
+}
 
-    const auto& def = cs->fmuInformation().getExperiment();
+void CoSimFederate::setInterfaceTiming()
+{
+    // interfaces from a configuration file are registered directly on the federate
+    if (fed.getInputCount() == 0) {
+        // the federate never waits for values from other federates
+        fed.setFlagOption(HELICS_FLAG_SOURCE_ONLY, true);
+        LOG_FED_SUMMARY("no inputs, the federate is a source only federate");
+    } else if (fed.getPublicationCount() == 0) {
+        // no other federate waits for values from the federate
+        fed.setFlagOption(HELICS_FLAG_OBSERVER, true);
+        LOG_FED_SUMMARY("no publications, the federate is an observer");
+    }
+}
 
-    if (step <= helics::timeZero) {
-        step = def.stepSize;
+void CoSimFederate::loadQueries()
+{
+    std::vector<std::string> statistics{
+        "discarded_steps", "repeated_steps", "speculative_kept", "speculative_rolled_back"};
+    queries = std::make_shared<VariableQueries>(*cs, std::move(statistics));
+    // the callback holds its own reference so the snapshot lives as long as queries can arrive
+    fed.setQueryCallback([answers = queries](std::string_view queryString) {
+        return answers->query(queryString);
+    });
+}
+
+void CoSimFederate::updateSnapshot(helics::Time time)
+{
+    if (queries) {
+        queries->update(*cs,
+                        static_cast<double>(time),
+                        {static_cast<double>(discardedSteps),
+                         static_cast<double>(stepIterations),
+                         static_cast<double>(speculation.kept),
+                         static_cast<double>(speculation.rolledBack)});
     }
-    if (step <= helics::timeZero) {
-        auto tstep = fed.getTimeProperty(HELICS_PROPERTY_TIME_PERIOD);
-        step = (tstep > helics::timeEpsilon) ? tstep : helics::Time(0.2);
+}
+
+void CoSimFederate::loadRecorder(double stop)
+{
+    try {
+        recorder = std::make_unique<InputRecorder>(inputRecordFile,
+                                                   static_cast<double>(timeBias),
+                                                   static_cast<double>(timeBias + stop));
     }
-    fed.setProperty(HELICS_PROPERTY_TIME_PERIOD, step);
-    stepTime = step;
-    LOG_FED_SUMMARY(
-        fmt::format("\n  co sim federate:\n\t{} inputs\n\t{} publications\n\tstep size={}",
-                    inputs.size(),
-                    pubs.size(),
-                    static_cast<double>(stepTime)));
+    catch (const Error& e) {
+        fed.logWarningMessage(e.what());
+        return;
+    }
+    const auto& info = cs->fmuInformation();
+    recordedInputs.assign(inputs.size(), 0);
+    for (std::size_t ii = 0; ii < inputs.size(); ++ii) {
+        const auto& var = cs->getInput(static_cast<int>(ii));
+        recordedInputs[ii] =
+            recorder->variable(info.getVariableInfo(static_cast<unsigned int>(var.index)).name);
+    }
+    recordedGroups.clear();
+    for (const auto& group : inputGroups) {
+        auto& members = recordedGroups.emplace_back();
+        for (const auto& name : group.variables) {
+            members.push_back(recorder->variable(name));
+        }
+    }
+}
+
+void CoSimFederate::recordParameters()
+{
+    // parameters set before the run, with --set or in a system file, are replayed with the inputs
+    const auto& info = cs->fmuInformation();
+    const auto start = static_cast<double>(timeBias);
+    for (auto index : info.getVariableIndices("parameter")) {
+        const auto& param = info.getVariableInfo(static_cast<unsigned int>(index));
+        recordVariable(FmiVariable(param), recorder->variable(param.name), start);
+    }
+}
+
+void CoSimFederate::recordVariable(const FmiVariable& var, std::uint32_t variable, double time)
+{
+    if (var.type == +fmi_variable_type::string) {
+        recorder->text(time, variable, cs->get<std::string_view>(var));
+    } else {
+        recorder->value(time, variable, cs->get<double>(var));
+    }
+}
+
+double CoSimFederate::recordTime()
+{
+    return static_cast<double>(std::max(fed.getCurrentTime(), helics::timeZero) + timeBias);
+}
+
+void CoSimFederate::loadOutputPlan()
+{
+    dependencies.build(*cs);
+    stepOutputs = dependencies.getOutputs(OutputUpdate::continuous);
+    discreteOutputs = dependencies.getOutputs(OutputUpdate::discrete);
+    tunableOutputs = dependencies.getOutputs(OutputUpdate::tunable);
 }
 
 void CoSimFederate::setInputs(std::vector<std::string> input_names)
@@ -251,6 +586,20 @@ void CoSimFederate::addConnection(const std::string& conn)
     connections.push_back(conn);
 }
 
+void CoSimFederate::addOutputGroup(const std::string& name, std::vector<std::string> variables)
+{
+    auto& group = outputGroups.emplace_back();
+    group.name = name;
+    group.variables = std::move(variables);
+}
+
+void CoSimFederate::addInputGroup(const std::string& name, std::vector<std::string> variables)
+{
+    auto& group = inputGroups.emplace_back();
+    group.name = name;
+    group.variables = std::move(variables);
+}
+
 void CoSimFederate::setOutputCapture(bool capture, const std::string& outputFile)
 {
     if (!outputFile.empty()) {
@@ -259,139 +608,1469 @@ void CoSimFederate::setOutputCapture(bool capture, const std::string& outputFile
     captureOutput = capture;
 }
 
-void CoSimFederate::runCommand(const std::string& command)
+void CoSimFederate::setAdaptiveStep(helics::Time minStep, helics::Time maxStep, double tolerance)
 {
-    auto cvec = gmlc::utilities::stringOps::splitlineQuotes(
-        command, " ,;:", "\"'`", gmlc::utilities::stringOps::delimiter_compression::on);
-    if (cvec[0] == "set") {
-        LOG_FED_DATA_MESSAGES(fmt::format("set command {}={}", cvec[1], cvec[2]));
-        auto val =
-            gmlc::utilities::numeric_conversionComplete<double>(cvec[2], helics::invalidDouble);
-        if (val != helics::invalidDouble) {
-            if (std::round(val) == val) {
-                set(cvec[1], static_cast<int64_t>(val));
-                return;
-            }
-            set(cvec[1], val);
-            return;
-        }
-        cs->set(cvec[1], cvec[2]);
-        return;
-    }
+    adaptiveStep = maxStep > helics::timeZero;
+    minStepTime = minStep;
+    maxStepTime = maxStep;
+    stepTolerance = tolerance;
 }
 
-double CoSimFederate::initialize(double stop, std::ofstream& ofile)
+void CoSimFederate::setSubStep(helics::Time subStep, OutputAggregation method)
 {
-    const auto& def = cs->fmuInformation().getExperiment();
+    subStepTime = subStep;
+    aggregation = method;
+}
 
-    if (stop <= helics::timeZero) {
-        stop = def.stopTime;
+void CoSimFederate::setIterativeStep(int iterations, double tolerance)
+{
+    maxIterations = std::max(iterations, 0);
+    iterationTolerance = tolerance;
+}
+
+void CoSimFederate::setRealTimePacing(double scale, bool lockMemory, int processor)
+{
+    if (scale > 0.0) {
+        pacer = std::make_unique<utilities::RealTimePacer>(scale);
+    } else {
+        pacer.reset();
     }
-    if (stop <= helics::timeZero) {
-        stop = 30.0;
+    pacingLockMemory = lockMemory;
+    pacingProcessor = processor;
+}
+
+bool CoSimFederate::canCheckpoint() const
+{
+    const auto& info = cs->fmuInformation();
+    return info.checkFlag(fmuCapabilityFlags::canGetAndSetFMUstate) &&
+        info.checkFlag(fmuCapabilityFlags::canSerializeFMUstate);
+}
+
+bool CoSimFederate::reachesCheckpoints(double interval) const
+{
+    // adaptive and event triggered steps end at the time grants so they miss the checkpoint times
+    if (adaptiveStep || eventDriven || stepTime <= helics::timeZero) {
+        return false;
     }
+    const auto step = static_cast<double>(stepTime);
+    auto isMultiple = [step](double value) {
+        const double steps = value / step;
+        return std::abs(steps - std::round(steps)) <= 1e-9 * std::max(1.0, std::abs(steps));
+    };
+    const double start = restorePoint ? restorePoint->time : static_cast<double>(timeBias);
+    return isMultiple(interval) && isMultiple(start);
+}
 
-    cs->setupExperiment(
-        false, 0, static_cast<double>(timeBias), true, static_cast<double>(timeBias + stop));
-    auto cmd = fed.getCommand();
-    while (!cmd.first.empty()) {
-        runCommand(cmd.first);
-        cmd = fed.getCommand();
+void CoSimFederate::restoreCheckpoint(FederateCheckpoint point)
+{
+    restorePoint = std::make_unique<FederateCheckpoint>(std::move(point));
+}
+
+void CoSimFederate::saveCheckpoint(helics::Time time)
+{
+    FederateCheckpoint point;
+    point.name = fed.getName();
+    point.time = static_cast<double>(time);
+    try {
+        fmi2FMUstate state{nullptr};
+        cs->getFMUState(&state);
+        const auto size = cs->serializedStateSize(state);
+        point.state.resize(size);
+        cs->serializeState(state, point.state.data(), size);
+        cs->freeFMUState(&state);
     }
-    fed.enterInitializingMode();
-    cs->setMode(FmuMode::INITIALIZATION);
-    if (captureOutput) {
-        ofile << "time,";
-        for (auto& pub : pubs) {
-            ofile << pub.getName() << ",";
-        }
-        ofile << std::endl;
+    catch (const fmiException& fe) {
+        fed.logWarningMessage(
+            fmt::format("unable to save the FMU state at {}: {}", point.time, fe.what()));
+        return;
     }
-    if (!pubs.empty()) {
-        for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
-            helicsfmi::publishOutput(pubs[ii], cs.get(), ii);
+    for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
+        if (connectedOutputs[ii]) {
+            point.values.emplace_back(pubs[ii].getName(), getPublishedValue(ii));
         }
     }
-    if (!inputs.empty()) {
-        for (std::size_t ii = 0; ii < inputs.size(); ++ii) {
-            helicsfmi::setDefault(inputs[ii], cs.get(), ii);
+    for (std::size_t ii = 0; ii < outputGroups.size(); ++ii) {
+        if (!outputGroups[ii].values.empty()) {
+            point.vectors.emplace_back(groupPubs[ii].getName(), outputGroups[ii].values);
         }
     }
-    LOG_FED_TIMING("initializing");
-    return stop;
+    const auto discarded = checkpoints->getDiscardedCount();
+    if (!checkpoints->add(point)) {
+        fed.logWarningMessage(fmt::format(
+            "unable to add the checkpoint at {} to {}", point.time, checkpoints->getFileName()));
+        return;
+    }
+    if (checkpoints->getDiscardedCount() > discarded) {
+        fed.logWarningMessage(fmt::format(
+            "discarded incomplete checkpoints before {}, a federate did not reach them",
+            point.time));
+    }
+    LOG_FED_TIMING(fmt::format("checkpoint at {}", point.time));
 }
 
-bool CoSimFederate::setFlag(const std::string& flag, bool val)
+std::string CoSimFederate::getPublishedValue(std::size_t index)
 {
-    if (cs->setFlag(flag, val)) {
-        return true;
+    // a deadband holds the last value that was actually published
+    const auto& filter = outputFilters[index];
+    if (filter.isActive() && filter.hasValue()) {
+        return fmt::format("{}", filter.getLastValue());
     }
-    const int param = helics::getFlagIndex(flag);
-    if (param != HELICS_INVALID_OPTION_INDEX) {
-        fed.setFlagOption(param, val);
-        return true;
+    if (aggregates.valid && aggregates.position[index] >= 0) {
+        return fmt::format("{}", aggregates.results[aggregates.position[index]]);
+    }
+    const auto& var = cs->getOutput(static_cast<int>(index));
+    switch (var.type) {
+        case fmi_variable_type::boolean:
+            return (cs->get<fmi2Boolean>(var) != fmi2False) ? "1" : "0";
+        case fmi_variable_type::integer:
+        case fmi_variable_type::enumeration:
+            return fmt::format("{}", cs->get<std::int64_t>(var));
+        case fmi_variable_type::real:
+        case fmi_variable_type::numeric:
+            return fmt::format("{}", cs->get<double>(var));
+        case fmi_variable_type::string:
+        default:
+            return std::string(cs->get<std::string_view>(var));
     }
-    return false;
 }
 
-void CoSimFederate::logMessage(int helicsLogLevel, std::string_view message)
+void CoSimFederate::publishCheckpoint()
 {
-    fed.logMessage(helicsLogLevel, message);
+    std::unordered_map<std::string_view, const std::string*> values;
+    for (const auto& [name, value] : restorePoint->values) {
+        values.emplace(name, &value);
+    }
+    for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
+        if (!connectedOutputs[ii]) {
+            continue;
+        }
+        auto value = values.find(pubs[ii].getName());
+        if (value == values.end()) {
+            fed.logWarningMessage(
+                fmt::format("publication {} is not in the checkpoint", pubs[ii].getName()));
+            continue;
+        }
+        pubs[ii].publish(*value->second);
+        ++outputStats.published;
+        // the deadband continues from the restored value
+        if (outputFilters[ii].isActive()) {
+            outputFilters[ii].update(
+                gmlc::utilities::numeric_conversionComplete<double>(*value->second, 0.0));
+        }
+    }
+    for (std::size_t ii = 0; ii < outputGroups.size(); ++ii) {
+        const auto& name = groupPubs[ii].getName();
+        for (const auto& [vectorName, elements] : restorePoint->vectors) {
+            if (vectorName == name) {
+                groupPubs[ii].publish(elements.data(), static_cast<int>(elements.size()));
+                break;
+            }
+        }
+    }
 }
 
-void CoSimFederate::run(helics::Time stop)
+void CoSimFederate::restoreState()
 {
-    std::ofstream ofile;
+    fmi2FMUstate state{nullptr};
+    cs->deSerializeState(restorePoint->state.data(), restorePoint->state.size(), &state);
+    cs->setFMUState(state);
+    cs->freeFMUState(&state);
+    LOG_FED_SUMMARY(fmt::format("resumed from the checkpoint at {}", restorePoint->time));
+    restorePoint.reset();
+}
 
-    if (captureOutput) {
-        ofile.open(outputCaptureFile);
+void CoSimFederate::setOutputTolerance(double absoluteTolerance, double relativeTolerance)
+{
+    outputAbsTolerance = absoluteTolerance;
+    outputRelTolerance = relativeTolerance;
+}
+
+static double getToleranceTag(const helics::Publication& pub, std::string_view tag, double defVal)
+{
+    const auto& tagValue = pub.getTag(tag);
+    if (tagValue.empty()) {
+        return defVal;
     }
+    return gmlc::utilities::numeric_conversionComplete<double>(tagValue, defVal);
+}
 
-    stop = initialize(stop, ofile);
+void CoSimFederate::loadOutputFilters()
+{
+    const auto& info = cs->fmuInformation();
+    outputFilters.clear();
+    outputFilters.reserve(pubs.size());
+    for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
+        const auto& var = cs->getOutput(static_cast<int>(ii));
+        outputFilters.emplace_back(
+            getToleranceTag(pubs[ii], "absolute_tolerance", outputAbsTolerance),
+            getToleranceTag(pubs[ii], "relative_tolerance", outputRelTolerance),
+            info.getVariableInfo(var.index).nominal);
+    }
+    // co-simulation FMUs handle their events inside a step without declaring event indicators, so
+    // discrete outputs are checked every step and only published when they change
+    for (auto index : discreteOutputs) {
+        outputFilters[index].setChangesOnly(true);
+    }
+}
 
-    auto result = fed.enterExecutingMode(helics::IterationRequest::ITERATE_IF_NEEDED);
-    if (result == helics::IterationResult::ITERATING) {
-        if (!inputs.empty()) {
-            for (std::size_t ii = 0; ii < inputs.size(); ++ii) {
-                helicsfmi::grabInput(inputs[ii], cs.get(), ii, logLevel >= HELICS_LOG_LEVEL_DATA);
-            }
+void CoSimFederate::publishOutput(std::size_t index)
+{
+    if (aggregates.valid && aggregates.position[index] >= 0) {
+        const double value = aggregates.results[aggregates.position[index]];
+        if (!outputFilters[index].update(value)) {
+            ++outputStats.suppressed;
+            return;
         }
-        fed.enterExecutingMode();
+        pubs[index].publish(value);
+        ++outputStats.published;
+        if (logLevel >= HELICS_LOG_LEVEL_DATA) {
+            cs->logMessage("data",
+                           fmt::format("publishing {} to {}", value, pubs[index].getName()));
+        }
+        return;
     }
-    cs->setMode(FmuMode::STEP);
+    if (helicsfmi::publishOutput(pubs[index],
+                                 cs.get(),
+                                 index,
+                                 outputFilters[index],
+                                 logLevel >= HELICS_LOG_LEVEL_DATA)) {
+        ++outputStats.published;
+    } else {
+        ++outputStats.suppressed;
+    }
+}
 
-    helics::Time currentTime = helics::timeZero;
-    while (currentTime + timeBias + stepTime <= stop) {
-        try {
-            cs->doStep(static_cast<double>(currentTime + timeBias),
-                       static_cast<double>(stepTime),
-                       fmi2True);
+void CoSimFederate::publishOutputs(const std::vector<std::size_t>& outputIndices)
+{
+    for (auto index : outputIndices) {
+        if (connectedOutputs[index]) {
+            publishOutput(index);
         }
-        catch (const fmiException& fe) {
-            fed.localError(56, fe.what());
-            break;
+    }
+}
+
+void CoSimFederate::publishGroups()
+{
+    for (std::size_t ii = 0; ii < outputGroups.size(); ++ii) {
+        auto& group = outputGroups[ii];
+        if (group.values.empty()) {
+            continue;
         }
-        currentTime = fed.requestNextStep();
-        if (!pubs.empty()) {
-            // get the values to publish
-            for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
-                helicsfmi::publishOutput(pubs[ii], cs.get(), ii, logLevel >= HELICS_LOG_LEVEL_DATA);
+        // the elements go straight from the batched read buffer into the vector publication
+        cs->get(group.vrset, group.values.data());
+        groupPubs[ii].publish(group.values.data(), static_cast<int>(group.values.size()));
+    }
+}
+
+void CoSimFederate::loadFrames(bool tunable)
+{
+    frames.index.clear();
+    frames.types.clear();
+    auto addOutputs = [this](const std::vector<std::size_t>& outputIndices) {
+        for (auto index : outputIndices) {
+            if (connectedOutputs[index]) {
+                const auto& var = cs->getOutput(static_cast<int>(index));
+                frames.index.push_back(index);
+                frames.types.push_back(getHelicsType(var.type));
             }
         }
-        if (!inputs.empty()) {
-            // load the inputs
-            for (std::size_t ii = 0; ii < inputs.size(); ++ii) {
-                helicsfmi::grabInput(inputs[ii], cs.get(), ii, logLevel >= HELICS_LOG_LEVEL_DATA);
-            }
+    };
+    addOutputs(stepOutputs);
+    addOutputs(discreteOutputs);
+    if (tunable) {
+        addOutputs(tunableOutputs);
+    }
+    frames.size = frames.index.size();
+    for (const auto& group : outputGroups) {
+        frames.size += group.values.size();
+    }
+}
+
+void CoSimFederate::readFrame(double* frame)
+{
+    for (std::size_t ii = 0; ii < frames.index.size(); ++ii) {
+        const auto index = frames.index[ii];
+        if (aggregates.valid && aggregates.position[index] >= 0) {
+            frame[ii] = aggregates.results[aggregates.position[index]];
+            continue;
+        }
+        const auto& var = cs->getOutput(static_cast<int>(index));
+        switch (frames.types[ii]) {
+            case helics::DataType::HELICS_BOOL:
+                frame[ii] = (cs->get<fmi2Boolean>(var) != fmi2False) ? 1.0 : 0.0;
+                break;
+            case helics::DataType::HELICS_INT:
+                frame[ii] = static_cast<double>(cs->get<std::int64_t>(var));
+                break;
+            default:
+                frame[ii] = cs->get<double>(var);
+                break;
         }
-        /* if (captureOutput) {
-             ofile << static_cast<double>(currentTime) << ",";
-             for (auto& out : outputs) {
-                 ofile << out << ",";
-             }
-             ofile << std::endl;
-         }
-         */
+    }
+    frame += frames.index.size();
+    for (const auto& group : outputGroups) {
+        if (!group.values.empty()) {
+            cs->get(group.vrset, frame);
+            frame += group.values.size();
+        }
+    }
+}
+
+void CoSimFederate::publishFrame(const double* frame)
+{
+    for (std::size_t ii = 0; ii < frames.index.size(); ++ii) {
+        const auto index = frames.index[ii];
+        const auto type = frames.types[ii];
+        // booleans bypass the deadband as they do when read from the FMU
+        auto& filter = outputFilters[index];
+        const bool publish = (type == helics::DataType::HELICS_BOOL) ? filter.changed(frame[ii]) :
+                                                                        filter.update(frame[ii]);
+        if (!publish) {
+            ++outputStats.suppressed;
+            continue;
+        }
+        switch (type) {
+            case helics::DataType::HELICS_BOOL:
+                pubs[index].publish(frame[ii] != 0.0);
+                break;
+            case helics::DataType::HELICS_INT:
+                pubs[index].publish(static_cast<std::int64_t>(frame[ii]));
+                break;
+            default:
+                pubs[index].publish(frame[ii]);
+                break;
+        }
+        ++outputStats.published;
+    }
+    frame += frames.index.size();
+    for (std::size_t ii = 0; ii < outputGroups.size(); ++ii) {
+        const auto size = outputGroups[ii].values.size();
+        if (size > 0) {
+            groupPubs[ii].publish(frame, static_cast<int>(size));
+            frame += size;
+        }
+    }
+}
+
+void CoSimFederate::computeFrames(helics::Time stop, std::string& error)
+{
+    auto& ring = *frames.ring;
+    helics::Time currentTime = helics::timeZero;
+    try {
+        while (currentTime + timeBias + stepTime <= stop) {
+            double* frame = ring.beginWrite();
+            if (frame == nullptr) {
+                break;
+            }
+            runQueuedCommands(currentTime);
+            stepPeriod(currentTime, true);
+            currentTime += stepTime;
+            readFrame(frame);
+            if (captureWriter) {
+                captureOutputs(currentTime + timeBias);
+            }
+            updateSnapshot(currentTime + timeBias);
+            ring.endWrite(static_cast<double>(currentTime));
+        }
+    }
+    catch (const fmiException& fe) {
+        error = fe.what();
+    }
+    ring.finish();
+}
+
+void CoSimFederate::runQueuedCommands(helics::Time time)
+{
+    std::vector<std::string> commands;
+    {
+        const std::lock_guard<std::mutex> guard(frames.commandLock);
+        commands.swap(frames.commands);
+    }
+    for (const auto& command : commands) {
+        applyCommand(command, static_cast<double>(time + timeBias));
+    }
+}
+
+void CoSimFederate::runAheadSteps(helics::Time stop)
+{
+    // the tunable outputs are published from the frames when a queued command changes them
+    loadFrames(true);
+    for (auto index : tunableOutputs) {
+        outputFilters[index].setChangesOnly(true);
+    }
+    frames.ring = std::make_unique<utilities::FrameRing>(runAheadFrames, frames.size);
+    auto& ring = *frames.ring;
+    std::string error;
+    // the FMU is only touched by the stepping thread until it is joined
+    std::thread stepper([this, stop, &error]() { computeFrames(stop, error); });
+    std::uint64_t frameCount{0};
+    try {
+        double frameTime{0.0};
+        while (const double* frame = ring.beginRead(frameTime)) {
+            if (pacer) {
+                pacer->pace(frameTime);
+            }
+            fed.requestNextStep();
+            if (pacer) {
+                pacer->startStep();
+            }
+            publishFrame(frame);
+            ring.endRead();
+            // the FMU belongs to the stepping thread so commands are applied before its next step
+            auto command = fed.getCommand();
+            while (!command.first.empty()) {
+                const std::lock_guard<std::mutex> guard(frames.commandLock);
+                frames.commands.push_back(std::move(command.first));
+                command = fed.getCommand();
+            }
+            ++frameCount;
+        }
+    }
+    catch (...) {
+        ring.close();
+        stepper.join();
+        throw;
+    }
+    stepper.join();
+    if (!error.empty()) {
+        fed.localError(56, error);
+    }
+    LOG_FED_SUMMARY(fmt::format("published {} run-ahead steps, {} waited for the FMU",
+                                frameCount,
+                                ring.readStalls()));
+    frames.ring.reset();
+}
+
+void CoSimFederate::runSpeculativeSteps(helics::Time stop)
+{
+    loadFrames(false);
+    std::vector<double> frame(frames.size);
+    helics::Time currentTime = helics::timeZero;
+    bool speculated{false};
+    while (currentTime + timeBias + stepTime <= stop) {
+        const auto stepEnd = currentTime + stepTime;
+        try {
+            if (!speculated) {
+                stepPeriod(currentTime, true);
+            }
+            // the outputs are read before the request since the FMU moves past them while waiting
+            readFrame(frame.data());
+            if (captureWriter) {
+                captureOutputs(stepEnd + timeBias);
+            }
+            updateSnapshot(stepEnd + timeBias);
+        }
+        catch (const fmiException& fe) {
+            fed.localError(56, fe.what());
+            break;
+        }
+        if (pacer) {
+            pacer->pace(static_cast<double>(stepEnd));
+        }
+        fed.requestTimeAsync(stepEnd);
+        bool saved{false};
+        speculated = false;
+        if (stepEnd + timeBias + stepTime <= stop) {
+            ++speculation.steps;
+            try {
+                cs->getFMUState(&stepState);
+                saved = true;
+                if (recorder) {
+                    recorder->savepoint(static_cast<double>(stepEnd + timeBias));
+                }
+                stepPeriod(stepEnd, false);
+                speculated = true;
+            }
+            catch (const fmiException&) {
+                // the step is computed again after the grant so any error is reported there
+            }
+        }
+        currentTime = fed.requestTimeComplete();
+        if (pacer) {
+            pacer->startStep();
+        }
+        publishFrame(frame.data());
+        if (parametersUpdated) {
+            publishOutputs(tunableOutputs);
+        }
+        parametersUpdated = false;
+        // a command can set a parameter so it invalidates the speculative step like an input
+        auto command = fed.getCommand();
+        if (saved) {
+            const bool rollback =
+                !speculated || !command.first.empty() || inputsChanged(speculationTolerance);
+            if (rollback) {
+                try {
+                    cs->setFMUState(stepState);
+                }
+                catch (const fmiException& fe) {
+                    fed.localError(56, fe.what());
+                    break;
+                }
+                if (recorder) {
+                    recorder->rollback(static_cast<double>(currentTime + timeBias));
+                }
+                speculated = false;
+                ++speculation.rolledBack;
+                LOG_FED_TIMING(fmt::format("speculative step from {} rolled back",
+                                           static_cast<double>(currentTime)));
+            } else {
+                ++speculation.kept;
+            }
+        }
+        while (!command.first.empty()) {
+            runCommand(command.first);
+            command = fed.getCommand();
+        }
+        grabInputs();
+    }
+}
+
+bool CoSimFederate::grabGroups()
+{
+    bool updated{false};
+    for (std::size_t ii = 0; ii < inputGroups.size(); ++ii) {
+        auto& inp = groupInputs[ii];
+        if (!inp.isUpdated()) {
+            continue;
+        }
+        auto& group = inputGroups[ii];
+        const int size = static_cast<int>(group.values.size());
+        const int count = inp.getValue(group.values.data(), size);
+        inp.clearUpdate();
+        if (count != size && !group.sizeMismatch) {
+            // any missing elements keep their previous values
+            fed.logWarningMessage(fmt::format(
+                "input group {} received {} elements, expected {}", group.name, count, size));
+            group.sizeMismatch = true;
+        }
+        if (size > 0) {
+            cs->set(group.vrset, group.values.data());
+            updated = true;
+            if (recorder) {
+                const double time = recordTime();
+                for (std::size_t kk = 0; kk < group.values.size(); ++kk) {
+                    recorder->value(time, recordedGroups[ii][kk], group.values[kk]);
+                }
+            }
+        }
+    }
+    return updated;
+}
+
+void CoSimFederate::removeUnconnectedOutputs()
+{
+    connectedOutputs = getConnectedPublications(fed, pubs);
+    auto unused = [this](std::size_t index) { return !connectedOutputs[index]; };
+    for (auto* plan : {&stepOutputs, &discreteOutputs, &tunableOutputs}) {
+        plan->erase(std::remove_if(plan->begin(), plan->end(), unused), plan->end());
+    }
+    const auto unconnected = std::count(connectedOutputs.begin(), connectedOutputs.end(), false);
+    LOG_FED_SUMMARY(fmt::format("{} of {} publications have no subscribers and are not updated",
+                                unconnected,
+                                pubs.size()));
+}
+
+void CoSimFederate::loadInputBatch()
+{
+    const auto& info = cs->fmuInformation();
+    realInputs = RealInputBatch{};
+    otherInputs.clear();
+    for (std::size_t ii = 0; ii < inputs.size(); ++ii) {
+        const auto& var = cs->getInput(static_cast<int>(ii));
+        if (var.type != +fmi_variable_type::real) {
+            otherInputs.push_back(ii);
+            continue;
+        }
+        auto& inp = inputs[ii];
+        const auto& fmuUnits = info.getVariableInfo(var.index).unit;
+        std::string sourceUnits = inp.getInjectionUnits();
+        if (sourceUnits.empty()) {
+            sourceUnits = inp.getUnits();
+        }
+        UnitConversion conversion;
+        if (!fmuUnits.empty() && !sourceUnits.empty() && sourceUnits != fmuUnits) {
+            if (getUnitConversion(units::unit_from_string(sourceUnits),
+                                  info.getUnit(fmuUnits),
+                                  conversion)) {
+                LOG_FED_INTERFACES(fmt::format("input {} converts {} to {} ({}*x+{})",
+                                               inp.getName(),
+                                               sourceUnits,
+                                               fmuUnits,
+                                               conversion.factor,
+                                               conversion.offset));
+            } else {
+                fed.logWarningMessage(fmt::format("input {} units ({}) are not convertible to {}",
+                                                  inp.getName(),
+                                                  sourceUnits,
+                                                  fmuUnits));
+            }
+        }
+        const auto& injectionType = inp.getInjectionType();
+        realInputs.index.push_back(ii);
+        realInputs.types.push_back(injectionType.empty() ?
+                                       helics::DataType::HELICS_DOUBLE :
+                                       helics::getTypeFromString(injectionType));
+        realInputs.factor.push_back(conversion.factor);
+        realInputs.offset.push_back(conversion.offset);
+        const auto current = cs->get<double>(var);
+        realInputs.values.push_back(current);
+        realInputs.raw.push_back((current - conversion.offset) / conversion.factor);
+        realInputs.vrset.push(var.vRef);
+
+        auto method = extrapolation;
+        const auto& methodTag = inp.getTag("extrapolation");
+        if (!methodTag.empty()) {
+            try {
+                method = getInputExtrapolation(methodTag);
+            }
+            catch (const Error& e) {
+                fed.logWarningMessage(fmt::format("input {}: {}", inp.getName(), e.what()));
+            }
+        }
+        if (method != InputExtrapolation::hold) {
+            realInputs.extrapolated.push_back(realInputs.index.size() - 1);
+            realInputs.methods.push_back(method);
+            realInputs.extrapolatedSet.push(var.vRef);
+        }
+    }
+    const auto extrapolatedCount = realInputs.extrapolated.size();
+    realInputs.updated.assign(realInputs.index.size(), 0);
+    realInputs.predictors.resize(extrapolatedCount);
+    realInputs.predicted.assign(extrapolatedCount, 0.0);
+    realInputs.slopes.assign(extrapolatedCount, 0.0);
+    realInputs.curvatures.assign(extrapolatedCount, 0.0);
+    secondOrderInputs = std::find(realInputs.methods.begin(),
+                                  realInputs.methods.end(),
+                                  InputExtrapolation::quadratic) != realInputs.methods.end();
+    if (extrapolatedCount > 0) {
+        LOG_FED_SUMMARY(fmt::format("{} inputs are extrapolated between updates{}",
+                                    extrapolatedCount,
+                                    interpolateInputs ? " using input derivatives" : ""));
+    }
+}
+
+bool CoSimFederate::grabInputs()
+{
+    const bool logValues = logLevel >= HELICS_LOG_LEVEL_DATA;
+    bool updated{false};
+    updatedInputs.clear();
+    const std::size_t realCount = realInputs.index.size();
+    for (std::size_t ii = 0; ii < realCount; ++ii) {
+        auto& inp = inputs[realInputs.index[ii]];
+        realInputs.updated[ii] = 0;
+        if (inp.isUpdated()) {
+            realInputs.updated[ii] = 1;
+            updatedInputs.push_back(realInputs.index[ii]);
+            // the raw value is extracted so the conversion to FMU units happens in a single pass
+            helics::valueExtract(fed.getBytes(inp), realInputs.types[ii], realInputs.raw[ii]);
+            inp.clearUpdate();
+            updated = true;
+            if (logValues) {
+                cs->logMessage(
+                    "data", fmt::format("received {} for {}", realInputs.raw[ii], inp.getName()));
+            }
+        }
+    }
+    if (updated) {
+        const double* raw = realInputs.raw.data();
+        const double* factor = realInputs.factor.data();
+        const double* offset = realInputs.offset.data();
+        double* values = realInputs.values.data();
+        for (std::size_t ii = 0; ii < realCount; ++ii) {
+            values[ii] = raw[ii] * factor[ii] + offset[ii];
+        }
+        cs->set(realInputs.vrset, values);
+        if (recorder) {
+            const double time = recordTime();
+            for (std::size_t ii = 0; ii < realCount; ++ii) {
+                if (realInputs.updated[ii] != 0) {
+                    recorder->value(time, recordedInputs[realInputs.index[ii]], values[ii]);
+                }
+            }
+        }
+        // the predictors work in the federate time so they match the step times
+        const auto time = static_cast<double>(std::max(fed.getCurrentTime(), helics::timeZero));
+        for (std::size_t kk = 0; kk < realInputs.extrapolated.size(); ++kk) {
+            const auto position = realInputs.extrapolated[kk];
+            if (realInputs.updated[position] == 0) {
+                continue;
+            }
+            auto& predictor = realInputs.predictors[kk];
+            if (predictor) {
+                predictor->update(time, values[position]);
+            } else if (realInputs.methods[kk] == InputExtrapolation::quadratic) {
+                predictor =
+                    std::make_unique<utilities::quadraticPredictor<double>>(time, values[position]);
+            } else {
+                predictor =
+                    std::make_unique<utilities::valuePredictor<double>>(time, values[position]);
+            }
+        }
+    }
+    for (auto index : otherInputs) {
+        if (helicsfmi::grabInput(inputs[index], cs.get(), index, logValues)) {
+            updatedInputs.push_back(index);
+            updated = true;
+            if (recorder) {
+                recordVariable(cs->getInput(static_cast<int>(index)),
+                               recordedInputs[index],
+                               recordTime());
+            }
+        }
+    }
+    if (!inputGroups.empty() && grabGroups()) {
+        updated = true;
+    }
+    return updated;
+}
+
+void CoSimFederate::loadStepMonitor()
+{
+    const auto& info = cs->fmuInformation();
+    std::vector<double> nominal;
+    stepMonitorSet.clear();
+    for (auto index : stepOutputs) {
+        const auto& var = cs->getOutput(static_cast<int>(index));
+        if (var.type == +fmi_variable_type::real) {
+            stepMonitorSet.push(var.vRef);
+            nominal.push_back(info.getVariableInfo(var.index).nominal);
+        }
+    }
+    stepMonitorValues.assign(nominal.size(), 0.0);
+    stepControl = StepController(static_cast<double>(minStepTime),
+                                 static_cast<double>(maxStepTime),
+                                 stepTolerance);
+    stepControl.setNominal(std::move(nominal));
+}
+
+void CoSimFederate::extrapolateInputs(helics::Time stepStart, helics::Time stepSize)
+{
+    const auto start = static_cast<double>(stepStart);
+    const auto size = static_cast<double>(stepSize);
+    // a constant value over the step is most accurate at the middle of the step
+    const double target = interpolateInputs ? start : start + 0.5 * size;
+    for (std::size_t kk = 0; kk < realInputs.extrapolated.size(); ++kk) {
+        const auto& predictor = realInputs.predictors[kk];
+        if (!predictor) {
+            realInputs.predicted[kk] = realInputs.values[realInputs.extrapolated[kk]];
+            realInputs.slopes[kk] = 0.0;
+            realInputs.curvatures[kk] = 0.0;
+            continue;
+        }
+        const double value = predictor->predict(target);
+        realInputs.predicted[kk] = value;
+        if (interpolateInputs) {
+            // central differences are exact for the linear and quadratic predictors
+            const double next = predictor->predict(target + size);
+            const double previous = predictor->predict(target - size);
+            realInputs.slopes[kk] = (next - previous) / (2.0 * size);
+            realInputs.curvatures[kk] = (next - 2.0 * value + previous) / (size * size);
+        }
+    }
+    cs->set(realInputs.extrapolatedSet, realInputs.predicted.data());
+    if (recorder) {
+        for (std::size_t kk = 0; kk < realInputs.extrapolated.size(); ++kk) {
+            const auto position = realInputs.extrapolated[kk];
+            recorder->value(static_cast<double>(stepStart + timeBias),
+                            recordedInputs[realInputs.index[position]],
+                            realInputs.predicted[kk]);
+        }
+    }
+    if (interpolateInputs) {
+        cs->setInputDerivatives(realInputs.extrapolatedSet, 1, realInputs.slopes.data());
+        if (secondOrderInputs) {
+            cs->setInputDerivatives(realInputs.extrapolatedSet, 2, realInputs.curvatures.data());
+        }
+        if (recorder) {
+            const auto time = static_cast<double>(stepStart + timeBias);
+            for (std::size_t kk = 0; kk < realInputs.extrapolated.size(); ++kk) {
+                const auto variable = recordedInputs[realInputs.index[realInputs.extrapolated[kk]]];
+                recorder->derivative(time, variable, 1, realInputs.slopes[kk]);
+                if (secondOrderInputs) {
+                    recorder->derivative(time, variable, 2, realInputs.curvatures[kk]);
+                }
+            }
+        }
+    }
+}
+
+void CoSimFederate::stepFMU(helics::Time stepStart,
+                            helics::Time stepSize,
+                            bool noSetFMUStatePriorToCurrentPoint)
+{
+    if (!realInputs.extrapolated.empty()) {
+        extrapolateInputs(stepStart, stepSize);
+    }
+    if (maxDiscardRetries > 0) {
+        retryDiscardedSteps(stepStart, stepSize, noSetFMUStatePriorToCurrentPoint);
+        return;
+    }
+    cs->doStep(static_cast<double>(stepStart + timeBias),
+               static_cast<double>(stepSize),
+               noSetFMUStatePriorToCurrentPoint);
+    if (recorder) {
+        recorder->step(static_cast<double>(stepStart + timeBias), static_cast<double>(stepSize));
+    }
+}
+
+void CoSimFederate::retryDiscardedSteps(helics::Time stepStart,
+                                        helics::Time stepSize,
+                                        bool noSetFMUStatePriorToCurrentPoint)
+{
+    const double fullStep = static_cast<double>(stepSize);
+    const double start = static_cast<double>(stepStart + timeBias);
+    const double end = start + fullStep;
+    double time = start;
+    // after a discard the following steps start from the reduced size until it grows back
+    double size = (retryStepSize > 0.0) ? std::min(retryStepSize, fullStep) : fullStep;
+    int retries{0};
+    while (end - time > 1e-9 * fullStep) {
+        size = std::min(size, end - time);
+        // the state is saved once per federate step and before each of the reduced steps
+        const bool rollback = discardRollback && (time == start || retryStepSize > 0.0);
+        if (rollback) {
+            cs->getFMUState(&retryState);
+        }
+        try {
+            cs->doStep(time, size, noSetFMUStatePriorToCurrentPoint && !rollback);
+        }
+        catch (const fmiDiscardException&) {
+            if (++retries > maxDiscardRetries) {
+                throw;
+            }
+            if (retries == 1) {
+                ++discardedSteps;
+            }
+            double reached{time};
+            bool reachedKnown{true};
+            try {
+                reached = cs->getLastStepTime();
+            }
+            catch (const fmiException&) {
+                // the FMU does not report how far it got so the step is only halved
+                reachedKnown = false;
+            }
+            if (!rollback && !reachedKnown) {
+                fed.logWarningMessage(
+                    fmt::format("the step from {} was discarded and the FMU cannot restore its "
+                                "state or report its last successful time",
+                                time));
+                throw;
+            }
+            const double completed = reached - time;
+            if (rollback) {
+                cs->setFMUState(retryState);
+            } else if (completed > 0.0 && completed < size) {
+                // without a rollback the FMU continues from the last time it completed
+                if (recorder) {
+                    recorder->step(time, completed);
+                }
+                time = reached;
+            }
+            size = (completed > 0.0 && completed < 0.5 * size) ? completed : 0.5 * size;
+            retryStepSize = size;
+            LOG_FED_TIMING(fmt::format("step from {} discarded, retrying with a step of {}",
+                                       time,
+                                       size));
+            continue;
+        }
+        if (recorder) {
+            recorder->step(time, size);
+        }
+        time += size;
+        if (retryStepSize > 0.0) {
+            retryStepSize = 2.0 * size;
+            if (retryStepSize >= fullStep) {
+                retryStepSize = 0.0;
+            }
+            size = (retryStepSize > 0.0) ? retryStepSize : fullStep;
+        }
+    }
+}
+
+void CoSimFederate::loadAggregates()
+{
+    aggregates = SubStepAggregate{};
+    aggregates.position.assign(pubs.size(), -1);
+    for (auto index : stepOutputs) {
+        const auto& var = cs->getOutput(static_cast<int>(index));
+        if (var.type != +fmi_variable_type::real || !connectedOutputs[index]) {
+            continue;
+        }
+        auto method = aggregation;
+        const auto& methodTag = pubs[index].getTag("aggregation");
+        if (!methodTag.empty()) {
+            try {
+                method = getOutputAggregation(methodTag);
+            }
+            catch (const Error& e) {
+                fed.logWarningMessage(
+                    fmt::format("output {}: {}", pubs[index].getName(), e.what()));
+            }
+        }
+        if (method == OutputAggregation::last) {
+            continue;
+        }
+        aggregates.position[index] = static_cast<int>(aggregates.index.size());
+        aggregates.index.push_back(index);
+        aggregates.methods.push_back(method);
+        aggregates.vrset.push(var.vRef);
+    }
+    aggregates.values.assign(aggregates.index.size(), 0.0);
+    aggregates.results.assign(aggregates.index.size(), 0.0);
+}
+
+void CoSimFederate::stepPeriod(helics::Time periodStart, bool noSetFMUStatePriorToCurrentPoint)
+{
+    if (subStepCount <= 1) {
+        stepFMU(periodStart, stepTime, noSetFMUStatePriorToCurrentPoint);
+        return;
+    }
+    const helics::Time subStep(static_cast<double>(stepTime) / subStepCount);
+    const auto count = aggregates.index.size();
+    double* results = aggregates.results.data();
+    const double* values = aggregates.values.data();
+    helics::Time subStepStart = periodStart;
+    for (int subStepIndex = 0; subStepIndex < subStepCount; ++subStepIndex) {
+        // the last sub-step absorbs any rounding so the FMU ends exactly at the federate time
+        const auto size =
+            (subStepIndex + 1 == subStepCount) ? periodStart + stepTime - subStepStart : subStep;
+        stepFMU(subStepStart, size, noSetFMUStatePriorToCurrentPoint);
+        subStepStart += size;
+        if (count == 0) {
+            continue;
+        }
+        cs->get(aggregates.vrset, aggregates.values.data());
+        for (std::size_t ii = 0; ii < count; ++ii) {
+            if (subStepIndex == 0) {
+                results[ii] = values[ii];
+                continue;
+            }
+            switch (aggregates.methods[ii]) {
+                case OutputAggregation::average:
+                    results[ii] += values[ii];
+                    break;
+                case OutputAggregation::minimum:
+                    results[ii] = std::min(results[ii], values[ii]);
+                    break;
+                case OutputAggregation::maximum:
+                    results[ii] = std::max(results[ii], values[ii]);
+                    break;
+                default:
+                    results[ii] = values[ii];
+                    break;
+            }
+        }
+    }
+    for (std::size_t ii = 0; ii < count; ++ii) {
+        if (aggregates.methods[ii] == OutputAggregation::average) {
+            results[ii] /= subStepCount;
+        }
+    }
+    aggregates.valid = count > 0;
+}
+
+void CoSimFederate::stepTo(helics::Time currentTime, helics::Time nextTime)
+{
+    if (variableSteps) {
+        stepFMU(currentTime, nextTime - currentTime, true);
+        return;
+    }
+    while (currentTime + stepTime <= nextTime) {
+        stepFMU(currentTime, stepTime, true);
+        currentTime += stepTime;
+    }
+}
+
+helics::Time CoSimFederate::step(helics::Time currentTime, helics::Time stop)
+{
+    if (eventDriven) {
+        // sleep until an input arrives, then take one more step to publish the response to it
+        const auto target = eventPending ? currentTime + stepTime : stop - timeBias;
+        const auto granted = fed.requestTime(target);
+        stepTo(currentTime, granted);
+        return granted;
+    }
+    if (!adaptiveStep) {
+        if (maxIterations > 0) {
+            cs->getFMUState(&stepState);
+            if (recorder) {
+                recorder->savepoint(static_cast<double>(currentTime + timeBias));
+            }
+        }
+        stepPeriod(currentTime, maxIterations == 0);
+        if (pacer) {
+            pacer->pace(static_cast<double>(currentTime + stepTime));
+            const auto granted = fed.requestNextStep();
+            pacer->startStep();
+            return granted;
+        }
+        return fed.requestNextStep();
+    }
+    // the FMU steps to the granted time which may be earlier than requested if an input arrives
+    const auto target = std::min(currentTime + nextStepTime, stop - timeBias);
+    if (pacer) {
+        pacer->pace(static_cast<double>(target));
+    }
+    const auto granted = fed.requestTime(target);
+    if (pacer) {
+        pacer->startStep();
+    }
+    const auto actualStep = granted - currentTime;
+    stepFMU(currentTime, actualStep, true);
+    if (!stepMonitorValues.empty()) {
+        cs->get(stepMonitorSet, stepMonitorValues.data());
+    }
+    nextStepTime = stepControl.update(stepMonitorValues, static_cast<double>(actualStep));
+    LOG_FED_TIMING(fmt::format("step to {}, next step {} (error estimate {})",
+                               static_cast<double>(granted),
+                               static_cast<double>(nextStepTime),
+                               stepControl.getError()));
+    return granted;
+}
+
+bool CoSimFederate::inputsChanged(double tolerance)
+{
+    for (auto index : otherInputs) {
+        if (inputs[index].isUpdated()) {
+            return true;
+        }
+    }
+    for (auto& inp : groupInputs) {
+        if (inp.isUpdated()) {
+            return true;
+        }
+    }
+    for (std::size_t ii = 0; ii < realInputs.index.size(); ++ii) {
+        auto& inp = inputs[realInputs.index[ii]];
+        if (!inp.isUpdated()) {
+            continue;
+        }
+        double raw{0.0};
+        helics::valueExtract(fed.getBytes(inp), realInputs.types[ii], raw);
+        const double used = realInputs.values[ii];
+        const double value = raw * realInputs.factor[ii] + realInputs.offset[ii];
+        if (std::abs(value - used) > tolerance * std::max(1.0, std::abs(used))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+helics::Time CoSimFederate::iterateStep(helics::Time stepStart, helics::Time stepEnd)
+{
+    // the request after the last repeat checks whether the republished outputs converged
+    for (int iteration = 0; iteration <= maxIterations; ++iteration) {
+        const auto result =
+            fed.requestTimeIterative(stepEnd, helics::IterationRequest::ITERATE_IF_NEEDED);
+        if (result.state != helics::IterationResult::ITERATING) {
+            if (result.grantedTime > stepEnd) {
+                // without an iteration the federate is granted a later time so the FMU follows it
+                stepTo(stepEnd, result.grantedTime);
+                publishOutputs(stepOutputs);
+                publishOutputs(discreteOutputs);
+                publishGroups();
+                return result.grantedTime;
+            }
+            return stepEnd;
+        }
+        if (!inputsChanged(iterationTolerance)) {
+            // converged, any small input changes are used in the next step
+            return stepEnd;
+        }
+        if (iteration == maxIterations) {
+            LOG_FED_WARNING(fmt::format("inputs at {} did not converge in {} iterations",
+                                        static_cast<double>(stepEnd),
+                                        maxIterations));
+            return stepEnd;
+        }
+        cs->setFMUState(stepState);
+        if (recorder) {
+            recorder->rollback(static_cast<double>(stepStart + timeBias));
+        }
+        grabInputs();
+        stepPeriod(stepStart, false);
+        ++stepIterations;
+        LOG_FED_TIMING(fmt::format("repeated step to {} (iteration {})",
+                                   static_cast<double>(stepEnd),
+                                   iteration + 1));
+        publishOutputs(stepOutputs);
+        publishOutputs(discreteOutputs);
+        publishGroups();
+    }
+    return stepEnd;
+}
+
+void CoSimFederate::applyCommand(const std::string& command, double time)
+{
+    auto cvec = gmlc::utilities::stringOps::splitlineQuotes(
+        command, " ,;:", "\"'`", gmlc::utilities::stringOps::delimiter_compression::on);
+    if (cvec[0] == "set") {
+        LOG_FED_DATA_MESSAGES(fmt::format("set command {}={}", cvec[1], cvec[2]));
+        auto val =
+            gmlc::utilities::numeric_conversionComplete<double>(cvec[2], helics::invalidDouble);
+        if (val == helics::invalidDouble) {
+            set(cvec[1], cvec[2]);
+        } else if (std::round(val) == val) {
+            set(cvec[1], static_cast<int64_t>(val));
+        } else {
+            set(cvec[1], val);
+        }
+        if (recorder) {
+            const auto& info = cs->fmuInformation().getVariableInfo(cvec[1]);
+            if (info.index >= 0) {
+                recordVariable(FmiVariable(info), recorder->variable(cvec[1]), time);
+            }
+        }
+        return;
+    }
+}
+
+void CoSimFederate::processCommands()
+{
+    auto cmd = fed.getCommand();
+    while (!cmd.first.empty()) {
+        runCommand(cmd.first);
+        cmd = fed.getCommand();
+    }
+}
+
+void CoSimFederate::loadCapture()
+{
+    std::vector<std::string> names;
+    std::vector<std::string> integerNames;
+    std::vector<std::string> booleanNames;
+    captureReals.clear();
+    captureIntegers.clear();
+    captureBooleans.clear();
+    for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
+        if (!connectedOutputs[ii]) {
+            continue;
+        }
+        const auto& var = cs->getOutput(static_cast<int>(ii));
+        switch (var.type) {
+            case fmi_variable_type::real:
+                captureReals.push(var.vRef);
+                names.push_back(pubs[ii].getName());
+                break;
+            case fmi_variable_type::integer:
+            case fmi_variable_type::enumeration:
+                captureIntegers.push(var.vRef);
+                integerNames.push_back(pubs[ii].getName());
+                break;
+            case fmi_variable_type::boolean:
+                captureBooleans.push_back(var);
+                booleanNames.push_back(pubs[ii].getName());
+                break;
+            default:
+                break;
+        }
+    }
+    names.insert(names.end(), integerNames.begin(), integerNames.end());
+    names.insert(names.end(), booleanNames.begin(), booleanNames.end());
+    captureValues.assign(names.size(), 0.0);
+    captureIntegerValues.assign(integerNames.size(), 0);
+    if (outputCaptureFile.empty()) {
+        outputCaptureFile = fed.getName() + ".csv";
+    }
+    try {
+        const auto format = utilities::getCaptureFormat(outputCaptureFile);
+        captureWriter = std::make_unique<utilities::ColumnCapture>(outputCaptureFile,
+                                                                   std::move(names),
+                                                                   format);
+    }
+    catch (const std::runtime_error& e) {
+        fed.logWarningMessage(e.what());
+    }
+}
+
+void CoSimFederate::captureOutputs(helics::Time time)
+{
+    double* row = captureValues.data();
+    const auto realCount = captureReals.getVRcount();
+    if (realCount > 0) {
+        cs->get(captureReals, row);
+    }
+    row += realCount;
+    if (!captureIntegerValues.empty()) {
+        cs->get(captureIntegers, captureIntegerValues.data());
+        for (auto value : captureIntegerValues) {
+            *row++ = static_cast<double>(value);
+        }
+    }
+    for (const auto& var : captureBooleans) {
+        *row++ = cs->get<bool>(var) ? 1.0 : 0.0;
+    }
+    captureWriter->addRow(static_cast<double>(time), captureValues.data());
+}
+
+double CoSimFederate::initialize(double stop)
+{
+    const auto& def = cs->fmuInformation().getExperiment();
+    if (restorePoint) {
+        timeBias = restorePoint->time;
+    }
+
+    if (stop <= helics::timeZero) {
+        stop = def.stopTime;
+    }
+    if (stop <= helics::timeZero) {
+        stop = 30.0;
+    }
+
+    cs->setupExperiment(
+        false, 0, static_cast<double>(timeBias), true, static_cast<double>(timeBias + stop));
+    if (!inputRecordFile.empty()) {
+        if (restorePoint) {
+            fed.logWarningMessage("inputs are not recorded when resuming from a checkpoint");
+        } else {
+            loadRecorder(stop);
+        }
+    }
+    processCommands();
+    fed.enterInitializingMode();
+    cs->setMode(FmuMode::INITIALIZATION);
+    if (recorder) {
+        // the values of the FMU can only be read once it is initializing
+        recordParameters();
+    }
+    connectedOutputs.assign(pubs.size(), true);
+    if (connectedOutputsOnly) {
+        removeUnconnectedOutputs();
+    }
+    if (captureOutput) {
+        loadCapture();
+    }
+    loadOutputFilters();
+    if (subStepCount > 1) {
+        loadAggregates();
+    }
+    outputStats = OutputStatistics{};
+    if (restorePoint) {
+        // the FMU state is restored in step mode so the other federates get the published values
+        publishCheckpoint();
+    } else {
+        for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
+            if (connectedOutputs[ii]) {
+                publishOutput(ii);
+            }
+        }
+        publishGroups();
+    }
+    if (!inputs.empty()) {
+        for (std::size_t ii = 0; ii < inputs.size(); ++ii) {
+            helicsfmi::setDefault(inputs[ii], cs.get(), ii);
+        }
+    }
+    loadInputBatch();
+    if (adaptiveStep) {
+        loadStepMonitor();
+    }
+    LOG_FED_TIMING("initializing");
+    return stop;
+}
+
+bool CoSimFederate::setFlag(const std::string& flag, bool val)
+{
+    if (flag == "connected_outputs_only") {
+        connectedOutputsOnly = val;
+        return true;
+    }
+    if (flag == "interface_timing") {
+        interfaceTiming = val;
+        return true;
+    }
+    if (flag == "variable_queries") {
+        variableQueries = val;
+        return true;
+    }
+    if (flag == "speculative_step") {
+        speculativeStep = val;
+        return true;
+    }
+    if (flag == "event_triggered") {
+        // the federate flag is also set so the time coordinator knows it only reacts to inputs
+        eventDriven = val;
+        fed.setFlagOption(HELICS_FLAG_EVENT_TRIGGERED, val);
+        return true;
+    }
+    if (cs->setFlag(flag, val)) {
+        return true;
+    }
+    const int param = helics::getFlagIndex(flag);
+    if (param != HELICS_INVALID_OPTION_INDEX) {
+        fed.setFlagOption(param, val);
+        return true;
+    }
+    return false;
+}
+
+void CoSimFederate::logMessage(int helicsLogLevel, std::string_view message)
+{
+    fed.logMessage(helicsLogLevel, message);
+}
+
+void CoSimFederate::run(helics::Time stop)
+{
+    stop = initialize(stop);
+
+    auto result = fed.enterExecutingMode(helics::IterationRequest::ITERATE_IF_NEEDED);
+    if (result == helics::IterationResult::ITERATING) {
+        // a restored FMU takes the inputs after its state is set
+        if (!restorePoint && grabInputs()) {
+            // only the outputs with direct feedthrough from the updated inputs can have changed
+            publishOutputs(dependencies.getAffectedOutputs(updatedInputs));
+            publishGroups();
+        }
+        fed.enterExecutingMode();
+    }
+    cs->setMode(FmuMode::STEP);
+    if (recorder) {
+        recorder->enterStepMode(static_cast<double>(timeBias));
+    }
+    bool failed{false};
+    if (restorePoint) {
+        try {
+            restoreState();
+            grabInputs();
+        }
+        catch (const fmiException& fe) {
+            fed.localError(56, fe.what());
+            failed = true;
+        }
+    }
+    if (captureWriter) {
+        captureOutputs(timeBias);
+    }
+    updateSnapshot(timeBias);
+
+    // every output was published during initialization
+    parametersUpdated = false;
+    // an event triggered federate takes a step after an input or parameter changed, the first
+    // step is always taken
+    eventPending = true;
+    const helics::Time smallestStep = adaptiveStep ? minStepTime : stepTime;
+    helics::Time currentTime = helics::timeZero;
+    if (pacer && eventDriven) {
+        fed.logWarningMessage("real time pacing is not used in event triggered mode");
+        pacer.reset();
+    }
+    if (pacer) {
+        startPacing(fed, *pacer, 0.0, pacingLockMemory, pacingProcessor);
+    }
+    if (checkpoints && !reachesCheckpoints(checkpoints->getInterval())) {
+        fed.logWarningMessage(
+            "checkpoints need a fixed step that divides the checkpoint interval and start time");
+        checkpoints.reset();
+    }
+    if (checkpoints) {
+        nextCheckpoint = helics::Time(checkpoints->nextTime(static_cast<double>(timeBias)));
+        if (runAheadFrames > 0) {
+            fed.logWarningMessage("run-ahead stepping is not used with checkpoints");
+            runAheadFrames = 0;
+        }
+    }
+    if (checkpoints && speculativeStep) {
+        fed.logWarningMessage("speculative steps are not used with checkpoints");
+        speculativeStep = false;
+    }
+    if (speculativeStep && !realInputs.extrapolated.empty()) {
+        // a received value is only compared with the held value, not the prediction the step used
+        fed.logWarningMessage("speculative steps are not used with extrapolated inputs");
+        speculativeStep = false;
+    }
+    // run-ahead and speculative stepping replace the step loop
+    const bool buffered = !failed && runAheadFrames > 0;
+    const bool speculative = !failed && !buffered && speculativeStep;
+    if (buffered) {
+        runAheadSteps(stop);
+    } else if (speculative) {
+        runSpeculativeSteps(stop);
+    }
+    while (!failed && !buffered && !speculative && currentTime + timeBias + smallestStep <= stop) {
+        const auto stepStart = currentTime;
+        try {
+            currentTime = step(currentTime, stop);
+        }
+        catch (const fmiException& fe) {
+            fed.localError(56, fe.what());
+            break;
+        }
+        publishOutputs(stepOutputs);
+        publishOutputs(discreteOutputs);
+        publishGroups();
+        if (parametersUpdated) {
+            publishOutputs(tunableOutputs);
+        }
+        if (maxIterations > 0) {
+            try {
+                currentTime = iterateStep(stepStart, currentTime);
+            }
+            catch (const fmiException& fe) {
+                fed.localError(56, fe.what());
+                break;
+            }
+        }
+        if (captureWriter) {
+            captureOutputs(currentTime + timeBias);
+        }
+        updateSnapshot(currentTime + timeBias);
+        if (checkpoints && currentTime + timeBias >= nextCheckpoint) {
+            saveCheckpoint(currentTime + timeBias);
+            nextCheckpoint =
+                helics::Time(checkpoints->nextTime(static_cast<double>(currentTime + timeBias)));
+        }
+        parametersUpdated = false;
+        processCommands();
+        eventPending = grabInputs() || parametersUpdated;
+    }
+    if (captureWriter) {
+        try {
+            captureWriter->close();
+            LOG_FED_SUMMARY(fmt::format("captured {} rows of {} outputs",
+                                        captureWriter->rowCount(),
+                                        captureWriter->columnCount()));
+        }
+        catch (const std::runtime_error& e) {
+            LOG_FED_ERROR(fmt::format("error writing {}: {}", outputCaptureFile, e.what()));
+        }
+        captureWriter.reset();
+    }
+    if (recorder) {
+        recorder->close();
+        LOG_FED_SUMMARY(fmt::format(
+            "recorded {} inputs and steps to {}", recorder->getCount(), recorder->getFileName()));
+        recorder.reset();
+    }
+    if (stepState != nullptr) {
+        cs->freeFMUState(&stepState);
+    }
+    if (retryState != nullptr) {
+        cs->freeFMUState(&retryState);
+    }
+    if (discardedSteps > 0) {
+        LOG_FED_SUMMARY(fmt::format("retried discards in {} steps", discardedSteps));
+    }
+    if (pacer) {
+        logPacingSummary(fed, *pacer);
+    }
+    if (maxIterations > 0) {
+        LOG_FED_SUMMARY(fmt::format("repeated {} steps to converge the inputs", stepIterations));
+    }
+    if (speculative) {
+        LOG_FED_SUMMARY(fmt::format("{} speculative steps, {} kept, {} rolled back",
+                                    speculation.steps,
+                                    speculation.kept,
+                                    speculation.rolledBack));
+    }
+    if (outputStats.suppressed > 0) {
+        LOG_FED_SUMMARY(fmt::format(
+            "published {} output values, suppressed {} ({:.1f}%)",
+            outputStats.published,
+            outputStats.suppressed,
+            100.0 * static_cast<double>(outputStats.suppressed) /
+                static_cast<double>(outputStats.published + outputStats.suppressed)));
     }
     fed.finalize();
 }
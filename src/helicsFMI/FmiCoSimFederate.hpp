@@ -7,11 +7,22 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 
 #pragma once
 
+#include "FmiCheckpoint.hpp"
+#include "FmiHelics.hpp"
+#include "FmiQueries.hpp"
+#include "FmiRecorder.hpp"
 #include "fmi/fmi_import/fmiImport.h"
 #include "fmi/fmi_import/fmiObjects.h"
 #include "helics/ValueFederates.hpp"
+#include "utilities/columnCapture.h"
+#include "utilities/frameRing.h"
+#include "utilities/realTimePacer.h"
+#include "utilities/valuePredictor.hpp"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -21,6 +32,86 @@ class CoreApp;
 }
 
 namespace helicsfmi {
+/** counters for the output values passing through the publication filters*/
+struct OutputStatistics {
+    std::uint64_t published{0};  //!< the number of values published
+    std::uint64_t suppressed{0};  //!< the number of values suppressed by a deadband or unchanged
+};
+
+/** the methods for estimating the value of an input between updates*/
+enum class InputExtrapolation : std::uint8_t {
+    hold,  //!< the last received value is held until the next update
+    linear,  //!< the rate of change between the last two updates is extended
+    quadratic  //!< the quadratic through the last three updates is extended
+};
+
+/** buffers for transferring the real valued inputs to the FMU in a single call*/
+struct RealInputBatch {
+    std::vector<std::size_t> index;  //!< the indices of the batched inputs
+    std::vector<helics::DataType> types;  //!< the data type injected into each input
+    std::vector<double> raw;  //!< the last received values in the units of the source
+    std::vector<double> factor;  //!< unit conversion factors
+    std::vector<double> offset;  //!< unit conversion offsets
+    std::vector<double> values;  //!< the values in the units of the FMU
+    FmiVariableSet vrset;  //!< the value references of the batched inputs
+    std::vector<char> updated;  //!< flags for the inputs updated in the last transfer
+    std::vector<std::size_t> extrapolated;  //!< the batch positions of the extrapolated inputs
+    std::vector<InputExtrapolation> methods;  //!< the method of each extrapolated input
+    /// the predictors of the extrapolated inputs, created with the first update of the input
+    std::vector<std::unique_ptr<utilities::valuePredictor<double>>> predictors;
+    std::vector<double> predicted;  //!< the predicted values of the extrapolated inputs
+    std::vector<double> slopes;  //!< the first derivatives of the extrapolated inputs
+    std::vector<double> curvatures;  //!< the second derivatives of the extrapolated inputs
+    FmiVariableSet extrapolatedSet;  //!< the value references of the extrapolated inputs
+};
+
+/** the value published for an output when the FMU takes several sub-steps per federate step*/
+enum class OutputAggregation : std::uint8_t {
+    last,  //!< the value at the end of the step
+    average,  //!< the mean of the values at the end of each sub-step
+    minimum,  //!< the smallest value at the end of a sub-step
+    maximum  //!< the largest value at the end of a sub-step
+};
+
+/** buffers for aggregating the real valued outputs over the sub-steps of a federate step*/
+struct SubStepAggregate {
+    std::vector<std::size_t> index;  //!< the publication index of each aggregated output
+    std::vector<OutputAggregation> methods;  //!< the method of each aggregated output
+    std::vector<int> position;  //!< the aggregate of each publication or -1
+    FmiVariableSet vrset;  //!< the value references of the aggregated outputs
+    std::vector<double> values;  //!< the outputs after a sub-step
+    std::vector<double> results;  //!< the aggregated values
+    bool valid{false};  //!< the results cover a complete federate step
+};
+
+/** real valued FMU variables transferred as the elements of a single HELICS vector*/
+struct VariableGroup {
+    std::string name;  //!< the name of the vector interface
+    std::vector<std::string> variables;  //!< the names or patterns of the members
+    FmiVariableSet vrset;  //!< the value references of the members in element order
+    std::vector<double> values;  //!< the element values
+    bool sizeMismatch{false};  //!< a vector of the wrong size was received
+};
+
+/** the layout of the output frames read from the FMU before the time grant they are published at
+@details a frame holds the scalar outputs in publication order followed by the elements of each
+output group*/
+struct OutputFrames {
+    std::vector<std::size_t> index;  //!< the publication of each scalar value in a frame
+    std::vector<helics::DataType> types;  //!< the published type of each scalar value
+    std::size_t size{0};  //!< the number of values in a frame
+    std::unique_ptr<utilities::FrameRing> ring;  //!< the run-ahead frames waiting to be published
+    std::mutex commandLock;  //!< protects the commands waiting for the stepping thread
+    std::vector<std::string> commands;  //!< the commands received at the grants of a run-ahead
+};
+
+/** counters for the steps computed speculatively while waiting for a time grant*/
+struct SpeculationStatistics {
+    std::uint64_t steps{0};  //!< the number of speculative steps started
+    std::uint64_t kept{0};  //!< the steps kept because the inputs matched the prediction
+    std::uint64_t rolledBack{0};  //!< the steps rolled back and recomputed after the grant
+};
+
 /** class defining a co-simulation federate*/
 class CoSimFederate {
   private:
@@ -31,10 +122,80 @@ class CoSimFederate {
     std::vector<std::string> connections;
     std::vector<helics::Publication> pubs;  //!< known publications
     std::vector<helics::Input> inputs;  //!< known inputs
+    std::vector<OutputFilter> outputFilters;  //!< deadband filters matching the publications
+    RealInputBatch realInputs;  //!< buffers for the real valued inputs
+    std::vector<std::size_t> otherInputs;  //!< the inputs which are not real valued
+    std::vector<std::size_t> updatedInputs;  //!< the inputs updated in the last transfer
+    OutputDependencies dependencies;  //!< the output dependency graph
+    std::vector<std::size_t> stepOutputs;  //!< the outputs read and published every step
+    std::vector<std::size_t> discreteOutputs;  //!< the outputs published when they change
+    std::vector<std::size_t> tunableOutputs;  //!< the outputs published after a parameter is set
+    std::vector<bool> connectedOutputs;  //!< flags for the publications with subscribers
+    std::vector<VariableGroup> outputGroups;  //!< outputs published as vectors
+    std::vector<VariableGroup> inputGroups;  //!< inputs received as vectors
+    std::vector<helics::Publication> groupPubs;  //!< the publications of the output groups
+    std::vector<helics::Input> groupInputs;  //!< the inputs of the input groups
     helics::Time stepTime{helics::timeEpsilon};  //!< the step time for the Federate
     helics::Time timeBias{helics::timeZero};  //!< time shift for the federate
+    helics::Time minStepTime{helics::timeZero};  //!< the smallest step in adaptive mode
+    helics::Time maxStepTime{helics::timeZero};  //!< the largest step in adaptive mode
+    helics::Time nextStepTime{helics::timeZero};  //!< the next step size in adaptive mode
+    double stepTolerance{1e-3};  //!< the relative error tolerance for adaptive steps
+    StepController stepControl;  //!< the step size controller for adaptive mode
+    FmiVariableSet stepMonitorSet;  //!< the real outputs used to estimate the step error
+    std::vector<double> stepMonitorValues;  //!< buffer for the monitored output values
+    helics::Time subStepTime{helics::timeZero};  //!< the requested FMU step within a federate step
+    int subStepCount{1};  //!< the number of FMU steps per federate step
+    OutputAggregation aggregation{OutputAggregation::last};  //!< the default output aggregation
+    SubStepAggregate aggregates;  //!< the outputs aggregated over the sub-steps
+    fmi2FMUstate stepState{nullptr};  //!< the FMU state at the start of the current step
+    int maxIterations{0};  //!< the maximum number of repeats of a step, 0 disables iteration
+    double iterationTolerance{1e-6};  //!< the input change that triggers a repeated step
+    std::uint64_t stepIterations{0};  //!< the number of repeated steps
+    int maxDiscardRetries{0};  //!< the number of smaller steps tried after a discard, 0 disables
+    bool discardRollback{false};  //!< restore the FMU state before retrying a discarded step
+    double retryStepSize{0.0};  //!< the reduced step size after a discard, 0 for the full step
+    fmi2FMUstate retryState{nullptr};  //!< the FMU state at the start of a retried step
+    std::uint64_t discardedSteps{0};  //!< the number of federate steps with a discard
+    InputExtrapolation extrapolation{InputExtrapolation::hold};  //!< the default input method
+    double outputAbsTolerance{0.0};  //!< default absolute deadband for numeric outputs
+    double outputRelTolerance{0.0};  //!< default relative deadband for numeric outputs
+    OutputStatistics outputStats;
     std::string outputCaptureFile;
+    std::unique_ptr<utilities::ColumnCapture> captureWriter;  //!< the output capture file writer
+    FmiVariableSet captureReals;  //!< the real valued outputs to capture
+    FmiVariableSet captureIntegers;  //!< the integer and enumeration outputs to capture
+    std::vector<FmiVariable> captureBooleans;  //!< the boolean outputs to capture
+    std::vector<double> captureValues;  //!< buffer for a row of captured values
+    std::vector<fmi2Integer> captureIntegerValues;  //!< buffer for the captured integers
     bool captureOutput{false};
+    std::unique_ptr<utilities::RealTimePacer> pacer;  //!< aligns the steps with the wall clock
+    int pacingProcessor{-1};  //!< the processor for the stepping thread, -1 to leave it unpinned
+    bool pacingLockMemory{false};  //!< lock the process memory before paced stepping
+    std::shared_ptr<CheckpointWriter> checkpoints;  //!< receives the periodic checkpoints
+    helics::Time nextCheckpoint{helics::Time::maxVal()};  //!< the time of the next checkpoint
+    std::unique_ptr<FederateCheckpoint> restorePoint;  //!< the checkpoint to resume from
+    std::size_t runAheadFrames{0};  //!< the steps computed ahead of the grants, 0 disables
+    OutputFrames frames;  //!< the output frames of run-ahead and speculative steps
+    bool speculativeStep{false};  //!< step ahead with the held inputs while waiting for grants
+    double speculationTolerance{1e-6};  //!< the input change that rolls back a speculative step
+    SpeculationStatistics speculation;
+    std::shared_ptr<VariableQueries> queries;  //!< answers the variable queries
+    std::string inputRecordFile;  //!< the file receiving the applied inputs, empty disables it
+    std::unique_ptr<InputRecorder> recorder;  //!< writes the applied inputs and the FMU steps
+    std::vector<std::uint32_t> recordedInputs;  //!< the recorded variable of each input
+    std::vector<std::vector<std::uint32_t>> recordedGroups;  //!< the variables of input groups
+    bool adaptiveStep{false};  //!< adjust the step size to the rate of change of the outputs
+    bool eventDriven{false};  //!< only step the FMU when an input is updated
+    bool variableSteps{false};  //!< the FMU can handle variable communication step sizes
+    bool eventPending{true};  //!< an input or parameter changed since the last step
+    bool connectedOutputsOnly{false};  //!< only update publications that have subscribers
+    bool parametersUpdated{false};  //!< a parameter was set since the outputs were published
+    bool interpolateInputs{false};  //!< the FMU accepts input derivatives over a step
+    bool secondOrderInputs{false};  //!< an input uses quadratic extrapolation
+    bool configured{false};  //!< the interfaces have been configured
+    bool interfaceTiming{false};  //!< set the HELICS timing flags from the configured interfaces
+    bool variableQueries{true};  //!< answer queries for the values of FMU variables
     int logLevel{HELICS_LOG_LEVEL_SUMMARY};
 
   public:
@@ -58,9 +219,15 @@ class CoSimFederate {
     void loadFromFile(const std::string& configFile);
     /** configure the federate using the specified inputs and outputs*/
     void configure(helics::Time step, helics::Time start = helics::timeZero);
-    /** set a string list of inputs*/
+    /** check if the federate interfaces have been configured*/
+    [[nodiscard]] bool isConfigured() const { return configured; }
+    /** set a string list of inputs
+    @details names containing '*' or '?' are glob patterns and names prefixed with "regex:" are
+    regular expressions, which are replaced by the matching FMU inputs when configured*/
     void setInputs(std::vector<std::string> input_names);
-    /** set a string list of outputs*/
+    /** set a string list of outputs
+    @details patterns are matched against the outputs and the local variables that can be
+    published*/
     void setOutputs(std::vector<std::string> output_names);
     /** set a list of connections*/
     void setConnections(std::vector<std::string> conn);
@@ -70,17 +237,159 @@ class CoSimFederate {
     void addOutput(const std::string& output_name);
     /** add a connection*/
     void addConnection(const std::string& conn);
-    /** set the capture file*/
+    /** publish a group of real valued outputs as a single vector publication
+    @details the variables are names or patterns in the same form as setOutputs, the element order
+    of the vector is the order of the matching variables when configured, grouped variables do not
+    get their own publications, the "elements" tag of the publication lists the variable names
+    @param name the name of the publication
+    @param variables the outputs in the group*/
+    void addOutputGroup(const std::string& name, std::vector<std::string> variables);
+    /** receive a group of real valued inputs as a single vector input
+    @details the elements of the received vector are set on the matching variables in order, no
+    unit conversion or extrapolation is applied to grouped inputs
+    @param name the name of the input
+    @param variables the inputs in the group*/
+    void addInputGroup(const std::string& name, std::vector<std::string> variables);
+    /** set the capture file
+    @details the numeric outputs are captured after every step, the format is selected by the
+    extension of the file, .hcap for binary columns, .hcapz for compressed binary columns, and csv
+    otherwise, the default file is the federate name with a .csv extension*/
     void setOutputCapture(bool capture = true, const std::string& outputFile = "");
+    /** set the default deadband applied to numeric outputs before publication
+    @details the publication tags "absolute_tolerance" and "relative_tolerance" override the
+    defaults for an individual publication, relative tolerances are scaled by the larger of the
+    last published value and the nominal value of the FMU variable
+    */
+    void setOutputTolerance(double absoluteTolerance, double relativeTolerance = 0.0);
+    /** enable adaptive communication steps between a minimum and maximum step size
+    @details the FMU must be able to handle variable communication step sizes, a zero maximum step
+    disables adaptive stepping, a zero minimum uses the configured step time as the minimum
+    @param minStep the smallest step to take
+    @param maxStep the largest step to take
+    @param tolerance the relative error tolerance for the change in the outputs over a step
+    */
+    void setAdaptiveStep(helics::Time minStep, helics::Time maxStep, double tolerance = 1e-3);
+    /** step the FMU several times between federate time grants
+    @details the federate period is the configured step time and the FMU takes steps of about the
+    sub-step size, adjusted so a whole number of sub-steps fit in the period, inputs are held or
+    extrapolated over the sub-steps and outputs are only published at the federate period, a zero
+    sub-step disables sub-stepping, sub-steps require a fixed step size
+    @param subStep the FMU step size
+    @param method the default value published for the real valued continuous outputs, the
+    publication tag "aggregation" overrides it for an individual publication
+    */
+    void setSubStep(helics::Time subStep, OutputAggregation method = OutputAggregation::last);
+    /** get the number of FMU steps per federate step*/
+    [[nodiscard]] int getSubStepCount() const { return subStepCount; }
+    /** repeat each step with the inputs from the end of the step until they converge
+    @details the FMU state is saved before each step and restored if the inputs received in a
+    HELICS iteration at the end of the step differ from the inputs used by more than
+    tolerance*max(1,|value|), the FMU must be able to get and set its state and a fixed step is
+    required
+    @param iterations the maximum number of times a step is repeated, 0 disables iteration
+    @param tolerance the input convergence tolerance
+    */
+    void setIterativeStep(int iterations, double tolerance = 1e-6);
+    /** retry a step the FMU discards with smaller steps instead of stopping the federate
+    @details the FMU must be able to handle variable communication step sizes, the failed step is
+    rolled back if the FMU can get and set its state, otherwise the FMU continues from its last
+    successful time and the federate stops if the FMU cannot report it, the step is reduced to
+    the interval the FMU completed or halved and grows back by doubling after each successful step
+    @param retries the number of discards in a single step before the federate stops, 0 disables
+    retries*/
+    void setDiscardRetry(int retries) { maxDiscardRetries = std::max(retries, 0); }
+    /** get the number of federate steps in which the FMU discarded a step that was retried*/
+    [[nodiscard]] std::uint64_t getDiscardedSteps() const { return discardedSteps; }
+    /** set the default method for estimating the real valued inputs between updates
+    @details the input tag "extrapolation" overrides the default for an individual input, FMUs that
+    can interpolate inputs are given the value and derivatives at the start of each step, other
+    FMUs are given the predicted value at the middle of the step*/
+    void setInputExtrapolation(InputExtrapolation method) { extrapolation = method; }
+    /** align each step with the wall clock
+    @details the federate sleeps before each time request until the wall clock reaches the
+    requested time, the lateness, overruns, and compute times of the steps are logged when the
+    federate finishes, pacing is not used in event triggered mode
+    @param scale the wall clock seconds per simulated second, 1.0 is real time, 0 disables pacing
+    @param lockMemory lock the process memory into RAM to avoid page faults while stepping
+    @param processor pin the stepping thread to a processor, -1 to leave it unpinned*/
+    void setRealTimePacing(double scale, bool lockMemory = false, int processor = -1);
+    /** get the timing statistics of the paced steps*/
+    [[nodiscard]] utilities::PacingStatistics getPacingStatistics() const
+    {
+        return pacer ? pacer->getStatistics() : utilities::PacingStatistics{};
+    }
+    /** save the state of the FMU and the last published values at regular times
+    @details a checkpoint is taken at the end of each step reaching a multiple of the interval of
+    the writer, the federates sharing a writer must reach the same checkpoint times so a federate
+    that does not reach them all disables its checkpoints with a warning, the FMU must be able to
+    serialize its state
+    @param writer the writer collecting the checkpoints of every federate of the run, null
+    disables checkpoints*/
+    void setCheckpoint(std::shared_ptr<CheckpointWriter> writer)
+    {
+        checkpoints = std::move(writer);
+    }
+    /** check if the FMU can save and restore a serialized state*/
+    [[nodiscard]] bool canCheckpoint() const;
+    /** check if the federate steps exactly to every multiple of a checkpoint interval
+    @details this requires fixed steps that divide the interval and the start time*/
+    [[nodiscard]] bool reachesCheckpoints(double interval) const;
+    /** resume the federate from a checkpoint when it is run
+    @details the federate starts at the checkpoint time, the last published values are published
+    during initialization and the FMU state is restored when entering step mode*/
+    void restoreCheckpoint(FederateCheckpoint point);
+    /** step an FMU without inputs ahead of the time grants on a background thread
+    @details the outputs of each step are stored in a ring of frames and published when the
+    federate is granted the time of the step, the FMU stops when the ring is full until a frame is
+    published, requires a federate without inputs or string publications using fixed steps without
+    iteration, commands are not run while stepping ahead and checkpoints disable it
+    @param frameCount the number of steps that can be computed ahead, 0 disables run-ahead*/
+    void setRunAhead(std::size_t frameCount) { runAheadFrames = frameCount; }
+    /** set the input change that rolls back a speculative step
+    @details with the flag "speculative_step" the outputs of each step are read before the time
+    request, the FMU state is saved and the next step is computed with the held inputs while
+    waiting for the grant, the step is kept if no input differs from the value used by
+    more than tolerance*max(1,|value|) and no command was received, otherwise the state is restored
+    and the step is computed again, the FMU must be able to get and set its state, speculative steps
+    require fixed steps without iteration and no string publications and are not used with
+    checkpoints or extrapolated inputs*/
+    void setSpeculationTolerance(double tolerance) { speculationTolerance = tolerance; }
+    /** get the counters of the speculative steps*/
+    [[nodiscard]] const SpeculationStatistics& getSpeculationStatistics() const
+    {
+        return speculation;
+    }
+    /** record every value applied to the FMU and every step it takes to a file
+    @details the parameter values at initialization, the received inputs in FMU units, the
+    extrapolated inputs and their derivatives, and the values set by commands are recorded with
+    their times along with the steps of the FMU, the recording is replayed by
+    StandaloneCoSim::replay without HELICS, the values and steps undone by iteration or speculation
+    are discarded when the recording is loaded and recording is not used when resuming from a
+    checkpoint
+    @param file the recording file, empty disables recording*/
+    void setInputRecord(const std::string& file) { inputRecordFile = file; }
+    /** get the number of steps repeated by iteration*/
+    [[nodiscard]] std::uint64_t getStepIterations() const { return stepIterations; }
+    /** get the counters of published and suppressed output values*/
+    const OutputStatistics& getOutputStatistics() const { return outputStats; }
     /** run a command on the cosim object*/
-    void runCommand(const std::string& command);
+    void runCommand(const std::string& command) { applyCommand(command, recordTime()); }
     /** set a parameter*/
     template<typename... Args>
     void set(Args&&... args)
     {
         cs->set(std::forward<Args>(args)...);
+        parametersUpdated = true;
     }
-    /** set flags on the object or federate*/
+    /** set flags on the object or federate
+    @details "connected_outputs_only" restricts the outputs read from the FMU and published to
+    those with at least one subscriber once the connections are resolved, "event_triggered" only
+    steps the FMU when an input is updated, "speculative_step" computes the next step while waiting
+    for a time grant, "interface_timing" marks a federate without inputs as source
+    only and a federate without publications as an observer when it is configured so the time
+    coordinator does not wait on it, "variable_queries" (on by default) answers the queries
+    "value/<name>", "values/<pattern>", and "stats" from a snapshot of the queried variables taken
+    after each step*/
     bool setFlag(const std::string& flag, bool val);
     /** run the cosimulation*/
     void run(helics::Time stop);
@@ -90,8 +399,127 @@ class CoSimFederate {
     void logMessage(int logLevel, std::string_view message);
 
   private:
-    double initialize(double stop, std::ofstream& ofile);
+    double initialize(double stop);
+    /** open the capture file for the numeric outputs*/
+    void loadCapture();
+    /** capture the current values of the numeric outputs*/
+    void captureOutputs(helics::Time time);
     void loadFMUInformation();
+    /** match the configured inputs to FMU variables and create the remaining listed inputs*/
+    void configureInputs();
+    /** match the configured publications to FMU variables and create the remaining listed
+    publications*/
+    void configureOutputs();
+    /** resolve the members of a set of groups and remove them from a variable list
+    @param groups the groups to resolve
+    @param candidates the variables which can be members
+    @param list the variables given scalar interfaces*/
+    void loadGroups(std::vector<VariableGroup>& groups,
+                    const std::vector<std::string>& candidates,
+                    std::vector<std::string>& list);
+    /** add a record of the FMU state and the last published values to the checkpoint writer*/
+    void saveCheckpoint(helics::Time time);
+    /** get the last published value of a publication as a string*/
+    std::string getPublishedValue(std::size_t index);
+    /** publish the values recorded in the restore point*/
+    void publishCheckpoint();
+    /** set the FMU state recorded in the restore point*/
+    void restoreState();
+    /** step the FMU on a background thread and publish the frames at the time grants*/
+    void runAheadSteps(helics::Time stop);
+    /** step the FMU speculatively while waiting for each time grant*/
+    void runSpeculativeSteps(helics::Time stop);
+    /** generate the layout of the output frames
+    @param tunable include the tunable outputs, which change when a command sets a parameter*/
+    void loadFrames(bool tunable);
+    /** run the commands received at the grants on the stepping thread
+    @param time the time of the step the commands apply to*/
+    void runQueuedCommands(helics::Time time);
+    /** step the FMU and fill a frame for each step until the stop time or the ring is closed
+    @param error set to the message of an FMU error that stopped the stepping*/
+    void computeFrames(helics::Time stop, std::string& error);
+    /** read the outputs of the FMU into a frame*/
+    void readFrame(double* frame);
+    /** publish the values of a frame that pass their output filters*/
+    void publishFrame(const double* frame);
+    /** read and publish every output group*/
+    void publishGroups();
+    /** set the elements of the updated input groups
+    @return true if any group was updated*/
+    bool grabGroups();
+    /** install the query callback answering variable queries*/
+    void loadQueries();
+    /** open the input recording and write the names of the inputs
+    @param stop the duration of the simulation*/
+    void loadRecorder(double stop);
+    /** record the current values of the parameters of the FMU*/
+    void recordParameters();
+    /** record the current value of a variable set on the FMU*/
+    void recordVariable(const FmiVariable& var, std::uint32_t variable, double time);
+    /** get the time of the values applied to the FMU for the recording*/
+    double recordTime();
+    /** run a command on the cosim object
+    @param time the time the command is recorded at*/
+    void applyCommand(const std::string& command, double time);
+    /** update the snapshot of the queried variables after a step*/
+    void updateSnapshot(helics::Time time);
+    /** set the HELICS timing flags that follow from the configured interfaces*/
+    void setInterfaceTiming();
+    /** generate the deadband filters for the publications*/
+    void loadOutputFilters();
+    /** publish an output if it has changed by more than its deadband*/
+    void publishOutput(std::size_t index);
+    /** advance the FMU and the federate by a single step
+    @return the new federate time*/
+    helics::Time step(helics::Time currentTime, helics::Time stop);
+    /** repeat a step while the inputs received at the end of the step have not converged
+    @return the federate time after the iteration, later than the end of the step if the
+    federate was granted a later time and the FMU was stepped to it*/
+    helics::Time iterateStep(helics::Time stepStart, helics::Time stepEnd);
+    /** check if any updated input differs from the value used in the last step by more than a
+    tolerance without transferring the inputs to the FMU*/
+    bool inputsChanged(double tolerance);
+    /** step the FMU from the current time to a later time
+    @details uses a single step if the FMU can handle variable step sizes otherwise steps of the
+    configured step time*/
+    void stepTo(helics::Time currentTime, helics::Time nextTime);
+    /** advance the FMU over a federate step using the configured sub-steps*/
+    void stepPeriod(helics::Time periodStart, bool noSetFMUStatePriorToCurrentPoint);
+    /** load the aggregation of the outputs over the sub-steps*/
+    void loadAggregates();
+    /** extrapolate the inputs over a step and advance the FMU*/
+    void stepFMU(helics::Time stepStart,
+                 helics::Time stepSize,
+                 bool noSetFMUStatePriorToCurrentPoint);
+    /** advance the FMU over a step and retry any discarded part of it with smaller steps*/
+    void retryDiscardedSteps(helics::Time stepStart,
+                             helics::Time stepSize,
+                             bool noSetFMUStatePriorToCurrentPoint);
+    /** set the predicted values of the extrapolated inputs for a step*/
+    void extrapolateInputs(helics::Time stepStart, helics::Time stepSize);
+    /** load the outputs used to estimate the error of an adaptive step*/
+    void loadStepMonitor();
+    /** partition the publications by the conditions under which their values can change*/
+    void loadOutputPlan();
+    /** run any commands sent to the federate*/
+    void processCommands();
+    /** remove the publications without subscribers from the output plan*/
+    void removeUnconnectedOutputs();
+    /** publish a set of outputs*/
+    void publishOutputs(const std::vector<std::size_t>& outputIndices);
+    /** generate the input batch and the unit conversions from the connected sources*/
+    void loadInputBatch();
+    /** transfer any updated inputs to the FMU and record them in updatedInputs
+    @return true if any input was updated*/
+    bool grabInputs();
 };
 
+/** get the input extrapolation method from a string (hold, linear, quadratic)
+@throw Error if the string is not a valid method*/
+InputExtrapolation getInputExtrapolation(std::string_view method);
+
+/** get the output aggregation method from a string (last, average, min, max)
+@throw Error if the string is not a valid method*/
+OutputAggregation getOutputAggregation(std::string_view method);
+
 }  // namespace helicsfmi
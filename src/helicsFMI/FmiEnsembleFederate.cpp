@@ -0,0 +1,345 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "FmiEnsembleFederate.hpp"
+
+#include "FmiHelicsLogging.hpp"
+#include "gmlc/utilities/stringConversion.h"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <utility>
+
+namespace helicsfmi {
+
+EnsembleFederate::EnsembleFederate(std::string_view name,
+                                   std::shared_ptr<FmiLibrary> fmi,
+                                   std::size_t count,
+                                   const helics::FederateInfo& fedInfo):
+    fed(name, fedInfo),
+    library(std::move(fmi))
+{
+    createInstances(count);
+}
+
+EnsembleFederate::EnsembleFederate(std::string_view name,
+                                   std::shared_ptr<FmiLibrary> fmi,
+                                   std::size_t count,
+                                   helics::CoreApp& core,
+                                   const helics::FederateInfo& fedInfo):
+    fed(name, core, fedInfo),
+    library(std::move(fmi))
+{
+    createInstances(count);
+}
+
+void EnsembleFederate::createInstances(std::size_t count)
+{
+    if (!library || !library->checkFlag(fmuCapabilityFlags::coSimulationCapable)) {
+        throw(Error("EnsembleFederate", "FMU is not co-simulation capable", -101));
+    }
+    instances.reserve(count);
+    for (std::size_t ii = 0; ii < count; ++ii) {
+        auto obj = library->createCoSimulationObject(fmt::format("{}_{}", fed.getName(), ii));
+        if (!obj) {
+            throw(Error("EnsembleFederate", "unable to create co-simulation instance", -101));
+        }
+        instances.push_back(std::move(obj));
+    }
+    if (!instances.empty()) {
+        // the messages from every instance go to the single federate log
+        instances.front()->getLogger()->setLoggerCallback(
+            [this](std::string_view category, std::string_view message) {
+                fed.logMessage(fmiCategory2HelicsLogLevel(category), message);
+            });
+        input_list = instances.front()->getInputNames();
+        output_list = instances.front()->getOutputNames();
+    }
+}
+
+std::string EnsembleFederate::getInterfaceName(std::string_view variable, std::size_t index)
+{
+    return fmt::format("{}[{}]", variable, index);
+}
+
+std::pair<std::string, std::size_t>
+    EnsembleFederate::parseInterfaceName(const std::string& name) const
+{
+    if (name.empty() || name.back() != ']') {
+        return {name, allInstances};
+    }
+    const auto open = name.find_last_of('[');
+    if (open == std::string::npos) {
+        return {name, allInstances};
+    }
+    const auto index = gmlc::utilities::numeric_conversionComplete<std::size_t>(
+        name.substr(open + 1, name.size() - open - 2), instances.size());
+    if (index >= instances.size()) {
+        throw(Error("EnsembleFederate", fmt::format("{} is not a valid instance", name), -102));
+    }
+    return {name.substr(0, open), index};
+}
+
+void EnsembleFederate::setInputs(std::vector<std::string> input_names)
+{
+    input_list = std::move(input_names);
+}
+
+void EnsembleFederate::setOutputs(std::vector<std::string> output_names)
+{
+    output_list = std::move(output_names);
+}
+
+void EnsembleFederate::configure(helics::Time step, helics::Time startTime)
+{
+    timeBias = startTime;
+    logLevel = fed.getIntegerProperty(HELICS_PROPERTY_INT_LOG_LEVEL);
+    if (instances.empty()) {
+        return;
+    }
+    // every instance is configured identically so the first one defines the types and units
+    auto& first = *instances.front();
+    if (std::any_of(input_list.begin(), input_list.end(), isVariablePattern)) {
+        input_list =
+            expandVariablePatterns(input_list, first.fmuInformation().getVariableNames("input"));
+    }
+    if (std::any_of(output_list.begin(), output_list.end(), isVariablePattern)) {
+        output_list = expandVariablePatterns(output_list, first.getAvailableOutputNames());
+    }
+    first.reserveVariables(input_list.size(), output_list.size());
+    std::vector<std::string> activeInputs;
+    for (const auto& input : input_list) {
+        if (first.addInputVariable(input).index >= 0) {
+            activeInputs.push_back(input);
+        } else {
+            fed.logWarningMessage(input + " is not a recognized input");
+        }
+    }
+    std::vector<std::string> activeOutputs;
+    for (const auto& output : output_list) {
+        if (first.addOutputVariable(output).index >= 0) {
+            activeOutputs.push_back(output);
+        } else {
+            fed.logWarningMessage(output + " is not a recognized output");
+        }
+    }
+    for (std::size_t ii = 1; ii < instances.size(); ++ii) {
+        auto& instance = *instances[ii];
+        instance.reserveVariables(activeInputs.size(), activeOutputs.size());
+        for (std::size_t kk = 0; kk < activeInputs.size(); ++kk) {
+            instance.addInputVariable(first.getInput(static_cast<int>(kk)).index);
+        }
+        for (std::size_t kk = 0; kk < activeOutputs.size(); ++kk) {
+            instance.addOutputVariable(first.getOutput(static_cast<int>(kk)).index);
+        }
+    }
+    const auto& info = first.fmuInformation();
+    realInputs.clear();
+    otherInputs.clear();
+    realInputSet.clear();
+    for (std::size_t kk = 0; kk < activeInputs.size(); ++kk) {
+        const auto& var = first.getInput(static_cast<int>(kk));
+        if (var.type == +fmi_variable_type::real) {
+            realInputs.push_back(kk);
+            realInputSet.push(var.vRef);
+        } else {
+            otherInputs.push_back(kk);
+        }
+    }
+    realOutputs.clear();
+    otherOutputs.clear();
+    realOutputSet.clear();
+    for (std::size_t kk = 0; kk < activeOutputs.size(); ++kk) {
+        const auto& var = first.getOutput(static_cast<int>(kk));
+        if (var.type == +fmi_variable_type::real) {
+            realOutputs.push_back(kk);
+            realOutputSet.push(var.vRef);
+        } else {
+            otherOutputs.push_back(kk);
+        }
+    }
+
+    inputs.reserve(instances.size() * activeInputs.size());
+    pubs.reserve(instances.size() * activeOutputs.size());
+    for (std::size_t ii = 0; ii < instances.size(); ++ii) {
+        for (std::size_t kk = 0; kk < activeInputs.size(); ++kk) {
+            const auto& var = first.getInput(static_cast<int>(kk));
+            inputs.emplace_back(&fed,
+                                getInterfaceName(activeInputs[kk], ii),
+                                getHelicsType(var.type),
+                                info.getVariableInfo(var.index).unit);
+        }
+        for (std::size_t kk = 0; kk < activeOutputs.size(); ++kk) {
+            const auto& var = first.getOutput(static_cast<int>(kk));
+            pubs.emplace_back(&fed,
+                              getInterfaceName(activeOutputs[kk], ii),
+                              getHelicsType(var.type),
+                              info.getVariableInfo(var.index).unit);
+        }
+    }
+    realInputValues.assign(instances.size() * realInputs.size(), 0.0);
+    realOutputValues.assign(instances.size() * realOutputs.size(), 0.0);
+    inputUpdated.assign(instances.size(), 0);
+
+    const auto& def = info.getExperiment();
+    if (step <= helics::timeZero) {
+        step = def.stepSize;
+    }
+    if (step <= helics::timeZero) {
+        auto tstep = fed.getTimeProperty(HELICS_PROPERTY_TIME_PERIOD);
+        step = (tstep > helics::timeEpsilon) ? tstep : helics::Time(0.2);
+    }
+    stepTime = step;
+    fed.setProperty(HELICS_PROPERTY_TIME_PERIOD, step);
+    LOG_FED_SUMMARY(fmt::format("\n  ensemble federate:\n\t{} instances\n\t{} inputs and {} "
+                                "outputs per instance\n\tstep size={}",
+                                instances.size(),
+                                activeInputs.size(),
+                                activeOutputs.size(),
+                                static_cast<double>(stepTime)));
+}
+
+bool EnsembleFederate::setFlag(const std::string& flag, bool val)
+{
+    bool used{false};
+    for (auto& instance : instances) {
+        used = instance->setFlag(flag, val) || used;
+    }
+    if (used) {
+        return true;
+    }
+    const int param = helics::getFlagIndex(flag);
+    if (param != HELICS_INVALID_OPTION_INDEX) {
+        fed.setFlagOption(param, val);
+        return true;
+    }
+    return false;
+}
+
+void EnsembleFederate::logMessage(int helicsLogLevel, std::string_view message)
+{
+    fed.logMessage(helicsLogLevel, message);
+}
+
+double EnsembleFederate::initialize(double stop)
+{
+    const auto& def = library->getInfo()->getExperiment();
+
+    if (stop <= helics::timeZero) {
+        stop = def.stopTime;
+    }
+    if (stop <= helics::timeZero) {
+        stop = 30.0;
+    }
+    if (!pool) {
+        pool = std::make_unique<utilities::WorkStealingPool>(threadCount);
+    }
+    for (auto& instance : instances) {
+        instance->setupExperiment(
+            false, 0, static_cast<double>(timeBias), true, static_cast<double>(timeBias + stop));
+    }
+    fed.enterInitializingMode();
+    pool->parallelFor(instances.size(), [this](std::size_t ii) {
+        instances[ii]->setMode(FmuMode::INITIALIZATION);
+    });
+    const std::size_t outputCount = realOutputs.size() + otherOutputs.size();
+    const std::size_t inputCount = realInputs.size() + otherInputs.size();
+    for (std::size_t ii = 0; ii < instances.size(); ++ii) {
+        for (std::size_t kk = 0; kk < outputCount; ++kk) {
+            helicsfmi::publishOutput(pubs[ii * outputCount + kk], instances[ii].get(), kk);
+        }
+        for (std::size_t kk = 0; kk < inputCount; ++kk) {
+            helicsfmi::setDefault(inputs[ii * inputCount + kk], instances[ii].get(), kk);
+        }
+    }
+    LOG_FED_SUMMARY(fmt::format("stepping {} instances on {} threads",
+                                instances.size(),
+                                pool->threadCount()));
+    return stop;
+}
+
+void EnsembleFederate::grabInputs()
+{
+    const bool logValues = logLevel >= HELICS_LOG_LEVEL_DATA;
+    const std::size_t inputCount = realInputs.size() + otherInputs.size();
+    const std::size_t realCount = realInputs.size();
+    for (std::size_t ii = 0; ii < instances.size(); ++ii) {
+        auto* instanceInputs = inputs.data() + ii * inputCount;
+        double* values = realInputValues.data() + ii * realCount;
+        for (std::size_t jj = 0; jj < realCount; ++jj) {
+            auto& inp = instanceInputs[realInputs[jj]];
+            if (inp.isUpdated()) {
+                values[jj] = inp.getValue<double>();
+                inputUpdated[ii] = 1;
+            }
+        }
+        // the non-real inputs are rare enough that they are set directly from this thread
+        for (auto index : otherInputs) {
+            helicsfmi::grabInput(instanceInputs[index], instances[ii].get(), index, logValues);
+        }
+    }
+}
+
+void EnsembleFederate::stepInstances(helics::Time currentTime)
+{
+    const auto stepStart = static_cast<double>(currentTime + timeBias);
+    const auto stepSize = static_cast<double>(stepTime);
+    const std::size_t realInputCount = realInputs.size();
+    const std::size_t realOutputCount = realOutputs.size();
+    pool->parallelFor(instances.size(), [&](std::size_t ii) {
+        auto& instance = *instances[ii];
+        if (inputUpdated[ii] != 0) {
+            instance.set(realInputSet, realInputValues.data() + ii * realInputCount);
+            inputUpdated[ii] = 0;
+        }
+        instance.doStep(stepStart, stepSize, fmi2True);
+        if (realOutputCount > 0) {
+            instance.get(realOutputSet, realOutputValues.data() + ii * realOutputCount);
+        }
+    });
+}
+
+void EnsembleFederate::publishOutputs()
+{
+    const std::size_t outputCount = realOutputs.size() + otherOutputs.size();
+    const std::size_t realCount = realOutputs.size();
+    for (std::size_t ii = 0; ii < instances.size(); ++ii) {
+        auto* instancePubs = pubs.data() + ii * outputCount;
+        const double* values = realOutputValues.data() + ii * realCount;
+        for (std::size_t jj = 0; jj < realCount; ++jj) {
+            instancePubs[realOutputs[jj]].publish(values[jj]);
+        }
+        for (auto index : otherOutputs) {
+            helicsfmi::publishOutput(instancePubs[index], instances[ii].get(), index);
+        }
+    }
+}
+
+void EnsembleFederate::run(helics::Time stop)
+{
+    stop = initialize(stop);
+    fed.enterExecutingMode();
+    pool->parallelFor(instances.size(),
+                      [this](std::size_t ii) { instances[ii]->setMode(FmuMode::STEP); });
+    grabInputs();
+
+    helics::Time currentTime = helics::timeZero;
+    while (currentTime + timeBias + stepTime <= stop) {
+        try {
+            stepInstances(currentTime);
+        }
+        catch (const fmiException& fe) {
+            fed.localError(56, fe.what());
+            break;
+        }
+        currentTime = fed.requestNextStep();
+        publishOutputs();
+        grabInputs();
+    }
+    fed.finalize();
+}
+}  // namespace helicsfmi
@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "FmiHelics.hpp"
+#include "fmi/fmi_import/fmiImport.h"
+#include "fmi/fmi_import/fmiObjects.h"
+#include "helics/ValueFederates.hpp"
+#include "utilities/workStealingPool.h"
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace helics {
+class CoreApp;
+}
+
+namespace helicsfmi {
+
+/** class defining a federate containing many co-simulation instances of a single FMU
+@details every instance has the same inputs and outputs, which are registered in a single HELICS
+federate with the instance index appended to the variable name, i.e. "output[3]", the instances
+are stepped in parallel on a thread pool after each time grant*/
+class EnsembleFederate {
+  private:
+    helics::ValueFederate fed;  //!< the federate
+    std::shared_ptr<FmiLibrary> library;  //!< the library used to create the instances
+    std::vector<std::unique_ptr<fmi2CoSimObject>> instances;
+    std::vector<std::string> input_list;
+    std::vector<std::string> output_list;
+    std::vector<helics::Publication> pubs;  //!< publications ordered by instance then output
+    std::vector<helics::Input> inputs;  //!< inputs ordered by instance then input
+    FmiVariableSet realInputSet;  //!< the real valued inputs of each instance
+    FmiVariableSet realOutputSet;  //!< the real valued outputs of each instance
+    std::vector<std::size_t> realInputs;  //!< the indices of the real valued inputs
+    std::vector<std::size_t> otherInputs;  //!< the indices of the other inputs
+    std::vector<std::size_t> realOutputs;  //!< the indices of the real valued outputs
+    std::vector<std::size_t> otherOutputs;  //!< the indices of the other outputs
+    std::vector<double> realInputValues;  //!< input buffer for all the instances
+    std::vector<double> realOutputValues;  //!< output buffer for all the instances
+    std::vector<char> inputUpdated;  //!< flags for the instances with updated real inputs
+    std::unique_ptr<utilities::WorkStealingPool> pool;
+    unsigned int threadCount{0};
+    helics::Time stepTime{helics::timeEpsilon};  //!< the step time for the Federate
+    helics::Time timeBias{helics::timeZero};  //!< time shift for the federate
+    int logLevel{HELICS_LOG_LEVEL_SUMMARY};
+
+  public:
+    /** index value used to specify all instances*/
+    static constexpr std::size_t allInstances{std::numeric_limits<std::size_t>::max()};
+    /** create an ensemble federate
+    @param name the name of the federate, instance i is named name_i
+    @param fmi a library with a loaded FMU
+    @param count the number of instances to create
+    @param fedInfo the federate information
+    */
+    EnsembleFederate(std::string_view name,
+                     std::shared_ptr<FmiLibrary> fmi,
+                     std::size_t count,
+                     const helics::FederateInfo& fedInfo);
+    EnsembleFederate(std::string_view name,
+                     std::shared_ptr<FmiLibrary> fmi,
+                     std::size_t count,
+                     helics::CoreApp& core,
+                     const helics::FederateInfo& fedInfo);
+    /** configure the federate interfaces for every instance*/
+    void configure(helics::Time step, helics::Time start = helics::timeZero);
+    /** set a string list of inputs used by every instance
+    @details glob and "regex:" patterns are expanded as in CoSimFederate::setInputs*/
+    void setInputs(std::vector<std::string> input_names);
+    /** set a string list of outputs used by every instance*/
+    void setOutputs(std::vector<std::string> output_names);
+    /** set the number of worker threads used to step the instances
+    @details 0 uses the hardware concurrency, must be called before running the federate*/
+    void setThreadCount(unsigned int threads) { threadCount = threads; }
+    /** get the number of instances*/
+    [[nodiscard]] std::size_t size() const { return instances.size(); }
+    /** get an instance*/
+    fmi2CoSimObject& getInstance(std::size_t index) { return *instances.at(index); }
+    /** get the interface name of a variable of an instance*/
+    static std::string getInterfaceName(std::string_view variable, std::size_t index);
+    /** set a parameter
+    @details the name may include an instance index in the same form as the interface names to
+    set the parameter of a single instance, otherwise all instances are set*/
+    template<typename ValueType>
+    void set(const std::string& name, const ValueType& value)
+    {
+        auto [variable, index] = parseInterfaceName(name);
+        if (index == allInstances) {
+            for (auto& instance : instances) {
+                instance->set(variable, value);
+            }
+        } else {
+            instances[index]->set(variable, value);
+        }
+    }
+    /** set flags on the instances or federate*/
+    bool setFlag(const std::string& flag, bool val);
+    /** run the cosimulation*/
+    void run(helics::Time stop);
+    /** get the underlying HELICS federate*/
+    helics::ValueFederate* operator->() { return &fed; }
+
+    void logMessage(int logLevel, std::string_view message);
+
+  private:
+    void createInstances(std::size_t count);
+    /** split an indexed name into the variable name and instance index
+    @throw Error if the index is not a valid instance*/
+    std::pair<std::string, std::size_t> parseInterfaceName(const std::string& name) const;
+    double initialize(double stop);
+    /** transfer the updated non-real inputs and buffer the real inputs of each instance*/
+    void grabInputs();
+    /** step every instance and read the real outputs into the output buffer*/
+    void stepInstances(helics::Time currentTime);
+    /** publish the outputs of every instance*/
+    void publishOutputs();
+};
+
+}  // namespace helicsfmi
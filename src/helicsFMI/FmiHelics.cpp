@@ -7,8 +7,15 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 
 #include "FmiHelics.hpp"
 
+#include "formatInterpreters/JsonProcessingFunctions.hpp"
+
+#include <algorithm>
+#include <cmath>
 #include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <regex>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace helicsfmi {
 std::string_view getHelicsTypeString(fmi_variable_type type)
@@ -85,10 +92,243 @@ void publishOutput(helics::Publication& pub, fmi2Object* fmiObj, std::size_t ind
     }
 }
 
-void grabInput(helics::Input& inp, fmi2Object* fmiObj, std::size_t index, bool logValues)
+bool OutputFilter::update(double value)
+{
+    if (!isActive()) {
+        return true;
+    }
+    if (published) {
+        const double band = std::max(absoluteTolerance,
+                                     relativeTolerance *
+                                         std::max(std::abs(lastValue), std::abs(nominal)));
+        if (std::abs(value - lastValue) <= band) {
+            return false;
+        }
+    }
+    lastValue = value;
+    published = true;
+    return true;
+}
+
+bool OutputFilter::changed(double value)
+{
+    if (!changesOnly) {
+        return true;
+    }
+    if (published && value == lastValue) {
+        return false;
+    }
+    lastValue = value;
+    published = true;
+    return true;
+}
+
+double StepController::update(const std::vector<double>& values, double step)
+{
+    constexpr double safety{0.9};
+    constexpr double maxGrowth{2.0};
+    constexpr double maxShrink{0.2};
+
+    double factor{1.0};
+    if (history == 0 || values.size() != lastValues.size() || step <= 0.0) {
+        lastValues = values;
+        lastSlopes.assign(values.size(), 0.0);
+        history = 1;
+        return std::clamp(step, minStep, maxStep);
+    }
+    error = 0.0;
+    for (std::size_t ii = 0; ii < values.size(); ++ii) {
+        const double slope = (values[ii] - lastValues[ii]) / step;
+        if (history > 1) {
+            // deviation from a linear extrapolation of the previous step
+            const double scale = std::max(
+                {std::abs(values[ii]), (ii < nominal.size()) ? std::abs(nominal[ii]) : 1.0, 1e-12});
+            error = std::max(error, std::abs(slope - lastSlopes[ii]) * step / scale);
+        }
+        lastSlopes[ii] = slope;
+        lastValues[ii] = values[ii];
+    }
+    if (history > 1) {
+        factor = (error > 0.0) ? std::clamp(safety * std::sqrt(errorTolerance / error),
+                                            maxShrink,
+                                            maxGrowth) :
+                                 maxGrowth;
+    }
+    history = 2;
+    return std::clamp(step * factor, minStep, maxStep);
+}
+
+static OutputUpdate getVariabilityUpdate(fmi_variability variability)
+{
+    switch (variability) {
+        case fmi_variability::constant:
+        case fmi_variability::fixed:
+            return OutputUpdate::once;
+        case fmi_variability::tunable:
+            return OutputUpdate::tunable;
+        case fmi_variability::discrete:
+            return OutputUpdate::discrete;
+        default:
+            return OutputUpdate::continuous;
+    }
+}
+
+void OutputDependencies::build(const fmi2Object& fmiObj)
+{
+    std::vector<int> inputIndices(static_cast<std::size_t>(fmiObj.inputSize()));
+    for (std::size_t ii = 0; ii < inputIndices.size(); ++ii) {
+        inputIndices[ii] = fmiObj.getInput(static_cast<int>(ii)).index;
+    }
+    std::vector<int> outputIndices(static_cast<std::size_t>(fmiObj.outputSize()));
+    for (std::size_t jj = 0; jj < outputIndices.size(); ++jj) {
+        outputIndices[jj] = fmiObj.getOutput(static_cast<int>(jj)).index;
+    }
+    build(fmiObj.fmuInformation(), inputIndices, outputIndices);
+}
+
+void OutputDependencies::build(const FmiInfo& info,
+                               const std::vector<int>& inputIndices,
+                               const std::vector<int>& outputIndices)
+{
+    const auto inputCount = inputIndices.size();
+    const auto outputCount = outputIndices.size();
+    feedthrough.assign(inputCount, {});
+    updates.assign(outputCount, OutputUpdate::continuous);
+
+    std::unordered_map<int, std::size_t> inputLookup;
+    inputLookup.reserve(inputCount);
+    for (std::size_t ii = 0; ii < inputCount; ++ii) {
+        inputLookup.emplace(inputIndices[ii], ii);
+    }
+    for (std::size_t jj = 0; jj < outputCount; ++jj) {
+        const int vindex = outputIndices[jj];
+        const auto& vinfo = info.getVariableInfo(vindex);
+        const auto update = getVariabilityUpdate(vinfo.variability);
+        updates[jj] = update;
+        if (update == OutputUpdate::once || update == OutputUpdate::tunable) {
+            continue;
+        }
+        if (!info.hasDeclaredOutputDependencies(vindex)) {
+            // without a dependency list the output depends on all the inputs
+            for (auto& deps : feedthrough) {
+                deps.push_back(jj);
+            }
+            continue;
+        }
+        const auto& dependencies = info.getOutputDependencies(vindex);
+        OutputUpdate dependsOn{OutputUpdate::once};
+        for (const auto& dep : dependencies) {
+            auto fnd = inputLookup.find(static_cast<int>(dep.first));
+            if (fnd != inputLookup.end()) {
+                feedthrough[fnd->second].push_back(jj);
+            }
+            const auto& depInfo = info.getVariableInfo(dep.first);
+            dependsOn = std::max(dependsOn, getVariabilityUpdate(depInfo.variability));
+        }
+        // time is never listed as a dependency so an output with an empty list, or one depending
+        // on anything that changes between parameter updates, keeps its own variability
+        if (!dependencies.empty() && dependsOn <= OutputUpdate::tunable) {
+            updates[jj] = dependsOn;
+        }
+    }
+}
+
+std::size_t OutputDependencies::staticCount() const
+{
+    return static_cast<std::size_t>(std::count(updates.begin(), updates.end(), OutputUpdate::once));
+}
+
+std::vector<std::size_t> OutputDependencies::getOutputs(OutputUpdate update) const
+{
+    std::vector<std::size_t> outputs;
+    for (std::size_t jj = 0; jj < updates.size(); ++jj) {
+        if (updates[jj] == update) {
+            outputs.push_back(jj);
+        }
+    }
+    return outputs;
+}
+
+bool OutputDependencies::hasFeedthrough() const
+{
+    return std::any_of(feedthrough.begin(), feedthrough.end(), [](const auto& deps) {
+        return !deps.empty();
+    });
+}
+
+std::vector<std::size_t>
+    OutputDependencies::getAffectedOutputs(const std::vector<std::size_t>& inputIndices) const
+{
+    std::vector<bool> affected(updates.size(), false);
+    for (auto index : inputIndices) {
+        for (auto output : feedthrough[index]) {
+            affected[output] = true;
+        }
+    }
+    std::vector<std::size_t> outputs;
+    for (std::size_t jj = 0; jj < affected.size(); ++jj) {
+        if (affected[jj]) {
+            outputs.push_back(jj);
+        }
+    }
+    return outputs;
+}
+
+bool publishOutput(helics::Publication& pub,
+                   fmi2Object* fmiObj,
+                   std::size_t index,
+                   OutputFilter& filter,
+                   bool logValues)
+{
+    if (!filter.isActive()) {
+        publishOutput(pub, fmiObj, index, logValues);
+        return true;
+    }
+    const auto& var = fmiObj->getOutput(static_cast<int>(index));
+    switch (var.type) {
+        case fmi_variable_type::integer:
+        case fmi_variable_type::enumeration: {
+            auto val = fmiObj->get<std::int64_t>(var);
+            if (!filter.update(static_cast<double>(val))) {
+                return false;
+            }
+            pub.publish(val);
+            if (logValues) {
+                fmiObj->logMessage("data", fmt::format("publishing {} to {}", val, pub.getName()));
+            }
+        } break;
+        case fmi_variable_type::real:
+        case fmi_variable_type::numeric: {
+            auto val = fmiObj->get<double>(var);
+            if (!filter.update(val)) {
+                return false;
+            }
+            pub.publish(val);
+            if (logValues) {
+                fmiObj->logMessage("data", fmt::format("publishing {} to {}", val, pub.getName()));
+            }
+        } break;
+        case fmi_variable_type::boolean: {
+            auto val = fmiObj->get<fmi2Boolean>(var);
+            if (!filter.changed((val != fmi2False) ? 1.0 : 0.0)) {
+                return false;
+            }
+            pub.publish(val != fmi2False);
+            if (logValues) {
+                fmiObj->logMessage("data", fmt::format("publishing {} to {}", val, pub.getName()));
+            }
+        } break;
+        default:
+            publishOutput(pub, fmiObj, index, logValues);
+            break;
+    }
+    return true;
+}
+
+bool grabInput(helics::Input& inp, fmi2Object* fmiObj, std::size_t index, bool logValues)
 {
     if (!inp.isUpdated()) {
-        return;
+        return false;
     }
     const auto& var = fmiObj->getInput(static_cast<int>(index));
     switch (var.type) {
@@ -124,6 +364,7 @@ void grabInput(helics::Input& inp, fmi2Object* fmiObj, std::size_t index, bool l
             }
         } break;
     }
+    return true;
 }
 
 void setDefault(helics::Input& inp, fmi2Object* fmiObj, std::size_t index)
@@ -152,6 +393,26 @@ void setDefault(helics::Input& inp, fmi2Object* fmiObj, std::size_t index)
     }
 }
 
+bool getUnitConversion(const units::precise_unit& from,
+                       const units::precise_unit& to,
+                       UnitConversion& conversion)
+{
+    const double zero = units::convert(0.0, from, to);
+    const double one = units::convert(1.0, from, to);
+    if (!std::isfinite(zero) || !std::isfinite(one)) {
+        return false;
+    }
+    // check a third point to make sure the conversion is actually linear
+    const double check = units::convert(100.0, from, to);
+    const double expected = 100.0 * (one - zero) + zero;
+    if (std::abs(check - expected) > 1e-9 * std::max(1.0, std::abs(check))) {
+        return false;
+    }
+    conversion.factor = one - zero;
+    conversion.offset = zero;
+    return true;
+}
+
 static const std::unordered_map<std::string_view, int> logLevelsTranslation{
     {"logEvents", HELICS_LOG_LEVEL_DEBUG},
     {"logSingularLinearSystems", HELICS_LOG_LEVEL_DATA},
@@ -204,6 +465,203 @@ static const std::unordered_map<std::string_view, int> logLevelsTranslation{
     {"Debug", HELICS_LOG_LEVEL_DEBUG},
     {"Trace", HELICS_LOG_LEVEL_TRACE}};
 
+std::vector<bool> getConnectedPublications(helics::ValueFederate& fed,
+                                           const std::vector<helics::Publication>& pubs)
+{
+    std::vector<bool> connected(pubs.size(), true);
+    Json::Value graph;
+    try {
+        graph = fileops::loadJsonStr(fed.query("data_flow_graph"));
+    }
+    catch (const std::invalid_argument&) {
+        return connected;
+    }
+    if (!graph.isObject() || graph.isMember("error")) {
+        return connected;
+    }
+    std::unordered_set<std::string> targeted;
+    for (const auto& pub : graph["publications"]) {
+        if (pub.isMember("targets") && !pub["targets"].empty()) {
+            targeted.insert(pub["key"].asString());
+        }
+    }
+    for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
+        connected[ii] = targeted.find(pubs[ii].getName()) != targeted.end();
+    }
+    return connected;
+}
+
+std::vector<LocalConnection> getLocalConnections(helics::ValueFederate& fed,
+                                                 const std::vector<helics::Publication>& pubs,
+                                                 const std::vector<helics::Input>& inputs,
+                                                 std::vector<bool>& remoteTargets)
+{
+    std::vector<LocalConnection> connections;
+    remoteTargets.assign(pubs.size(), true);
+    Json::Value graph;
+    try {
+        graph = fileops::loadJsonStr(fed.query("data_flow_graph"));
+    }
+    catch (const std::invalid_argument&) {
+        return connections;
+    }
+    if (!graph.isObject() || graph.isMember("error")) {
+        return connections;
+    }
+    std::unordered_map<std::string, std::size_t> inputIndex;
+    for (std::size_t ii = 0; ii < inputs.size(); ++ii) {
+        inputIndex.emplace(inputs[ii].getName(), ii);
+    }
+    // the targets are listed by handle so map the handles of the local inputs to their index
+    std::unordered_map<std::string, std::size_t> inputHandles;
+    for (const auto& inp : graph["inputs"]) {
+        auto found = inputIndex.find(inp["key"].asString());
+        if (found != inputIndex.end()) {
+            inputHandles.emplace(
+                fmt::format("{}:{}", inp["federate"].asInt64(), inp["handle"].asInt64()),
+                found->second);
+        }
+    }
+    std::unordered_map<std::string, std::size_t> pubIndex;
+    for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
+        pubIndex.emplace(pubs[ii].getName(), ii);
+    }
+    for (const auto& pub : graph["publications"]) {
+        auto found = pubIndex.find(pub["key"].asString());
+        if (found == pubIndex.end() || !pub.isMember("targets")) {
+            continue;
+        }
+        bool remote{false};
+        for (const auto& target : pub["targets"]) {
+            auto local = inputHandles.find(
+                fmt::format("{}:{}", target["federate"].asInt64(), target["handle"].asInt64()));
+            if (local == inputHandles.end()) {
+                remote = true;
+            } else {
+                connections.push_back({found->second, local->second});
+            }
+        }
+        remoteTargets[found->second] = remote || pub["targets"].empty();
+    }
+    return connections;
+}
+
+static constexpr std::string_view regexPrefix{"regex:"};
+
+bool isVariablePattern(std::string_view name)
+{
+    return name.find_first_of("*?") != std::string_view::npos ||
+        name.compare(0, regexPrefix.size(), regexPrefix) == 0;
+}
+
+/** match a name against a glob pattern with '*' and '?' wildcards*/
+static bool globMatch(std::string_view pattern, std::string_view name)
+{
+    std::size_t pp{0};
+    std::size_t nn{0};
+    std::size_t starPattern{std::string_view::npos};
+    std::size_t starName{0};
+    while (nn < name.size()) {
+        if (pp < pattern.size() && (pattern[pp] == '?' || pattern[pp] == name[nn])) {
+            ++pp;
+            ++nn;
+        } else if (pp < pattern.size() && pattern[pp] == '*') {
+            starPattern = pp++;
+            starName = nn;
+        } else if (starPattern != std::string_view::npos) {
+            // let the last '*' absorb one more character and retry
+            pp = starPattern + 1;
+            nn = ++starName;
+        } else {
+            return false;
+        }
+    }
+    while (pp < pattern.size() && pattern[pp] == '*') {
+        ++pp;
+    }
+    return pp == pattern.size();
+}
+
+std::vector<std::string> expandVariablePatterns(const std::vector<std::string>& names,
+                                                const std::vector<std::string>& candidates)
+{
+    std::vector<std::string> expanded;
+    expanded.reserve(std::max(names.size(), candidates.size()));
+    std::unordered_set<std::string_view> included;
+    auto addName = [&expanded, &included](const std::string& name) {
+        if (included.insert(name).second) {
+            expanded.push_back(name);
+        }
+    };
+    for (const auto& name : names) {
+        if (!isVariablePattern(name)) {
+            addName(name);
+            continue;
+        }
+        if (name.compare(0, regexPrefix.size(), regexPrefix) == 0) {
+            std::regex expression;
+            try {
+                expression = std::regex(name.substr(regexPrefix.size()));
+            }
+            catch (const std::regex_error& e) {
+                throw(Error("variable selection",
+                            fmt::format("invalid regular expression {}: {}", name, e.what()),
+                            -102));
+            }
+            for (const auto& candidate : candidates) {
+                if (std::regex_match(candidate, expression)) {
+                    addName(candidate);
+                }
+            }
+            continue;
+        }
+        for (const auto& candidate : candidates) {
+            if (globMatch(name, candidate)) {
+                addName(candidate);
+            }
+        }
+    }
+    return expanded;
+}
+
+void startPacing(helics::ValueFederate& fed,
+                 utilities::RealTimePacer& pacer,
+                 double simTime,
+                 bool lockMemory,
+                 int processor)
+{
+    if (lockMemory && !utilities::RealTimePacer::lockMemory()) {
+        fed.logWarningMessage("unable to lock the process memory for paced stepping");
+    }
+    if (processor >= 0 && !utilities::RealTimePacer::pinCurrentThread(processor)) {
+        fed.logWarningMessage(fmt::format("unable to pin the stepping thread to processor {}",
+                                          processor));
+    }
+    pacer.start(simTime);
+}
+
+void logPacingSummary(helics::ValueFederate& fed, const utilities::RealTimePacer& pacer)
+{
+    const auto& stats = pacer.getStatistics();
+    if (stats.steps == 0) {
+        return;
+    }
+    const double steps = static_cast<double>(stats.steps);
+    fed.logMessage(HELICS_LOG_LEVEL_SUMMARY,
+                   fmt::format("paced {} steps at {}x wall clock time: {} overruns, lateness mean "
+                               "{:.3f}ms max {:.3f}ms, compute mean {:.3f}ms max {:.3f}ms",
+                               stats.steps,
+                               pacer.getScale(),
+                               stats.overruns,
+                               1000.0 * stats.totalLateness / steps,
+                               1000.0 * stats.maxLateness,
+                               1000.0 * stats.totalCompute / steps,
+                               1000.0 * stats.maxCompute));
+    fed.logMessage(HELICS_LOG_LEVEL_SUMMARY,
+                   fmt::format("step compute time by 10% of the step budget, then overruns: {}",
+                               fmt::join(stats.histogram, ",")));
+}
+
 int fmiCategory2HelicsLogLevel(std::string_view category)
 {
     auto llevel = logLevelsTranslation.find(category);
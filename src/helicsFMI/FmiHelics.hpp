@@ -11,7 +11,9 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 #include "fmi/fmi_import/fmiObjects.h"
 #include "helics/application_api/HelicsPrimaryTypes.hpp"
 #include "helics/application_api/ValueFederate.hpp"
+#include "utilities/realTimePacer.h"
 
+#include <cstdint>
 #include <exception>
 #include <memory>
 #include <string>
@@ -42,16 +44,218 @@ std::string_view getHelicsTypeString(fmi_variable_type type);
 /** get the corresponding helics data type to an FMI variable type*/
 helics::DataType getHelicsType(fmi_variable_type type);
 
+/** deadband filter applied to numeric outputs before they are published
+@details a value is published if it differs from the last published value by more than
+max(absoluteTolerance, relativeTolerance*max(|last value|, |nominal|))
+*/
+class OutputFilter {
+  public:
+    OutputFilter() = default;
+    OutputFilter(double absTolerance, double relTolerance, double nominalValue = 1.0):
+        absoluteTolerance(absTolerance), relativeTolerance(relTolerance), nominal(nominalValue)
+    {
+    }
+    /** check a new value against the filter
+    @return true if the value should be published, in which case it becomes the new reference value
+    */
+    bool update(double value);
+    /** check a new value against the last published value ignoring the deadband
+    @details used for boolean outputs, which bypass the deadband
+    @return true if the value should be published*/
+    bool changed(double value);
+    /** force the next value to pass through the filter*/
+    void reset() { published = false; }
+    /** suppress values equal to the last published value even without a deadband*/
+    void setChangesOnly(bool changes) { changesOnly = changes; }
+    /** check if the filter can suppress any values*/
+    [[nodiscard]] bool isActive() const
+    {
+        return absoluteTolerance > 0.0 || relativeTolerance > 0.0 || changesOnly;
+    }
+    /** check if a value has passed through an active filter*/
+    [[nodiscard]] bool hasValue() const { return published; }
+    /** get the last value that passed through the filter*/
+    [[nodiscard]] double getLastValue() const { return lastValue; }
+
+  private:
+    double absoluteTolerance{0.0};
+    double relativeTolerance{0.0};
+    double nominal{1.0};
+    double lastValue{0.0};  //!< the last value that passed through the filter
+    bool published{false};  //!< true if lastValue is valid
+    bool changesOnly{false};  //!< suppress unchanged values of outputs without a deadband
+};
+
+/** controller for the size of the communication step based on the change in the outputs
+@details the local error is estimated from the change in slope of the outputs over successive steps
+scaled by the larger of the output magnitude and its nominal value, the next step grows when the
+error is below the tolerance and shrinks when it is above*/
+class StepController {
+  public:
+    StepController() = default;
+    StepController(double minimumStep, double maximumStep, double tolerance = 1e-3):
+        minStep(minimumStep), maxStep(maximumStep), errorTolerance(tolerance)
+    {
+    }
+    /** set the nominal values of the monitored outputs*/
+    void setNominal(std::vector<double> nominalValues) { nominal = std::move(nominalValues); }
+    /** update the controller with the output values at the end of a step
+    @param values the output values at the end of the step
+    @param step the size of the step just completed
+    @return the size of the next step
+    */
+    double update(const std::vector<double>& values, double step);
+    /** clear the history of output values*/
+    void reset() { history = 0; }
+    /** get the error estimate from the last update*/
+    [[nodiscard]] double getError() const { return error; }
+    [[nodiscard]] double getMinStep() const { return minStep; }
+    [[nodiscard]] double getMaxStep() const { return maxStep; }
+
+  private:
+    double minStep{0.0};
+    double maxStep{0.0};
+    double errorTolerance{1e-3};
+    double error{0.0};  //!< the last error estimate
+    int history{0};  //!< the number of updates stored in lastValues and lastSlopes
+    std::vector<double> nominal;
+    std::vector<double> lastValues;
+    std::vector<double> lastSlopes;
+};
+
+/** the conditions under which the value of an output can change*/
+enum class OutputUpdate : std::uint8_t {
+    once,  //!< constant or fixed, only read at initialization
+    tunable,  //!< changes only when a parameter is set
+    discrete,  //!< changes only at events
+    continuous  //!< can change on every step
+};
+
+/** dependencies of the active outputs of an fmi object on its active inputs
+@details generated from the variability of the outputs and the ModelStructure section of the model
+description*/
+class OutputDependencies {
+  public:
+    /** build the dependency information for the current inputs and outputs of an fmi object*/
+    void build(const fmi2Object& fmiObj);
+    /** build the dependency information for a set of variables of an FMU
+    @param info the model description of the FMU
+    @param inputIndices the variable indices of the inputs
+    @param outputIndices the variable indices of the outputs*/
+    void build(const FmiInfo& info,
+               const std::vector<int>& inputIndices,
+               const std::vector<int>& outputIndices);
+    /** get the conditions under which an output needs to be read and published again*/
+    [[nodiscard]] OutputUpdate getUpdate(std::size_t outputIndex) const
+    {
+        return updates[outputIndex];
+    }
+    /** check if an output depends only on constants and fixed parameters
+    @details such outputs only need to be read and published once*/
+    [[nodiscard]] bool isStatic(std::size_t outputIndex) const
+    {
+        return updates[outputIndex] == OutputUpdate::once;
+    }
+    /** get the number of outputs that only need to be read once*/
+    [[nodiscard]] std::size_t staticCount() const;
+    /** get the indices of the outputs with a particular update class*/
+    [[nodiscard]] std::vector<std::size_t> getOutputs(OutputUpdate update) const;
+    /** get the outputs with direct feedthrough from an input*/
+    [[nodiscard]] const std::vector<std::size_t>& getFeedthrough(std::size_t inputIndex) const
+    {
+        return feedthrough[inputIndex];
+    }
+    /** check if any output has direct feedthrough from any input*/
+    [[nodiscard]] bool hasFeedthrough() const;
+    /** get the outputs affected by a set of inputs with each output listed once in order*/
+    [[nodiscard]] std::vector<std::size_t>
+        getAffectedOutputs(const std::vector<std::size_t>& inputIndices) const;
+
+  private:
+    std::vector<OutputUpdate> updates;
+    std::vector<std::vector<std::size_t>> feedthrough;  //!< the dependent outputs of each input
+};
+
 /** publish output data to a helics publication*/
 void publishOutput(helics::Publication& pub,
                    fmi2Object* fmiObj,
                    std::size_t index,
                    bool logValues = false);
-/** direct helics input data to an input*/
-void grabInput(helics::Input& inp, fmi2Object* fmiObj, std::size_t index, bool logValues = false);
+/** publish output data to a helics publication if the value is outside the filter deadband
+@details boolean outputs bypass the deadband and are only suppressed when the filter publishes
+changes only and the value is unchanged, string outputs are not filtered
+@return true if the value was published
+*/
+bool publishOutput(helics::Publication& pub,
+                   fmi2Object* fmiObj,
+                   std::size_t index,
+                   OutputFilter& filter,
+                   bool logValues = false);
+/** direct helics input data to an input
+@return true if the input was updated*/
+bool grabInput(helics::Input& inp, fmi2Object* fmiObj, std::size_t index, bool logValues = false);
 /** set the default values of a fmi input to be the helics default so there isn't value problems*/
 void setDefault(helics::Input& inp, fmi2Object* fmiObj, std::size_t index);
 
+/** linear conversion of a value between units, converted=value*factor+offset*/
+struct UnitConversion {
+    double factor{1.0};
+    double offset{0.0};
+};
+/** compute the linear conversion of values from one unit to another
+@return true if the units are convertible with a linear conversion*/
+bool getUnitConversion(const units::precise_unit& from,
+                       const units::precise_unit& to,
+                       UnitConversion& conversion);
+
+/** determine which publications have at least one subscriber
+@details uses the data_flow_graph query so it must be called after the connections are resolved,
+i.e. after entering initializing mode
+@return a flag for each publication, all publications are marked connected if the query fails*/
+std::vector<bool> getConnectedPublications(helics::ValueFederate& fed,
+                                           const std::vector<helics::Publication>& pubs);
+
+/** a connection between a publication and an input of the same federate*/
+struct LocalConnection {
+    std::size_t publication{0};  //!< the index of the source publication
+    std::size_t input{0};  //!< the index of the target input
+};
+
+/** find the connections from the publications of a federate to its own inputs
+@details uses the data_flow_graph query so it must be called after the connections are resolved
+@param remoteTargets set to a flag for each publication that has targets in other federates or
+whose targets are unknown, all publications are marked remote if the query fails
+@return the local connections*/
+std::vector<LocalConnection> getLocalConnections(helics::ValueFederate& fed,
+                                                 const std::vector<helics::Publication>& pubs,
+                                                 const std::vector<helics::Input>& inputs,
+                                                 std::vector<bool>& remoteTargets);
+
+/** check if a variable name is a selection pattern
+@details glob patterns contain '*' or '?', regular expressions are prefixed with "regex:"*/
+bool isVariablePattern(std::string_view name);
+
+/** replace the selection patterns in a list of variable names with the matching variables
+@details names that are not patterns are kept in place, each pattern is replaced by the matching
+candidates in the order of the candidates, and a variable is only included once
+@param names the list of names and patterns
+@param candidates the names of the variables that can be selected
+@throw Error if a regular expression is invalid*/
+std::vector<std::string> expandVariablePatterns(const std::vector<std::string>& names,
+                                                const std::vector<std::string>& candidates);
+
+/** prepare the calling thread for paced stepping and anchor the pacer at a simulation time
+@details failures to lock the memory or pin the thread are logged as warnings
+@param processor the processor to pin the thread to, -1 to leave the thread unpinned*/
+void startPacing(helics::ValueFederate& fed,
+                 utilities::RealTimePacer& pacer,
+                 double simTime,
+                 bool lockMemory,
+                 int processor);
+
+/** log a summary of the timing of the paced steps of a federate*/
+void logPacingSummary(helics::ValueFederate& fed, const utilities::RealTimePacer& pacer);
+
 /** generate a helics log level from an FMI category description*/
 int fmiCategory2HelicsLogLevel(std::string_view category);
 
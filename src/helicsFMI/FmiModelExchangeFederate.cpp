@@ -105,7 +105,23 @@ void FmiModelExchangeFederate::configure(helics::Time step, helics::Time startTi
     }
     fed.setProperty(HELICS_PROPERTY_TIME_PERIOD, step);
     stepTime = step;
+    dependencies.build(*me);
+    stepOutputs.clear();
+    // parameters can't be changed after initialization so tunable outputs are only read once
+    for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
+        const auto update = dependencies.getUpdate(ii);
+        if (update == OutputUpdate::continuous || update == OutputUpdate::discrete) {
+            stepOutputs.push_back(ii);
+        }
+    }
     solver = griddyn::makeSolver("cvode", "cvode");
+    if (variableQueries) {
+        queries = std::make_shared<VariableQueries>(*me, std::vector<std::string>{});
+        fed.setQueryCallback([answers = queries](std::string_view queryString) {
+            return answers->query(queryString);
+        });
+    }
+    configured = true;
 }
 
 void FmiModelExchangeFederate::setInputs(std::vector<std::string> input_names)
@@ -138,6 +154,10 @@ void FmiModelExchangeFederate::addConnection(const std::string& conn)
 
 bool FmiModelExchangeFederate::setFlag(const std::string& flag, bool val)
 {
+    if (flag == "variable_queries") {
+        variableQueries = val;
+        return true;
+    }
     if (me->setFlag(flag, val)) {
         return true;
     }
@@ -149,6 +169,17 @@ bool FmiModelExchangeFederate::setFlag(const std::string& flag, bool val)
     return false;
 }
 
+void FmiModelExchangeFederate::setRealTimePacing(double scale, bool lockMemory, int processor)
+{
+    if (scale > 0.0) {
+        pacer = std::make_unique<utilities::RealTimePacer>(scale);
+    } else {
+        pacer.reset();
+    }
+    pacingLockMemory = lockMemory;
+    pacingProcessor = processor;
+}
+
 void FmiModelExchangeFederate::logMessage(int helicsLogLevel, std::string_view message)
 {
     fed.logMessage(helicsLogLevel, message);
@@ -180,27 +211,44 @@ void FmiModelExchangeFederate::run(helics::Time stop)
     }
     auto result = fed.enterExecutingMode(helics::IterationRequest::ITERATE_IF_NEEDED);
     if (result == helics::IterationResult::ITERATING) {
-        if (!inputs.empty()) {
-            for (std::size_t ii = 0; ii < inputs.size(); ++ii) {
-                helicsfmi::grabInput(inputs[ii], me.get(), ii, logLevel >= HELICS_LOG_LEVEL_DATA);
+        std::vector<std::size_t> updatedInputs;
+        for (std::size_t ii = 0; ii < inputs.size(); ++ii) {
+            if (helicsfmi::grabInput(
+                    inputs[ii], me.get(), ii, logLevel >= HELICS_LOG_LEVEL_DATA)) {
+                updatedInputs.push_back(ii);
             }
         }
+        // only the outputs with direct feedthrough from the updated inputs can have changed
+        for (auto index : dependencies.getAffectedOutputs(updatedInputs)) {
+            helicsfmi::publishOutput(
+                pubs[index], me.get(), index, logLevel >= HELICS_LOG_LEVEL_DATA);
+        }
         fed.enterExecutingMode();
     }
     me->setMode(FmuMode::CONTINUOUS_TIME);
 
     helics::Time currentTime = helics::timeZero;
+    if (pacer) {
+        startPacing(fed, *pacer, 0.0, pacingLockMemory, pacingProcessor);
+    }
     while (currentTime <= stop) {
         // me->doStep(static_cast<double>(currentTime), static_cast<double>(stepTime), true);
         double timeReturn;
         solver->solve(static_cast<double>(currentTime), timeReturn);
+        if (queries) {
+            queries->update(*me, timeReturn, {});
+        }
+        if (pacer) {
+            pacer->pace(static_cast<double>(currentTime + stepTime));
+        }
         currentTime = fed.requestNextStep();
-        // get the values to publish
-        if (!pubs.empty()) {
-            // get the values to publish
-            for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
-                helicsfmi::publishOutput(pubs[ii], me.get(), ii, logLevel >= HELICS_LOG_LEVEL_DATA);
-            }
+        if (pacer) {
+            pacer->startStep();
+        }
+        // get the values to publish, outputs depending only on parameters were published once
+        for (auto index : stepOutputs) {
+            helicsfmi::publishOutput(
+                pubs[index], me.get(), index, logLevel >= HELICS_LOG_LEVEL_DATA);
         }
         if (!inputs.empty()) {
             // load the inputs
@@ -209,6 +257,9 @@ void FmiModelExchangeFederate::run(helics::Time stop)
             }
         }
     }
+    if (pacer) {
+        logPacingSummary(fed, *pacer);
+    }
     fed.finalize();
 }
 
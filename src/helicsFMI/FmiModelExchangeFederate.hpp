@@ -8,6 +8,7 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 
 #include "FmiHelics.hpp"
 #include "FmiHelicsLogging.hpp"
+#include "FmiQueries.hpp"
 #include "fmi/fmi_import/fmiImport.h"
 #include "fmi/fmi_import/fmiObjects.h"
 #include "helics/application_api/Inputs.hpp"
@@ -47,6 +48,8 @@ class FmiModelExchangeFederate: public griddyn::SolvableObject {
     virtual ~FmiModelExchangeFederate();
     /** configure the federate using the specified inputs and outputs*/
     void configure(helics::Time step, helics::Time start = helics::timeZero);
+    /** check if the federate interfaces have been configured*/
+    [[nodiscard]] bool isConfigured() const { return configured; }
     /** set a string list of inputs*/
     void setInputs(std::vector<std::string> input_names);
     /** set a string list of outputs*/
@@ -74,8 +77,12 @@ class FmiModelExchangeFederate: public griddyn::SolvableObject {
         me->set(std::forward<Args>(args)...);
     }
 
-    /** set flags on the object or federate*/
+    /** set flags on the object or federate
+    @details "variable_queries" (on by default) answers variable queries as in
+    CoSimFederate::setFlag*/
     bool setFlag(const std::string& flag, bool val);
+    /** align each step with the wall clock as in CoSimFederate::setRealTimePacing*/
+    void setRealTimePacing(double scale, bool lockMemory = false, int processor = -1);
 
     virtual solver_index_type jacobianSize(const griddyn::solverMode& sMode) const override;
 
@@ -132,9 +139,17 @@ class FmiModelExchangeFederate: public griddyn::SolvableObject {
         helics::timeZero};  //!< the starting time for the FMU with a bias shift from 0
     std::vector<helics::Publication> pubs;  //!< known publications
     std::vector<helics::Input> inputs;  //!< known subscriptions
+    OutputDependencies dependencies;  //!< the output dependency graph
+    std::vector<std::size_t> stepOutputs;  //!< the outputs read and published every step
     double stepSize{0.01};  //!< the default step size of the simulation
     std::unique_ptr<griddyn::SolverInterface> solver;
+    std::unique_ptr<utilities::RealTimePacer> pacer;  //!< aligns the steps with the wall clock
+    int pacingProcessor{-1};  //!< the processor for the stepping thread, -1 to leave it unpinned
+    bool pacingLockMemory{false};  //!< lock the process memory before paced stepping
     int logLevel{HELICS_LOG_LEVEL_SUMMARY};
+    bool configured{false};  //!< the interfaces have been configured
+    bool variableQueries{true};  //!< answer queries for the values of FMU variables
+    std::shared_ptr<VariableQueries> queries;  //!< answers the variable queries
 };
 
 }  // namespace helicsfmi
@@ -0,0 +1,215 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "FmiQueries.hpp"
+
+#include "FmiHelics.hpp"
+#include "formatInterpreters/JsonProcessingFunctions.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <utility>
+
+namespace helicsfmi {
+
+static std::string queryError(int code, const std::string& message)
+{
+    Json::Value response;
+    response["error"]["code"] = code;
+    response["error"]["message"] = message;
+    return fileops::generateJsonString(response);
+}
+
+VariableQueries::VariableQueries(const fmi2Object& obj, std::vector<std::string> statisticNames):
+    statNames(std::move(statisticNames)), layout(std::make_shared<SnapshotLayout>())
+{
+    const auto& info = obj.fmuInformation();
+    for (const auto& name : info.getVariableNames("any")) {
+        switch (info.getVariableInfo(name).type) {
+            case fmi_variable_type::real:
+            case fmi_variable_type::integer:
+            case fmi_variable_type::enumeration:
+            case fmi_variable_type::boolean:
+                candidateNames.push_back(name);
+                break;
+            default:
+                break;
+        }
+    }
+    std::sort(candidateNames.begin(), candidateNames.end());
+    candidates.insert(candidateNames.begin(), candidateNames.end());
+}
+
+std::string VariableQueries::query(std::string_view queryString)
+{
+    const bool single = queryString.compare(0, 6, "value/") == 0;
+    const bool multiple = queryString.compare(0, 7, "values/") == 0;
+    if (!single && !multiple && queryString != "stats") {
+        return {};
+    }
+    const auto snapshot = std::atomic_load(&current);
+    Json::Value response;
+    if (snapshot) {
+        response["time"] = snapshot->time;
+    } else {
+        response["time"] = Json::Value();
+    }
+    if (queryString == "stats") {
+        response["steps"] = Json::UInt64(snapshot ? snapshot->steps : 0U);
+        response["variables"] = Json::UInt64(snapshot ? snapshot->values.size() : 0U);
+        for (std::size_t ii = 0; ii < statNames.size(); ++ii) {
+            const bool valid = snapshot && ii < snapshot->statistics.size();
+            response[statNames[ii]] = valid ? snapshot->statistics[ii] : 0.0;
+        }
+        return fileops::generateJsonString(response);
+    }
+    std::vector<std::string> names;
+    const std::string target(queryString.substr(single ? 6 : 7));
+    if (single) {
+        if (candidates.find(target) == candidates.end()) {
+            return queryError(404, fmt::format("{} is not a numeric variable", target));
+        }
+        names.push_back(target);
+    } else {
+        try {
+            names = expandVariablePatterns({target}, candidateNames);
+        }
+        catch (const Error& e) {
+            return queryError(400, e.what());
+        }
+        // a name that is not a pattern is kept by the expansion even if it is not a variable
+        names.erase(std::remove_if(names.begin(),
+                                   names.end(),
+                                   [this](const std::string& name) {
+                                       return candidates.find(name) == candidates.end();
+                                   }),
+                    names.end());
+    }
+    std::vector<std::string> missing;
+    Json::Value values(Json::objectValue);
+    for (const auto& name : names) {
+        if (snapshot) {
+            const auto fnd = snapshot->layout->lookup.find(name);
+            if (fnd != snapshot->layout->lookup.end()) {
+                values[name] = snapshot->values[fnd->second];
+                continue;
+            }
+        }
+        missing.push_back(name);
+    }
+    if (!missing.empty()) {
+        // the variables are read after the next step and the query can be repeated
+        request(missing);
+    }
+    if (single) {
+        response["name"] = target;
+        response["value"] = missing.empty() ? values[target] : Json::Value();
+        if (!missing.empty()) {
+            response["pending"] = true;
+        }
+        return fileops::generateJsonString(response);
+    }
+    response["values"] = values;
+    if (!missing.empty()) {
+        Json::Value pending(Json::arrayValue);
+        for (const auto& name : missing) {
+            pending.append(name);
+        }
+        response["pending"] = pending;
+    }
+    return fileops::generateJsonString(response);
+}
+
+void VariableQueries::request(const std::vector<std::string>& names)
+{
+    std::lock_guard<std::mutex> guard(requestLock);
+    for (const auto& name : names) {
+        if (known.insert(name).second) {
+            requested.push_back(name);
+        }
+    }
+    if (!requested.empty()) {
+        pendingRequests.store(true, std::memory_order_release);
+    }
+}
+
+void VariableQueries::loadRequests(const fmi2Object& obj)
+{
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> guard(requestLock);
+        names.swap(requested);
+        pendingRequests.store(false, std::memory_order_relaxed);
+    }
+    const auto& info = obj.fmuInformation();
+    std::vector<std::string> realNames;
+    std::vector<std::string> otherNames;
+    const auto realCount = realSet.getVRcount();
+    for (std::size_t ii = 0; ii < layout->names.size(); ++ii) {
+        (ii < realCount ? realNames : otherNames).push_back(layout->names[ii]);
+    }
+    for (auto& name : names) {
+        const auto& var = info.getVariableInfo(name);
+        if (var.type == +fmi_variable_type::real) {
+            realSet.push(var.valueRef);
+            realNames.push_back(std::move(name));
+        } else {
+            otherVariables.emplace_back(var);
+            otherNames.push_back(std::move(name));
+        }
+    }
+    auto updated = std::make_shared<SnapshotLayout>();
+    updated->names = std::move(realNames);
+    updated->names.insert(updated->names.end(),
+                          std::make_move_iterator(otherNames.begin()),
+                          std::make_move_iterator(otherNames.end()));
+    for (std::size_t ii = 0; ii < updated->names.size(); ++ii) {
+        updated->lookup.emplace(updated->names[ii], ii);
+    }
+    layout = std::move(updated);
+}
+
+std::shared_ptr<VariableSnapshot> VariableQueries::acquire()
+{
+    if (spare && spare.use_count() == 1) {
+        // pairs with the release of the reference held by the last query that read the snapshot
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return std::move(spare);
+    }
+    return std::make_shared<VariableSnapshot>();
+}
+
+void VariableQueries::update(const fmi2Object& obj,
+                             double time,
+                             std::initializer_list<double> statistics)
+{
+    ++steps;
+    if (pendingRequests.load(std::memory_order_acquire)) {
+        loadRequests(obj);
+    }
+    auto snapshot = acquire();
+    snapshot->time = time;
+    snapshot->steps = steps;
+    snapshot->layout = layout;
+    snapshot->values.resize(layout->names.size());
+    const auto realCount = realSet.getVRcount();
+    if (realCount > 0) {
+        obj.get(realSet, snapshot->values.data());
+    }
+    for (std::size_t ii = 0; ii < otherVariables.size(); ++ii) {
+        snapshot->values[realCount + ii] = obj.get<double>(otherVariables[ii]);
+    }
+    snapshot->statistics.assign(statistics);
+    spare = std::atomic_exchange(&current, std::move(snapshot));
+}
+
+std::size_t VariableQueries::variableCount() const
+{
+    return layout->names.size();
+}
+
+}  // namespace helicsfmi
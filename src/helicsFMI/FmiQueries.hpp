@@ -0,0 +1,85 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "fmi/fmi_import/fmiObjects.h"
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace helicsfmi {
+
+/** the names of the variables in a snapshot in the order of their values*/
+struct SnapshotLayout {
+    std::vector<std::string> names;  //!< the real variables followed by the other variables
+    std::unordered_map<std::string_view, std::size_t> lookup;  //!< the position of each name
+};
+
+/** the values of the queried FMU variables after a step*/
+struct VariableSnapshot {
+    double time{0.0};  //!< the simulation time of the values
+    std::uint64_t steps{0};  //!< the number of steps taken
+    std::shared_ptr<const SnapshotLayout> layout;  //!< the names of the values
+    std::vector<double> values;  //!< the variable values in the order of the layout
+    std::vector<double> statistics;  //!< the federate counters in the order of their names
+};
+
+/** answer HELICS queries for the values of FMU variables from a snapshot taken after each step
+@details the queries "value/<name>", "values/<pattern>", and "stats" are answered with json from
+the last snapshot without touching the FMU, a variable is added to the snapshot by the stepping
+thread after it is first queried so only the queried variables are read, the snapshot is swapped
+atomically so the stepping thread never waits on a query*/
+class VariableQueries {
+  public:
+    /** create the queries for the numeric variables of an FMU
+    @param obj the FMU object
+    @param statisticNames the names of the counters included in the "stats" query*/
+    VariableQueries(const fmi2Object& obj, std::vector<std::string> statisticNames);
+    /** answer a query, called on any thread
+    @return the json response or an empty string if the query is not a variable query*/
+    std::string query(std::string_view queryString);
+    /** read the queried variables into a new snapshot, called by the stepping thread after a step
+    @param obj the FMU object the queries were created for
+    @param time the simulation time of the step
+    @param statistics the values of the counters in the order of the statistic names*/
+    void update(const fmi2Object& obj, double time, std::initializer_list<double> statistics);
+    /** get the number of variables read after each step, called by the stepping thread*/
+    [[nodiscard]] std::size_t variableCount() const;
+
+  private:
+    /** add the requested variables to the layout, called by the stepping thread*/
+    void loadRequests(const fmi2Object& obj);
+    /** record variables to read after the next step*/
+    void request(const std::vector<std::string>& names);
+    /** get a snapshot to fill, reusing the previous snapshot when no query holds it*/
+    std::shared_ptr<VariableSnapshot> acquire();
+
+    std::vector<std::string> candidateNames;  //!< the sorted names of the numeric variables
+    std::unordered_set<std::string_view> candidates;  //!< lookup of the candidate names
+    std::vector<std::string> statNames;
+    std::shared_ptr<VariableSnapshot> current;  //!< the last snapshot, accessed atomically
+    std::shared_ptr<VariableSnapshot> spare;  //!< the previous snapshot of the stepping thread
+    std::shared_ptr<const SnapshotLayout> layout;  //!< the variables read after each step
+    FmiVariableSet realSet;  //!< the real valued variables read in a single call
+    std::vector<FmiVariable> otherVariables;  //!< the integer, enumeration, and boolean variables
+    std::uint64_t steps{0};
+    mutable std::mutex requestLock;  //!< protects the requested names
+    std::vector<std::string> requested;  //!< names waiting to be added to the layout
+    std::unordered_set<std::string> known;  //!< every name requested so far
+    std::atomic<bool> pendingRequests{false};
+};
+
+}  // namespace helicsfmi
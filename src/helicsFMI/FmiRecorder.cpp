@@ -0,0 +1,208 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "FmiRecorder.hpp"
+
+#include "FmiHelics.hpp"
+
+#include <cstring>
+#include <fmt/format.h>
+
+namespace helicsfmi {
+
+static constexpr char recordingMagic[8] = {'H', 'F', 'M', 'I', 'R', 'E', 'C', '1'};
+static constexpr std::size_t recordBufferSize{1U << 16U};
+
+template<typename ValueType>
+static void writeValue(std::ofstream& output, ValueType value)
+{
+    output.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename ValueType>
+static bool readValue(std::ifstream& input, ValueType& value)
+{
+    return static_cast<bool>(input.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+InputRecorder::InputRecorder(std::string file, double start, double stop):
+    fileName(std::move(file)), buffer(std::make_unique<char[]>(recordBufferSize))
+{
+    // the buffer must be set before the file is opened to take effect
+    output.rdbuf()->pubsetbuf(buffer.get(), recordBufferSize);
+    output.open(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        throw(Error("InputRecorder", fmt::format("unable to open {}", fileName), -101));
+    }
+    output.write(recordingMagic, sizeof(recordingMagic));
+    writeValue(output, start);
+    writeValue(output, stop);
+}
+
+std::uint32_t InputRecorder::variable(const std::string& name)
+{
+    auto [entry, added] = variables.emplace(name, static_cast<std::uint32_t>(variables.size()));
+    if (added) {
+        writeValue(output, RecordKind::variable);
+        writeValue(output, static_cast<std::uint32_t>(name.size()));
+        output.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+    return entry->second;
+}
+
+void InputRecorder::writeHeader(RecordKind kind, double time)
+{
+    writeValue(output, kind);
+    writeValue(output, time);
+    ++recordCount;
+}
+
+void InputRecorder::value(double time, std::uint32_t index, double val)
+{
+    writeHeader(RecordKind::value, time);
+    writeValue(output, index);
+    writeValue(output, val);
+}
+
+void InputRecorder::text(double time, std::uint32_t index, std::string_view val)
+{
+    writeHeader(RecordKind::text, time);
+    writeValue(output, index);
+    writeValue(output, static_cast<std::uint32_t>(val.size()));
+    output.write(val.data(), static_cast<std::streamsize>(val.size()));
+}
+
+void InputRecorder::derivative(double time, std::uint32_t index, int order, double val)
+{
+    writeHeader(RecordKind::derivative, time);
+    writeValue(output, index);
+    writeValue(output, static_cast<std::uint8_t>(order));
+    writeValue(output, val);
+}
+
+void InputRecorder::step(double start, double size)
+{
+    writeHeader(RecordKind::step, start);
+    writeValue(output, size);
+}
+
+void InputRecorder::savepoint(double time)
+{
+    writeHeader(RecordKind::savepoint, time);
+}
+
+void InputRecorder::rollback(double time)
+{
+    writeHeader(RecordKind::rollback, time);
+}
+
+void InputRecorder::enterStepMode(double time)
+{
+    writeHeader(RecordKind::stepMode, time);
+}
+
+void InputRecorder::close()
+{
+    if (output.is_open()) {
+        output.close();
+    }
+}
+
+InputRecording loadInputRecording(const std::string& fileName)
+{
+    std::ifstream input(fileName, std::ios::in | std::ios::binary);
+    if (!input.is_open()) {
+        throw(Error("InputRecording", fmt::format("unable to open {}", fileName), -101));
+    }
+    InputRecording recording;
+    char magic[sizeof(recordingMagic)] = {};
+    input.read(magic, sizeof(magic));
+    if (!input || std::memcmp(magic, recordingMagic, sizeof(recordingMagic)) != 0 ||
+        !readValue(input, recording.startTime) || !readValue(input, recording.stopTime)) {
+        throw(Error("InputRecording", fmt::format("{} is not an input recording", fileName), -102));
+    }
+    auto truncated = [&fileName]() {
+        return Error("InputRecording", fmt::format("{} is truncated", fileName), -102);
+    };
+    RecordKind kind{RecordKind::value};
+    // the number of entries when the FMU state was last saved, a rollback returns to it
+    std::size_t savedEntries{0};
+    bool saved{false};
+    while (readValue(input, kind)) {
+        if (kind == RecordKind::variable) {
+            std::uint32_t length{0};
+            if (!readValue(input, length)) {
+                throw(truncated());
+            }
+            auto& name = recording.names.emplace_back(length, '\0');
+            if (!input.read(name.data(), length)) {
+                throw(truncated());
+            }
+            continue;
+        }
+        RecordEntry entry;
+        entry.kind = kind;
+        if (!readValue(input, entry.time)) {
+            throw(truncated());
+        }
+        bool valid{true};
+        switch (kind) {
+            case RecordKind::value:
+                valid = readValue(input, entry.variable) && readValue(input, entry.value);
+                break;
+            case RecordKind::text: {
+                std::uint32_t length{0};
+                valid = readValue(input, entry.variable) && readValue(input, length);
+                if (valid) {
+                    entry.text = static_cast<std::uint32_t>(recording.texts.size());
+                    auto& val = recording.texts.emplace_back(length, '\0');
+                    valid = static_cast<bool>(input.read(val.data(), length));
+                }
+            } break;
+            case RecordKind::derivative:
+                valid = readValue(input, entry.variable) && readValue(input, entry.order) &&
+                    readValue(input, entry.value);
+                break;
+            case RecordKind::step:
+                valid = readValue(input, entry.value);
+                break;
+            case RecordKind::savepoint:
+                savedEntries = recording.entries.size();
+                saved = true;
+                continue;
+            case RecordKind::rollback:
+                if (!saved) {
+                    throw(Error("InputRecording",
+                                fmt::format("rollback without a savepoint in {}", fileName),
+                                -102));
+                }
+                // the values and steps after the savepoint are replaced by the repeated ones
+                recording.entries.resize(savedEntries);
+                continue;
+            case RecordKind::stepMode:
+                break;
+            default:
+                throw(Error("InputRecording",
+                            fmt::format("invalid record in {}", fileName),
+                            -102));
+        }
+        if (!valid) {
+            throw(truncated());
+        }
+        if ((kind == RecordKind::value || kind == RecordKind::text ||
+             kind == RecordKind::derivative) &&
+            entry.variable >= recording.names.size()) {
+            throw(Error("InputRecording",
+                        fmt::format("invalid variable index in {}", fileName),
+                        -102));
+        }
+        recording.entries.push_back(entry);
+    }
+    return recording;
+}
+
+}  // namespace helicsfmi
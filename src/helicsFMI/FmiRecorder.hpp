@@ -0,0 +1,104 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace helicsfmi {
+
+/** the kinds of entries in an input recording*/
+enum class RecordKind : std::uint8_t {
+    variable = 'v',  //!< the name of the next recorded variable
+    value = 'n',  //!< a numeric value set on a variable
+    text = 's',  //!< a string value set on a variable
+    derivative = 'd',  //!< an input derivative set on a real variable
+    step = 'x',  //!< a completed FMU step
+    savepoint = 'p',  //!< the FMU state was saved so it can be restored by a rollback
+    rollback = 'r',  //!< the FMU state was restored to the last savepoint
+    stepMode = 'm'  //!< the FMU left initialization mode
+};
+
+/** write the values applied to an FMU and the steps it takes to a compact binary file
+@details each record is a kind byte followed by the time and, for values, the index of the
+variable and the value, variable names are written once before their first value, the file is
+buffered and only complete after close*/
+class InputRecorder {
+  private:
+    std::string fileName;
+    std::ofstream output;
+    std::unordered_map<std::string, std::uint32_t> variables;  //!< the index of each name
+    std::unique_ptr<char[]> buffer;  //!< the stream buffer
+    std::uint64_t recordCount{0};
+
+  public:
+    /** create a recorder
+    @param file the recording file
+    @param start the start time of the simulation
+    @param stop the stop time of the simulation
+    @throw Error if the file cannot be opened*/
+    InputRecorder(std::string file, double start, double stop);
+    /** get the index of a variable, writing its name if it is new*/
+    std::uint32_t variable(const std::string& name);
+    /** record a numeric value set on a variable*/
+    void value(double time, std::uint32_t index, double val);
+    /** record a string value set on a variable*/
+    void text(double time, std::uint32_t index, std::string_view val);
+    /** record an input derivative of a real variable
+    @param order the order of the derivative, 1 or 2*/
+    void derivative(double time, std::uint32_t index, int order, double val);
+    /** record a completed step of the FMU*/
+    void step(double start, double size);
+    /** record that the FMU state was saved so it can be restored later*/
+    void savepoint(double time);
+    /** record that the FMU state was restored to the last savepoint
+    @details every entry recorded after the savepoint is discarded when the recording is loaded*/
+    void rollback(double time);
+    /** record that the FMU left initialization mode*/
+    void enterStepMode(double time);
+    /** flush and close the file*/
+    void close();
+    /** get the number of records written*/
+    [[nodiscard]] std::uint64_t getCount() const { return recordCount; }
+    /** get the name of the recording file*/
+    [[nodiscard]] const std::string& getFileName() const { return fileName; }
+
+  private:
+    void writeHeader(RecordKind kind, double time);
+};
+
+/** an entry of a loaded input recording*/
+struct RecordEntry {
+    RecordKind kind{RecordKind::value};
+    double time{0.0};  //!< the time of the value or the start of the step
+    double value{0.0};  //!< the numeric value or the size of the step
+    std::uint32_t variable{0};  //!< the index of the variable of a value
+    std::uint32_t text{0};  //!< the index of the string of a text value
+    std::uint8_t order{0};  //!< the order of a derivative
+};
+
+/** the values and steps of a recorded federate in the order they were applied*/
+struct InputRecording {
+    double startTime{0.0};
+    double stopTime{0.0};
+    std::vector<std::string> names;  //!< the recorded variables
+    std::vector<std::string> texts;  //!< the recorded string values
+    /// the entries with those undone by a rollback removed
+    std::vector<RecordEntry> entries;
+};
+
+/** load an input recording
+@throw Error if the file cannot be read or is not an input recording*/
+InputRecording loadInputRecording(const std::string& fileName);
+
+}  // namespace helicsfmi
@@ -0,0 +1,446 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "FmiStandalone.hpp"
+
+#include "FmiHelics.hpp"
+#include "formatInterpreters/JsonProcessingFunctions.hpp"
+#include "gmlc/utilities/stringOps.h"
+#include "utilities/workStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+
+namespace helicsfmi {
+
+StandaloneCoSim::StandaloneCoSim(std::shared_ptr<fmi2CoSimObject> obj): cs(std::move(obj))
+{
+    if (!cs) {
+        throw(Error("StandaloneCoSim", "invalid co-simulation object", -101));
+    }
+}
+
+void StandaloneCoSim::configure(double step, double start)
+{
+    std::vector<std::string> names;
+    if (output_list.empty()) {
+        names = cs->getOutputNames();
+    } else {
+        names = expandVariablePatterns(output_list, cs->getAvailableOutputNames());
+    }
+    cs->setOutputVariables(std::vector<int>{});
+    cs->reserveVariables(0, names.size());
+    realOutputs.clear();
+    integerOutputs.clear();
+    booleanOutputs.clear();
+    std::vector<std::string> integerNames;
+    std::vector<std::string> booleanNames;
+    outputNames.clear();
+    for (const auto& name : names) {
+        const auto& var = cs->addOutputVariable(name);
+        if (var.index < 0) {
+            throw(Error("StandaloneCoSim",
+                        fmt::format("{} is not a recognized output", name),
+                        -102));
+        }
+        switch (var.type) {
+            case fmi_variable_type::real:
+                realOutputs.push(var.vRef);
+                outputNames.push_back(name);
+                break;
+            case fmi_variable_type::integer:
+            case fmi_variable_type::enumeration:
+                integerOutputs.push(var.vRef);
+                integerNames.push_back(name);
+                break;
+            case fmi_variable_type::boolean:
+                booleanOutputs.push_back(var);
+                booleanNames.push_back(name);
+                break;
+            default:
+                // string outputs are not recorded
+                break;
+        }
+    }
+    outputNames.insert(outputNames.end(), integerNames.begin(), integerNames.end());
+    outputNames.insert(outputNames.end(), booleanNames.begin(), booleanNames.end());
+    outputValues.assign(outputNames.size(), 0.0);
+    integerValues.assign(integerNames.size(), 0);
+
+    if (step <= 0.0) {
+        step = cs->fmuInformation().getExperiment().stepSize;
+    }
+    stepTime = (step > 0.0) ? step : 0.2;
+    startTime = start;
+}
+
+double StandaloneCoSim::run(double stop, utilities::ColumnCapture* capture)
+{
+    if (stepTime <= 0.0) {
+        configure(0.0, startTime);
+    }
+    if (stop <= 0.0) {
+        stop = cs->fmuInformation().getExperiment().stopTime;
+    }
+    if (stop <= 0.0) {
+        stop = 30.0;
+    }
+    cs->setupExperiment(false, 0, startTime, true, startTime + stop);
+    cs->setMode(FmuMode::INITIALIZATION);
+    startStepping(startTime, capture);
+    // the step times are computed from the step index so long runs do not accumulate rounding
+    const auto steps = static_cast<std::uint64_t>(std::floor(stop / stepTime + 1e-9));
+    double currentTime{startTime};
+    for (stepCount = 0; stepCount < steps; ++stepCount) {
+        const double stepStart = startTime + static_cast<double>(stepCount) * stepTime;
+        cs->doStep(stepStart, stepTime, true);
+        currentTime = startTime + static_cast<double>(stepCount + 1) * stepTime;
+        readOutputs();
+        if (capture != nullptr) {
+            capture->addRow(currentTime, outputValues.data());
+        }
+    }
+    return currentTime - startTime;
+}
+
+double StandaloneCoSim::replay(const InputRecording& recording, utilities::ColumnCapture* capture)
+{
+    if (stepTime <= 0.0) {
+        configure(0.0, recording.startTime);
+    }
+    const auto& info = cs->fmuInformation();
+    std::vector<FmiVariable> variables;
+    variables.reserve(recording.names.size());
+    for (const auto& name : recording.names) {
+        const auto& var = info.getVariableInfo(name);
+        if (var.index < 0) {
+            throw(Error("StandaloneCoSim",
+                        fmt::format("{} is not a variable of the FMU", name),
+                        -102));
+        }
+        variables.emplace_back(var);
+    }
+    cs->setupExperiment(false, 0, recording.startTime, true, recording.stopTime);
+    cs->setMode(FmuMode::INITIALIZATION);
+    bool stepping{false};
+    double currentTime{recording.startTime};
+    stepCount = 0;
+    for (const auto& entry : recording.entries) {
+        switch (entry.kind) {
+            case RecordKind::value:
+                cs->set(variables[entry.variable], entry.value);
+                break;
+            case RecordKind::text:
+                cs->set(variables[entry.variable], recording.texts[entry.text]);
+                break;
+            case RecordKind::derivative:
+                cs->setInputDerivatives(
+                    FmiVariableSet(variables[entry.variable].vRef), entry.order, &entry.value);
+                break;
+            case RecordKind::stepMode:
+                if (!stepping) {
+                    startStepping(currentTime, capture);
+                    stepping = true;
+                }
+                break;
+            case RecordKind::step:
+                if (!stepping) {
+                    startStepping(currentTime, capture);
+                    stepping = true;
+                }
+                cs->doStep(entry.time, entry.value, true);
+                ++stepCount;
+                currentTime = entry.time + entry.value;
+                readOutputs();
+                if (capture != nullptr) {
+                    capture->addRow(currentTime, outputValues.data());
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    if (!stepping) {
+        startStepping(currentTime, capture);
+    }
+    return currentTime - recording.startTime;
+}
+
+void StandaloneCoSim::startStepping(double time, utilities::ColumnCapture* capture)
+{
+    cs->setMode(FmuMode::STEP);
+    readOutputs();
+    if (capture != nullptr) {
+        capture->addRow(time, outputValues.data());
+    }
+}
+
+void StandaloneCoSim::reset()
+{
+    cs->reset();
+    stepCount = 0;
+}
+
+void StandaloneCoSim::readOutputs()
+{
+    double* row = outputValues.data();
+    const auto realCount = realOutputs.getVRcount();
+    if (realCount > 0) {
+        cs->get(realOutputs, row);
+    }
+    row += realCount;
+    if (!integerValues.empty()) {
+        cs->get(integerOutputs, integerValues.data());
+        for (auto value : integerValues) {
+            *row++ = static_cast<double>(value);
+        }
+    }
+    for (const auto& var : booleanOutputs) {
+        *row++ = cs->get<bool>(var) ? 1.0 : 0.0;
+    }
+}
+
+/** convert a json value to the string form used to set a variable*/
+static std::string tableValue(const Json::Value& value)
+{
+    if (value.isNull()) {
+        return {};
+    }
+    if (value.isBool()) {
+        return value.asBool() ? "1" : "0";
+    }
+    if (value.isString()) {
+        return value.asString();
+    }
+    return fileops::generateJsonString(value);
+}
+
+static ParameterTable loadJsonParameterTable(const std::string& fileName)
+{
+    Json::Value doc;
+    try {
+        doc = fileops::loadJson(fileName);
+    }
+    catch (const std::invalid_argument& e) {
+        throw(Error("ParameterSweep", e.what(), -102));
+    }
+    if (doc.isObject() && doc.isMember("cases")) {
+        doc = doc["cases"];
+    }
+    if (!doc.isArray()) {
+        throw(Error("ParameterSweep",
+                    fmt::format("{} does not contain an array of cases", fileName),
+                    -102));
+    }
+    ParameterTable table;
+    std::unordered_map<std::string, std::size_t> columns;
+    for (const auto& item : doc) {
+        if (!item.isObject()) {
+            throw(Error("ParameterSweep", "each case must be an object of parameter values", -102));
+        }
+        auto& values = table.cases.emplace_back(table.names.size());
+        for (const auto& name : item.getMemberNames()) {
+            auto [column, added] = columns.emplace(name, table.names.size());
+            if (added) {
+                table.names.push_back(name);
+            }
+            if (values.size() < table.names.size()) {
+                values.resize(table.names.size());
+            }
+            values[column->second] = tableValue(item[name]);
+        }
+    }
+    // cases before a parameter first appeared do not set it
+    for (auto& values : table.cases) {
+        values.resize(table.names.size());
+    }
+    return table;
+}
+
+static ParameterTable loadCsvParameterTable(const std::string& fileName)
+{
+    std::ifstream input(fileName);
+    if (!input) {
+        throw(Error("ParameterSweep", fmt::format("unable to open {}", fileName), -101));
+    }
+    ParameterTable table;
+    std::string line;
+    while (std::getline(input, line)) {
+        gmlc::utilities::stringOps::trimString(line);
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        auto fields = gmlc::utilities::stringOps::splitline(line, ",");
+        for (auto& field : fields) {
+            gmlc::utilities::stringOps::trimString(field);
+            field = gmlc::utilities::stringOps::removeQuotes(field);
+        }
+        if (table.names.empty()) {
+            table.names = std::move(fields);
+            continue;
+        }
+        if (fields.size() > table.names.size()) {
+            throw(Error("ParameterSweep",
+                        fmt::format("case {} has more values than parameters", table.cases.size()),
+                        -102));
+        }
+        fields.resize(table.names.size());
+        table.cases.push_back(std::move(fields));
+    }
+    return table;
+}
+
+ParameterTable loadParameterTable(const std::string& fileName)
+{
+    if (getFileType(fileName) == FileType::json) {
+        return loadJsonParameterTable(fileName);
+    }
+    return loadCsvParameterTable(fileName);
+}
+
+ParameterSweep::ParameterSweep(std::shared_ptr<FmiLibrary> fmi, ParameterTable cases):
+    library(std::move(fmi)), table(std::move(cases))
+{
+    if (!library || !library->checkFlag(fmuCapabilityFlags::coSimulationCapable)) {
+        throw(Error("ParameterSweep", "FMU is not co-simulation capable", -101));
+    }
+    // the first instance is created immediately to check flags and variable names
+    std::lock_guard<std::mutex> lock(instanceLock);
+    idle.push_back(createInstance());
+}
+
+bool ParameterSweep::setFlag(const std::string& flag, bool val)
+{
+    flags.emplace_back(flag, val);
+    bool used{false};
+    for (auto& instance : idle) {
+        used = (*instance)->setFlag(flag, val) || used;
+    }
+    return used;
+}
+
+void ParameterSweep::configure(double step, double start)
+{
+    const auto& info = library->getInfo();
+    for (const auto& name : table.names) {
+        if (info->getVariableInfo(name).index < 0) {
+            throw(Error("ParameterSweep",
+                        fmt::format("{} is not a variable of the FMU", name),
+                        -102));
+        }
+    }
+    stepTime = step;
+    startTime = start;
+    std::lock_guard<std::mutex> lock(instanceLock);
+    for (auto& instance : idle) {
+        instance->setOutputs(output_list);
+        instance->configure(stepTime, startTime);
+    }
+    outputNames = idle.front()->getOutputNames();
+}
+
+std::size_t ParameterSweep::run(double stop, const std::string& outputFile)
+{
+    const std::size_t paramCount = table.names.size();
+    const std::size_t columns = paramCount + outputNames.size();
+    std::vector<double> results(table.cases.size() * columns,
+                                std::numeric_limits<double>::quiet_NaN());
+    std::atomic<std::size_t> failures{0};
+    utilities::WorkStealingPool pool(threadCount);
+    pool.parallelFor(table.cases.size(), [&](std::size_t caseIndex) {
+        const auto& values = table.cases[caseIndex];
+        double* row = results.data() + caseIndex * columns;
+        for (std::size_t ii = 0; ii < paramCount; ++ii) {
+            char* end{nullptr};
+            const double value = std::strtod(values[ii].c_str(), &end);
+            if (end != values[ii].c_str()) {
+                row[ii] = value;
+            }
+        }
+        std::unique_ptr<StandaloneCoSim> instance;
+        try {
+            instance = acquireInstance();
+            for (const auto& [name, value] : parameters) {
+                instance->set(name, value);
+            }
+            for (std::size_t ii = 0; ii < paramCount; ++ii) {
+                if (!values[ii].empty()) {
+                    instance->set(table.names[ii], values[ii]);
+                }
+            }
+            instance->run(stop);
+            const auto& outputs = instance->getOutputValues();
+            std::copy(outputs.begin(), outputs.end(), row + paramCount);
+        }
+        catch (const std::exception&) {
+            ++failures;
+        }
+        if (instance) {
+            releaseInstance(std::move(instance));
+        }
+    });
+
+    std::vector<std::string> names = table.names;
+    names.insert(names.end(), outputNames.begin(), outputNames.end());
+    utilities::ColumnCapture store(outputFile,
+                                   std::move(names),
+                                   utilities::getCaptureFormat(outputFile));
+    for (std::size_t ii = 0; ii < table.cases.size(); ++ii) {
+        store.addRow(static_cast<double>(ii), results.data() + ii * columns);
+    }
+    store.close();
+    return failures.load();
+}
+
+std::unique_ptr<StandaloneCoSim> ParameterSweep::acquireInstance()
+{
+    std::lock_guard<std::mutex> lock(instanceLock);
+    if (idle.empty()) {
+        auto instance = createInstance();
+        instance->setOutputs(output_list);
+        instance->configure(stepTime, startTime);
+        return instance;
+    }
+    auto instance = std::move(idle.back());
+    idle.pop_back();
+    return instance;
+}
+
+void ParameterSweep::releaseInstance(std::unique_ptr<StandaloneCoSim> instance)
+{
+    try {
+        instance->reset();
+    }
+    catch (const std::exception&) {
+        // an instance that cannot be reset is freed and replaced when needed
+        return;
+    }
+    std::lock_guard<std::mutex> lock(instanceLock);
+    idle.push_back(std::move(instance));
+}
+
+std::unique_ptr<StandaloneCoSim> ParameterSweep::createInstance()
+{
+    std::shared_ptr<fmi2CoSimObject> obj =
+        library->createCoSimulationObject(fmt::format("sweep_{}", instanceCount));
+    if (!obj) {
+        throw(Error("ParameterSweep", "unable to create co-simulation instance", -101));
+    }
+    ++instanceCount;
+    for (const auto& [flag, val] : flags) {
+        obj->setFlag(flag, val);
+    }
+    return std::make_unique<StandaloneCoSim>(std::move(obj));
+}
+
+}  // namespace helicsfmi
@@ -0,0 +1,169 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "FmiRecorder.hpp"
+#include "fmi/fmi_import/fmiImport.h"
+#include "fmi/fmi_import/fmiObjects.h"
+#include "utilities/columnCapture.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace helicsfmi {
+
+/** run a co-simulation FMU by calling doStep in a loop without any HELICS objects
+@details the inputs keep the values they were set to, the numeric outputs are read after every
+step and can be captured to a file*/
+class StandaloneCoSim {
+  private:
+    std::shared_ptr<fmi2CoSimObject> cs;  //!< the co-simulation object
+    std::vector<std::string> output_list;
+    /// the recorded outputs, reals then integers then booleans
+    std::vector<std::string> outputNames;
+    FmiVariableSet realOutputs;
+    FmiVariableSet integerOutputs;  //!< the integer and enumeration outputs
+    std::vector<FmiVariable> booleanOutputs;
+    std::vector<double> outputValues;  //!< the values of the recorded outputs after the last step
+    std::vector<fmi2Integer> integerValues;
+    double stepTime{0.0};
+    double startTime{0.0};
+    std::uint64_t stepCount{0};
+
+  public:
+    explicit StandaloneCoSim(std::shared_ptr<fmi2CoSimObject> obj);
+    /** set the outputs to record, names or patterns as in CoSimFederate::setOutputs
+    @details the default outputs of the FMU are recorded if none are given*/
+    void setOutputs(std::vector<std::string> output_names)
+    {
+        output_list = std::move(output_names);
+    }
+    /** select the outputs and the step size
+    @param step the step size, 0 uses the default experiment of the FMU
+    @param start the start time of the simulation*/
+    void configure(double step, double start = 0.0);
+    /** set a parameter or input*/
+    template<typename ValueType>
+    void set(const std::string& name, const ValueType& value)
+    {
+        cs->set(name, value);
+    }
+    /** set a flag on the FMU object*/
+    bool setFlag(const std::string& flag, bool val) { return cs->setFlag(flag, val); }
+    /** run from the start time to the stop time
+    @param stop the duration of the simulation, 0 uses the default experiment of the FMU
+    @param capture an optional capture receiving the outputs after every step
+    @return the time reached*/
+    double run(double stop, utilities::ColumnCapture* capture = nullptr);
+    /** replay the inputs recorded from a co-simulation federate
+    @details the FMU starts at the start time of the recording, the recorded values are set and the
+    recorded steps are taken in the order they were applied to the federate FMU, the step size is
+    not used, parameters set before the federate was initialized must be set again
+    @param recording the loaded recording
+    @param capture an optional capture receiving the outputs after every step
+    @return the time reached
+    @throw Error if a recorded variable is not a variable of the FMU*/
+    double replay(const InputRecording& recording, utilities::ColumnCapture* capture = nullptr);
+    /** reset the FMU to its initial state so it can be run again
+    @details the selected outputs are kept, parameters must be set again*/
+    void reset();
+    /** get the names of the recorded outputs*/
+    [[nodiscard]] const std::vector<std::string>& getOutputNames() const { return outputNames; }
+    /** get the values of the recorded outputs after the last step*/
+    [[nodiscard]] const std::vector<double>& getOutputValues() const { return outputValues; }
+    /** get the number of steps taken in the last run*/
+    [[nodiscard]] std::uint64_t getStepCount() const { return stepCount; }
+    /** get the step size*/
+    [[nodiscard]] double getStepTime() const { return stepTime; }
+    /** get the underlying co-simulation object*/
+    fmi2CoSimObject* operator->() { return cs.get(); }
+
+  private:
+    /** read the recorded outputs into the output values*/
+    void readOutputs();
+    /** leave initialization mode and read the initial outputs*/
+    void startStepping(double time, utilities::ColumnCapture* capture);
+};
+
+/** a table of parameter values where each row is a case*/
+struct ParameterTable {
+    std::vector<std::string> names;  //!< the parameter names
+    std::vector<std::vector<std::string>> cases;  //!< the values of each case, empty is not set
+};
+
+/** load a parameter table
+@details csv files have a header row with the parameter names and a row for each case, json files
+contain an array of objects, or an object with a "cases" array, mapping parameter names to values
+@throw Error if the file cannot be read*/
+ParameterTable loadParameterTable(const std::string& fileName);
+
+/** run a single FMU once for each case of a parameter table on a thread pool
+@details the FMU is loaded once, each worker steps its own co-simulation instance which is reset
+between cases, the final values of the outputs of every case are collected into a single file*/
+class ParameterSweep {
+  private:
+    std::shared_ptr<FmiLibrary> library;  //!< the library used to create the instances
+    ParameterTable table;
+    std::vector<std::pair<std::string, std::string>> parameters;  //!< values set in every case
+    std::vector<std::pair<std::string, bool>> flags;  //!< flags applied to every instance
+    std::vector<std::string> output_list;
+    std::vector<std::unique_ptr<StandaloneCoSim>> idle;  //!< instances waiting for a case
+    std::mutex instanceLock;  //!< protects the idle instances and the instance count
+    std::size_t instanceCount{0};
+    unsigned int threadCount{0};
+    double stepTime{0.0};
+    double startTime{0.0};
+    std::vector<std::string> outputNames;
+
+  public:
+    /** create a sweep
+    @param fmi a library with a loaded FMU
+    @param cases the parameter table
+    @throw Error if the FMU cannot run as a co-simulation*/
+    ParameterSweep(std::shared_ptr<FmiLibrary> fmi, ParameterTable cases);
+    /** set a parameter used by every case, the values of the table take precedence*/
+    void set(const std::string& name, const std::string& value)
+    {
+        parameters.emplace_back(name, value);
+    }
+    /** set a flag on every instance
+    @return true if the flag was recognized*/
+    bool setFlag(const std::string& flag, bool val);
+    /** set the outputs to collect, names or patterns*/
+    void setOutputs(std::vector<std::string> output_names)
+    {
+        output_list = std::move(output_names);
+    }
+    /** set the number of worker threads, 0 uses the hardware concurrency*/
+    void setThreadCount(unsigned int threads) { threadCount = threads; }
+    /** select the outputs and check the parameter names
+    @throw Error if a parameter is not a variable of the FMU*/
+    void configure(double step, double start = 0.0);
+    /** run every case and write a row with the parameters and final outputs of each case
+    @details the time column of the file holds the case index, the outputs of failed cases are NaN
+    @return the number of cases that failed*/
+    std::size_t run(double stop, const std::string& outputFile);
+    /** get the number of cases*/
+    [[nodiscard]] std::size_t size() const { return table.cases.size(); }
+    /** get the names of the collected outputs*/
+    [[nodiscard]] const std::vector<std::string>& getOutputNames() const { return outputNames; }
+
+  private:
+    /** get an idle instance or create a new one*/
+    std::unique_ptr<StandaloneCoSim> acquireInstance();
+    /** reset an instance and return it to the idle instances*/
+    void releaseInstance(std::unique_ptr<StandaloneCoSim> instance);
+    /** create a new instance with the sweep flags, the instance lock must be held*/
+    std::unique_ptr<StandaloneCoSim> createInstance();
+};
+
+}  // namespace helicsfmi
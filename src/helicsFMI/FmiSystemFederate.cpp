@@ -0,0 +1,363 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "FmiSystemFederate.hpp"
+
+#include "FmiHelicsLogging.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <tuple>
+#include <utility>
+
+namespace helicsfmi {
+
+CouplingMethod getCouplingMethod(std::string_view method)
+{
+    if (method == "jacobi") {
+        return CouplingMethod::jacobi;
+    }
+    if (method == "gauss_seidel" || method == "gauss-seidel" || method == "gs") {
+        return CouplingMethod::gauss_seidel;
+    }
+    throw(Error("SystemFederate", fmt::format("unrecognized coupling method {}", method), -102));
+}
+
+SystemFederate::SystemFederate(std::string_view name, const helics::FederateInfo& fedInfo):
+    fed(name, fedInfo)
+{
+}
+
+SystemFederate::SystemFederate(std::string_view name,
+                               helics::CoreApp& core,
+                               const helics::FederateInfo& fedInfo):
+    fed(name, core, fedInfo)
+{
+}
+
+void SystemFederate::addFMU(std::shared_ptr<fmi2CoSimObject> obj)
+{
+    if (!obj) {
+        throw(Error("SystemFederate", "invalid co-simulation object", -101));
+    }
+    obj->getLogger()->setLoggerCallback(
+        [this](std::string_view category, std::string_view message) {
+            fed.logMessage(fmiCategory2HelicsLogLevel(category), message);
+        });
+    fmus.push_back(std::move(obj));
+}
+
+std::pair<std::size_t, std::string> SystemFederate::findFMU(const std::string& name) const
+{
+    const auto sep = name.find_first_of('.');
+    if (sep != std::string::npos) {
+        for (std::size_t ii = 0; ii < fmus.size(); ++ii) {
+            if (name.compare(0, sep, fmus[ii]->getName()) == 0) {
+                return {ii, name.substr(sep + 1)};
+            }
+        }
+    }
+    return {fmus.size(), name};
+}
+
+void SystemFederate::configure(helics::Time step, helics::Time startTime)
+{
+    timeBias = startTime;
+    logLevel = fed.getIntegerProperty(HELICS_PROPERTY_INT_LOG_LEVEL);
+    for (std::size_t ii = 0; ii < fmus.size(); ++ii) {
+        auto& fmu = *fmus[ii];
+        const auto& info = fmu.fmuInformation();
+        // the names match those of a separate federate named after the FMU
+        for (const auto& input : fmu.getInputNames()) {
+            const auto& var = fmu.addInputVariable(input);
+            if (var.index < 0) {
+                fed.logWarningMessage(input + " is not a recognized input");
+                continue;
+            }
+            inputs.push_back(fed.registerGlobalInput(fmt::format("{}.{}", fmu.getName(), input),
+                                                     getHelicsTypeString(var.type),
+                                                     info.getVariableInfo(var.index).unit));
+            inputTarget.emplace_back(ii, static_cast<std::size_t>(fmu.inputSize() - 1));
+        }
+        for (const auto& output : fmu.getOutputNames()) {
+            const auto& var = fmu.addOutputVariable(output);
+            if (var.index < 0) {
+                fed.logWarningMessage(output + " is not a recognized output");
+                continue;
+            }
+            pubs.push_back(
+                fed.registerGlobalPublication(fmt::format("{}.{}", fmu.getName(), output),
+                                              getHelicsTypeString(var.type),
+                                              info.getVariableInfo(var.index).unit));
+            pubSource.emplace_back(ii, static_cast<std::size_t>(fmu.outputSize() - 1));
+        }
+    }
+    if (step <= helics::timeZero && !fmus.empty()) {
+        step = fmus.front()->fmuInformation().getExperiment().stepSize;
+    }
+    if (step <= helics::timeZero) {
+        auto tstep = fed.getTimeProperty(HELICS_PROPERTY_TIME_PERIOD);
+        step = (tstep > helics::timeEpsilon) ? tstep : helics::Time(0.2);
+    }
+    stepTime = step;
+    fed.setProperty(HELICS_PROPERTY_TIME_PERIOD, step);
+    LOG_FED_SUMMARY(fmt::format("\n  system federate:\n\t{} FMUs\n\t{} inputs\n\t{} publications"
+                                "\n\t{} coupling\n\tstep size={}",
+                                fmus.size(),
+                                inputs.size(),
+                                pubs.size(),
+                                (coupling == CouplingMethod::jacobi) ? "jacobi" : "gauss seidel",
+                                static_cast<double>(stepTime)));
+}
+
+bool SystemFederate::setFlag(const std::string& flag, bool val)
+{
+    bool used{false};
+    for (auto& fmu : fmus) {
+        used = fmu->setFlag(flag, val) || used;
+    }
+    if (used) {
+        return true;
+    }
+    const int param = helics::getFlagIndex(flag);
+    if (param != HELICS_INVALID_OPTION_INDEX) {
+        fed.setFlagOption(param, val);
+        return true;
+    }
+    return false;
+}
+
+void SystemFederate::logMessage(int helicsLogLevel, std::string_view message)
+{
+    fed.logMessage(helicsLogLevel, message);
+}
+
+void SystemFederate::loadLocalLinks()
+{
+    const auto connections = getLocalConnections(fed, pubs, inputs, remotePubs);
+    localInputs.assign(inputs.size(), false);
+    links.clear();
+    fmuLinks.assign(fmus.size(), {});
+    for (const auto& connection : connections) {
+        if (localInputs[connection.input]) {
+            fed.logWarningMessage(fmt::format("{} has multiple local sources, using the first",
+                                              inputs[connection.input].getName()));
+            continue;
+        }
+        LocalLink link;
+        std::tie(link.sourceFmu, link.output) = pubSource[connection.publication];
+        std::tie(link.targetFmu, link.input) = inputTarget[connection.input];
+        const auto& source = *fmus[link.sourceFmu];
+        const auto& target = *fmus[link.targetFmu];
+        const auto& output = source.getOutput(static_cast<int>(link.output));
+        const auto& input = target.getInput(static_cast<int>(link.input));
+        if (output.type == +fmi_variable_type::real && input.type == +fmi_variable_type::real) {
+            const auto& sourceUnits = source.fmuInformation().getVariableInfo(output.index).unit;
+            const auto& targetUnits = target.fmuInformation().getVariableInfo(input.index).unit;
+            if (!sourceUnits.empty() && !targetUnits.empty() && sourceUnits != targetUnits &&
+                !getUnitConversion(source.fmuInformation().getUnit(sourceUnits),
+                                   target.fmuInformation().getUnit(targetUnits),
+                                   link.conversion)) {
+                fed.logWarningMessage(fmt::format("{} units ({}) are not convertible to {}",
+                                                  inputs[connection.input].getName(),
+                                                  sourceUnits,
+                                                  targetUnits));
+            }
+        }
+        localInputs[connection.input] = true;
+        fmuLinks[link.targetFmu].push_back(links.size());
+        links.push_back(link);
+        LOG_FED_CONNECTIONS(fmt::format("local connection {} to {}",
+                                        pubs[connection.publication].getName(),
+                                        inputs[connection.input].getName()));
+    }
+    loadStepOrder();
+    LOG_FED_SUMMARY(fmt::format("{} local connections, {} boundary publications, {} boundary "
+                                "inputs",
+                                links.size(),
+                                std::count(remotePubs.begin(), remotePubs.end(), true),
+                                std::count(localInputs.begin(), localInputs.end(), false)));
+}
+
+void SystemFederate::loadStepOrder()
+{
+    const std::size_t count = fmus.size();
+    std::vector<std::size_t> pending(count, 0);
+    for (const auto& link : links) {
+        if (link.sourceFmu != link.targetFmu) {
+            ++pending[link.targetFmu];
+        }
+    }
+    auto linkedFeedthrough = [this](std::size_t fmuIndex) {
+        OutputDependencies dependencies;
+        dependencies.build(*fmus[fmuIndex]);
+        std::vector<std::size_t> linkedInputs;
+        for (auto linkIndex : fmuLinks[fmuIndex]) {
+            linkedInputs.push_back(links[linkIndex].input);
+        }
+        return !dependencies.getAffectedOutputs(linkedInputs).empty();
+    };
+    std::vector<bool> placed(count, false);
+    stepOrder.clear();
+    while (stepOrder.size() < count) {
+        std::size_t next{count};
+        for (std::size_t ii = 0; ii < count && next == count; ++ii) {
+            if (!placed[ii] && pending[ii] == 0) {
+                next = ii;
+            }
+        }
+        if (next == count) {
+            // the remaining FMUs form a loop, an FMU whose outputs do not respond directly to its
+            // linked inputs loses the least by using the inputs from the previous step
+            for (std::size_t ii = 0; ii < count && next == count; ++ii) {
+                if (!placed[ii] && !linkedFeedthrough(ii)) {
+                    next = ii;
+                }
+            }
+            if (next == count) {
+                next = static_cast<std::size_t>(
+                    std::find(placed.begin(), placed.end(), false) - placed.begin());
+            }
+            LOG_FED_CONNECTIONS(
+                fmt::format("breaking a coupling loop at {}", fmus[next]->getName()));
+        }
+        placed[next] = true;
+        stepOrder.push_back(next);
+        for (const auto& link : links) {
+            if (link.sourceFmu == next && !placed[link.targetFmu]) {
+                --pending[link.targetFmu];
+            }
+        }
+    }
+}
+
+void SystemFederate::transferLinks(std::size_t fmuIndex)
+{
+    auto& target = *fmus[fmuIndex];
+    for (auto linkIndex : fmuLinks[fmuIndex]) {
+        const auto& link = links[linkIndex];
+        const auto& source = *fmus[link.sourceFmu];
+        const auto& output = source.getOutput(static_cast<int>(link.output));
+        const auto& input = target.getInput(static_cast<int>(link.input));
+        switch (input.type) {
+            case fmi_variable_type::real:
+                target.set(input,
+                           source.get<double>(output) * link.conversion.factor +
+                               link.conversion.offset);
+                break;
+            case fmi_variable_type::string:
+                target.set(input, source.get<std::string>(output));
+                break;
+            default:
+                target.set(input, source.get<fmi2Integer>(output));
+                break;
+        }
+    }
+}
+
+void SystemFederate::stepFMUs(helics::Time currentTime)
+{
+    const auto stepStart = static_cast<double>(currentTime + timeBias);
+    const auto stepSize = static_cast<double>(stepTime);
+    if (coupling == CouplingMethod::jacobi) {
+        // every transfer uses the outputs from the end of the previous step
+        for (std::size_t ii = 0; ii < fmus.size(); ++ii) {
+            transferLinks(ii);
+        }
+        pool->parallelFor(fmus.size(), [this, stepStart, stepSize](std::size_t ii) {
+            fmus[ii]->doStep(stepStart, stepSize, fmi2True);
+        });
+        return;
+    }
+    for (auto index : stepOrder) {
+        transferLinks(index);
+        fmus[index]->doStep(stepStart, stepSize, fmi2True);
+    }
+}
+
+void SystemFederate::publishOutputs()
+{
+    for (std::size_t ii = 0; ii < pubs.size(); ++ii) {
+        if (remotePubs[ii]) {
+            const auto& [fmuIndex, output] = pubSource[ii];
+            helicsfmi::publishOutput(pubs[ii], fmus[fmuIndex].get(), output);
+        }
+    }
+}
+
+void SystemFederate::grabInputs()
+{
+    const bool logValues = logLevel >= HELICS_LOG_LEVEL_DATA;
+    for (std::size_t ii = 0; ii < inputs.size(); ++ii) {
+        if (!localInputs[ii]) {
+            const auto& [fmuIndex, input] = inputTarget[ii];
+            helicsfmi::grabInput(inputs[ii], fmus[fmuIndex].get(), input, logValues);
+        }
+    }
+}
+
+double SystemFederate::initialize(double stop)
+{
+    if (stop <= helics::timeZero && !fmus.empty()) {
+        stop = fmus.front()->fmuInformation().getExperiment().stopTime;
+    }
+    if (stop <= helics::timeZero) {
+        stop = 30.0;
+    }
+    for (auto& fmu : fmus) {
+        fmu->setupExperiment(
+            false, 0, static_cast<double>(timeBias), true, static_cast<double>(timeBias + stop));
+    }
+    fed.enterInitializingMode();
+    for (auto& fmu : fmus) {
+        fmu->setMode(FmuMode::INITIALIZATION);
+    }
+    loadLocalLinks();
+    if (coupling == CouplingMethod::jacobi && !pool) {
+        pool = std::make_unique<utilities::WorkStealingPool>(
+            static_cast<unsigned int>(std::max<std::size_t>(fmus.size(), 1) - 1));
+    }
+    // propagate the initial values through the system before publishing the boundary values
+    for (auto index : stepOrder) {
+        transferLinks(index);
+    }
+    publishOutputs();
+    for (std::size_t ii = 0; ii < inputs.size(); ++ii) {
+        if (!localInputs[ii]) {
+            const auto& [fmuIndex, input] = inputTarget[ii];
+            helicsfmi::setDefault(inputs[ii], fmus[fmuIndex].get(), input);
+        }
+    }
+    LOG_FED_TIMING("initializing");
+    return stop;
+}
+
+void SystemFederate::run(helics::Time stop)
+{
+    stop = initialize(stop);
+    fed.enterExecutingMode();
+    for (auto& fmu : fmus) {
+        fmu->setMode(FmuMode::STEP);
+    }
+    grabInputs();
+
+    helics::Time currentTime = helics::timeZero;
+    while (currentTime + timeBias + stepTime <= stop) {
+        try {
+            stepFMUs(currentTime);
+        }
+        catch (const fmiException& fe) {
+            fed.localError(56, fe.what());
+            break;
+        }
+        currentTime = fed.requestNextStep();
+        publishOutputs();
+        grabInputs();
+    }
+    fed.finalize();
+}
+}  // namespace helicsfmi
@@ -0,0 +1,129 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#pragma once
+
+#include "FmiHelics.hpp"
+#include "fmi/fmi_import/fmiObjects.h"
+#include "helics/ValueFederates.hpp"
+#include "utilities/workStealingPool.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace helics {
+class CoreApp;
+}
+
+namespace helicsfmi {
+
+/** the methods for exchanging values between FMUs within a system federate*/
+enum class CouplingMethod : std::uint8_t {
+    jacobi,  //!< all FMUs use the outputs of the previous step and step in parallel
+    gauss_seidel  //!< FMUs step in dependency order using the outputs of the FMUs before them
+};
+
+/** class defining a federate containing several co-simulation FMUs
+@details the interfaces of each FMU are registered as global interfaces named "fmu.variable" so
+they match the names used when each FMU is a separate federate, once the connections are resolved
+any connection between two FMUs of the system is transferred directly between the FMUs and only
+the boundary signals go through HELICS*/
+class SystemFederate {
+  private:
+    /** a value transferred directly between two FMUs*/
+    struct LocalLink {
+        std::size_t sourceFmu{0};
+        std::size_t output{0};  //!< the output index in the source FMU
+        std::size_t targetFmu{0};
+        std::size_t input{0};  //!< the input index in the target FMU
+        UnitConversion conversion;
+    };
+    helics::ValueFederate fed;  //!< the federate
+    std::vector<std::shared_ptr<fmi2CoSimObject>> fmus;
+    std::vector<helics::Publication> pubs;
+    std::vector<std::pair<std::size_t, std::size_t>> pubSource;  //!< (fmu, output) of each pub
+    std::vector<helics::Input> inputs;
+    std::vector<std::pair<std::size_t, std::size_t>> inputTarget;  //!< (fmu, input) of each input
+    std::vector<bool> remotePubs;  //!< the publications with targets outside the system
+    std::vector<bool> localInputs;  //!< the inputs fed from within the system
+    std::vector<LocalLink> links;
+    std::vector<std::vector<std::size_t>> fmuLinks;  //!< the links targeting each FMU
+    std::vector<std::size_t> stepOrder;  //!< the order of the FMUs for gauss seidel coupling
+    std::unique_ptr<utilities::WorkStealingPool> pool;  //!< used to step FMUs in jacobi coupling
+    CouplingMethod coupling{CouplingMethod::gauss_seidel};
+    helics::Time stepTime{helics::timeEpsilon};  //!< the step time for the Federate
+    helics::Time timeBias{helics::timeZero};  //!< time shift for the federate
+    int logLevel{HELICS_LOG_LEVEL_SUMMARY};
+
+  public:
+    SystemFederate(std::string_view name, const helics::FederateInfo& fedInfo);
+    SystemFederate(std::string_view name,
+                   helics::CoreApp& core,
+                   const helics::FederateInfo& fedInfo);
+    /** add an FMU to the system, the name of the object is used as the interface prefix*/
+    void addFMU(std::shared_ptr<fmi2CoSimObject> obj);
+    /** get the number of FMUs in the system*/
+    [[nodiscard]] std::size_t size() const { return fmus.size(); }
+    /** get an FMU by index*/
+    fmi2CoSimObject& getFMU(std::size_t index) { return *fmus.at(index); }
+    /** set the coupling method used for the local connections*/
+    void setCoupling(CouplingMethod method) { coupling = method; }
+    /** get the number of connections transferred directly between FMUs*/
+    [[nodiscard]] std::size_t localConnectionCount() const { return links.size(); }
+    /** configure the federate interfaces of all the FMUs*/
+    void configure(helics::Time step, helics::Time start = helics::timeZero);
+    /** set a parameter
+    @details the name can be prefixed with an FMU name and a '.' to set the parameter on a single
+    FMU, otherwise it is set on every FMU*/
+    template<typename ValueType>
+    void set(const std::string& name, const ValueType& value)
+    {
+        auto [fmuIndex, variable] = findFMU(name);
+        if (fmuIndex < fmus.size()) {
+            fmus[fmuIndex]->set(variable, value);
+            return;
+        }
+        for (auto& fmu : fmus) {
+            fmu->set(name, value);
+        }
+    }
+    /** set flags on the FMUs or federate*/
+    bool setFlag(const std::string& flag, bool val);
+    /** run the cosimulation*/
+    void run(helics::Time stop);
+    /** get the underlying HELICS federate*/
+    helics::ValueFederate* operator->() { return &fed; }
+
+    void logMessage(int logLevel, std::string_view message);
+
+  private:
+    /** split a name into the index of a matching FMU and the variable name
+    @return an index of size() if the name does not start with an FMU name*/
+    std::pair<std::size_t, std::string> findFMU(const std::string& name) const;
+    double initialize(double stop);
+    /** detect the connections within the system and generate the step order*/
+    void loadLocalLinks();
+    /** order the FMUs so each one follows the FMUs it gets inputs from
+    @details cycles are broken at an FMU without direct feedthrough from its linked inputs if
+    possible*/
+    void loadStepOrder();
+    /** copy the linked outputs into the inputs of an FMU*/
+    void transferLinks(std::size_t fmuIndex);
+    /** step every FMU using the selected coupling method*/
+    void stepFMUs(helics::Time currentTime);
+    void publishOutputs();
+    void grabInputs();
+};
+
+/** get the coupling method from a string (jacobi, gauss_seidel)
+@throw Error if the string is not a valid method*/
+CouplingMethod getCouplingMethod(std::string_view method);
+
+}  // namespace helicsfmi
@@ -0,0 +1,51 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+/** @file
+@brief utility for reading output capture files and converting them to csv
+*/
+#include "utilities/columnCapture.h"
+
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+        std::cout << "usage: helics-fmi-capture <capture file> [output.csv]\n"
+                  << "prints a summary of the capture file or converts it to csv\n";
+        return (argc < 2) ? 1 : 0;
+    }
+    try {
+        const utilities::ColumnCaptureReader reader(argv[1]);
+        if (argc > 2) {
+            std::ofstream output(argv[2]);
+            if (!output.is_open()) {
+                std::cerr << "unable to open " << argv[2] << '\n';
+                return 2;
+            }
+            reader.writeCsv(output);
+            return 0;
+        }
+        std::cout << argv[1] << ": " << reader.rowCount() << " rows, " << reader.columnCount()
+                  << " columns\n";
+        if (reader.rowCount() > 0) {
+            const auto& time = reader.getColumn(0);
+            std::cout << "time " << time.front() << " to " << time.back() << '\n';
+        }
+        for (const auto& name : reader.getNames()) {
+            std::cout << "  " << name << '\n';
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 3;
+    }
+    return 0;
+}
@@ -11,6 +11,7 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 #include "formatInterpreters/jsonReaderElement.h"
 #include "formatInterpreters/tinyxml2ReaderElement.h"
 #include "formatInterpreters/tomlReaderElement.h"
+#include "gmlc/utilities/stringOps.h"
 #include "helics-fmi/helics-fmi-config.h"
 #include "helics/application_api/BrokerApp.hpp"
 #include "helics/application_api/CoreApp.hpp"
@@ -18,10 +19,15 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 #include "helics/core/core-exceptions.hpp"
 #include "helics/core/helicsCLI11.hpp"
 #include "helics/core/helicsVersion.hpp"
+#include "helicsFMI/FmiCheckpoint.hpp"
 #include "helicsFMI/FmiCoSimFederate.hpp"
+#include "helicsFMI/FmiEnsembleFederate.hpp"
 #include "helicsFMI/FmiHelics.hpp"
 #include "helicsFMI/FmiModelExchangeFederate.hpp"
+#include "helicsFMI/FmiStandalone.hpp"
+#include "helicsFMI/FmiSystemFederate.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <fmt/format.h>
 #include <iostream>
@@ -100,6 +106,76 @@ std::unique_ptr<CLI::App> FmiRunner::generateCLI()
     app->add_option("--step",
                     stepTime,
                     "the step size to use, specified in milliseconds or as a time string (10s)");
+    app->add_option("--min-step",
+                    minStepTime,
+                    "the smallest step size for adaptive stepping, specified in seconds or as a "
+                    "time string (10ms), defaults to the step size");
+    app->add_option("--max-step",
+                    maxStepTime,
+                    "the largest step size for adaptive stepping, specified in seconds or as a "
+                    "time string (10s), setting it enables adaptive stepping");
+    app->add_option("--step-tolerance",
+                    stepTolerance,
+                    "the relative error tolerance on the output changes for adaptive stepping")
+        ->capture_default_str()
+        ->check(CLI::PositiveNumber);
+    app->add_option("--sub-step",
+                    subStepTime,
+                    "the FMU step size within each federate step, specified in seconds or as a "
+                    "time string (1ms), outputs are only published at the federate step");
+    app->add_option("--sub-step-aggregation",
+                    aggregation,
+                    "the value published for real valued outputs over the sub-steps (last, "
+                    "average, min, max)")
+        ->capture_default_str()
+        ->check(CLI::IsMember({"last", "average", "min", "max"}));
+    app->add_option("--max-iterations",
+                    maxIterations,
+                    "the maximum number of times a step is repeated until the inputs converge, "
+                    "requires an FMU that can get and set its state")
+        ->check(CLI::NonNegativeNumber);
+    app->add_option("--iteration-tolerance",
+                    iterationTolerance,
+                    "the input change that causes a step to be repeated")
+        ->capture_default_str()
+        ->check(CLI::PositiveNumber);
+    app->add_option("--discard-retries",
+                    discardRetries,
+                    "the number of times a step discarded by a co-simulation FMU with variable "
+                    "step sizes is retried with a smaller step, 0 stops the federate on a discard")
+        ->capture_default_str()
+        ->check(CLI::NonNegativeNumber);
+    app->add_option("--speculation-tolerance",
+                    speculationTolerance,
+                    "the input change that rolls back a step computed while waiting for a time "
+                    "grant, speculative steps are enabled with the speculative_step flag")
+        ->capture_default_str()
+        ->check(CLI::NonNegativeNumber);
+    app->add_option("--run-ahead",
+                    runAhead,
+                    "the number of steps a co-simulation FMU without inputs is stepped ahead of "
+                    "the time grants on a background thread, 0 steps at each grant")
+        ->capture_default_str()
+        ->check(CLI::NonNegativeNumber);
+    app->add_option("--extrapolation",
+                    extrapolation,
+                    "the estimate of the real valued inputs of co-simulation FMUs between updates "
+                    "(hold, linear, quadratic)")
+        ->capture_default_str()
+        ->check(CLI::IsMember({"hold", "linear", "quadratic"}));
+    app->add_option("--pacing",
+                    pacing,
+                    "align the steps of the federates with the wall clock, specified as the wall "
+                    "clock seconds per simulated second (1.0 is real time), 0 disables pacing")
+        ->check(CLI::NonNegativeNumber);
+    app->add_flag("--pacing-lock-memory",
+                  pacingLockMemory,
+                  "lock the process memory into RAM for paced runs");
+    app->add_option("--pacing-cpu",
+                    pacingProcessor,
+                    "pin the stepping thread of each paced federate to a processor, starting "
+                    "from this processor, -1 leaves the threads unpinned")
+        ->capture_default_str();
     auto* stopOpt = app->add_option(
         "--stop",
         stopTime,
@@ -114,12 +190,15 @@ std::unique_ptr<CLI::App> FmiRunner::generateCLI()
     app->allow_extras();
     app->set_config("--config-file");
 
-    app->add_option("--output_variables", output_variables, "Specify outputs of the FMU by name")
+    app->add_option("--output_variables",
+                    output_variables,
+                    "Specify outputs of the FMU by name, glob pattern (*,?), or regex:<expression>")
         ->ignore_underscore()
         ->delimiter(',');
     app->add_option("--input_variables",
                     input_variables,
-                    "Specify the input variables of the FMU by name")
+                    "Specify the input variables of the FMU by name, glob pattern (*,?), or "
+                    "regex:<expression>")
         ->ignore_underscore()
         ->delimiter(',');
     app->add_option(
@@ -141,6 +220,94 @@ std::unique_ptr<CLI::App> FmiRunner::generateCLI()
     app->add_flag("!--modelexchange",
                   cosimFmu,
                   "specify that the fmu should run as a model exchange FMU if possible");
+    app->add_flag("--direct",
+                  directRun,
+                  "step a single co-simulation FMU directly without a broker, core, or federate, "
+                  "the FMU inputs keep their initial or --set values");
+    app->add_option("--output-abstol",
+                    outputAbsTolerance,
+                    "absolute deadband for numeric outputs, smaller changes are not published")
+        ->check(CLI::NonNegativeNumber);
+    app->add_option("--output-reltol",
+                    outputRelTolerance,
+                    "relative deadband for numeric outputs, smaller changes are not published")
+        ->check(CLI::NonNegativeNumber);
+    app->add_option("--locals",
+                    localOutputs,
+                    "which local FMU variables can be published: none, only those listed as "
+                    "outputs, or all")
+        ->capture_default_str()
+        ->check(CLI::IsMember({"none", "listed", "all"}));
+    app->add_option("--capture",
+                    captureFile,
+                    "capture the numeric outputs of co-simulation FMUs to a file (.csv, .hcap for "
+                    "binary, or .hcapz for compressed binary)");
+    const CLI::Validator groupFormat(
+        [](std::string& group) {
+            const auto eloc = group.find_first_of('=');
+            if (eloc == 0 || eloc == std::string::npos || eloc + 1 == group.size()) {
+                return std::string("groups must be specified as name=variable,variable");
+            }
+            return std::string{};
+        },
+        "name=variable,variable");
+    app->add_option("--output-group",
+                    outputGroups,
+                    "publish a group of real valued outputs as a single vector, specified as "
+                    "name=variable,variable with names or patterns, groups are separated by ';'")
+        ->delimiter(';')
+        ->check(groupFormat);
+    app->add_option("--input-group",
+                    inputGroups,
+                    "receive a group of real valued inputs as a single vector, specified as "
+                    "name=variable,variable with names or patterns, groups are separated by ';'")
+        ->delimiter(';')
+        ->check(groupFormat);
+    app->add_option("--record-inputs",
+                    recordFile,
+                    "record the inputs applied to co-simulation FMUs and the steps they take to a "
+                    "binary file which can be replayed without HELICS");
+    app->add_option("--replay",
+                    replayFile,
+                    "replay an input recording on a single co-simulation FMU as fast as possible "
+                    "without a broker, core, or federate")
+        ->check(CLI::ExistingFile);
+    app->add_option("--sweep",
+                    sweepFile,
+                    "run a single co-simulation FMU once for each case of a parameter table (.csv "
+                    "or .json) without HELICS");
+    app->add_option("--sweep-output",
+                    sweepOutput,
+                    "the file collecting the parameters and final outputs of every sweep case "
+                    "(.csv, .hcap, or .hcapz)")
+        ->capture_default_str();
+    app->add_option("--sweep-threads",
+                    sweepThreads,
+                    "the number of worker threads for a parameter sweep, 0 uses the hardware "
+                    "concurrency")
+        ->capture_default_str();
+    auto* intervalOpt =
+        app->add_option("--checkpoint-interval",
+                        checkpointInterval,
+                        "the simulated time between checkpoints, specified in seconds or as a time "
+                        "string (1h), it should be a multiple of the step times of the federates");
+    app->add_option("--checkpoint",
+                    checkpointFile,
+                    "periodically save the FMU states and last published values of the "
+                    "co-simulation federates to a compressed checkpoint file")
+        ->needs(intervalOpt);
+    app->add_option("--restart-from",
+                    restartFile,
+                    "resume the co-simulation federates from a checkpoint file at the checkpoint "
+                    "time")
+        ->check(CLI::ExistingFile);
+    app->add_option("--coupling",
+                    coupling,
+                    "step the co-simulation FMUs of a system file in a single federate and "
+                    "transfer the values of connections between them directly (none, jacobi, "
+                    "gauss_seidel)")
+        ->capture_default_str()
+        ->check(CLI::IsMember({"none", "jacobi", "gauss_seidel"}));
     app->add_option(
            "--flags",
            flags,
@@ -168,6 +335,65 @@ int FmiRunner::parse(const std::string& cliString)
     }
 }
 
+/** set the flags controlling the use of local variables as outputs on an fmi object*/
+static void setLocalOutputs(fmi2Object& obj, std::string_view mode)
+{
+    obj.setFlag("local_outputs", mode != "none");
+    obj.setFlag("default_local_outputs", mode == "all");
+}
+
+/** add vector groups defined as name=variable,variable to a federate*/
+static void
+    addVariableGroups(CoSimFederate& fed, const std::vector<std::string>& groups, bool outputs)
+{
+    for (const auto& group : groups) {
+        const auto eloc = group.find_first_of('=');
+        auto variables = gmlc::utilities::stringOps::splitline(group.substr(eloc + 1), ",");
+        for (auto& variable : variables) {
+            gmlc::utilities::stringOps::trimString(variable);
+        }
+        const auto name = gmlc::utilities::stringOps::trim(group.substr(0, eloc));
+        if (outputs) {
+            fed.addOutputGroup(name, std::move(variables));
+        } else {
+            fed.addInputGroup(name, std::move(variables));
+        }
+    }
+}
+
+/** get the file of a federate when several federates share a file option
+@details the federate name is appended to the stem of the file*/
+static std::string federateFile(const std::string& file, const std::string& name)
+{
+    std::filesystem::path fedPath(file);
+    fedPath.replace_filename(fedPath.stem().string() + "_" + name +
+                             fedPath.extension().string());
+    return fedPath.string();
+}
+
+/** set a flag on a federate, a leading '-' clears the flag*/
+template<class FedType>
+static bool setFederateFlag(FedType& fed, const std::string& flag)
+{
+    if (flag.empty()) {
+        return false;
+    }
+    if (flag.front() == '-') {
+        return fed.setFlag(flag.substr(1), false);
+    }
+    return fed.setFlag(flag, true);
+}
+
+template<class FedType>
+void FmiRunner::applyFlags(FedType& fed)
+{
+    for (std::size_t ii = 0; ii < flags.size(); ++ii) {
+        if (setFederateFlag(fed, flags[ii])) {
+            flagsUsed[ii] = true;
+        }
+    }
+}
+
 int FmiRunner::load()
 {
     if (currentState >= State::LOADED) {
@@ -180,7 +406,14 @@ int FmiRunner::load()
     if (inputFile.empty()) {
         return errorTerminate(INVALID_FILE);
     }
+    if (!sweepFile.empty()) {
+        return loadSweep(inputFile);
+    }
+    if (directRun || !replayFile.empty()) {
+        return loadDirect(inputFile);
+    }
     auto ext = inputFile.substr(inputFile.find_last_of('.'));
+    flagsUsed.assign(flags.size(), false);
     try {
         if ((ext == ".json") || (ext == ".JSON")) {
             fedInfo.loadInfoFromJson(inputFile);
@@ -243,9 +476,25 @@ int FmiRunner::load()
                 if (fedInfo.defName.empty()) {
                     fedInfo.defName = obj->getName();
                 }
-
+                setLocalOutputs(*obj, localOutputs);
                 auto fed = std::make_unique<CoSimFederate>("", std::move(obj), fedInfo);
-
+                fed->setOutputTolerance(outputAbsTolerance, outputRelTolerance);
+                fed->setAdaptiveStep(minStepTime, maxStepTime, stepTolerance);
+                fed->setIterativeStep(maxIterations, iterationTolerance);
+                fed->setDiscardRetry(discardRetries);
+                fed->setRunAhead(static_cast<std::size_t>(runAhead));
+                fed->setSpeculationTolerance(speculationTolerance);
+                fed->setInputExtrapolation(getInputExtrapolation(extrapolation));
+                fed->setSubStep(subStepTime, getOutputAggregation(aggregation));
+                if (!input_variables.empty()) {
+                    fed->setInputs(input_variables);
+                }
+                if (!output_variables.empty()) {
+                    fed->setOutputs(output_variables);
+                }
+                addVariableGroups(*fed, outputGroups, true);
+                addVariableGroups(*fed, inputGroups, false);
+                applyFlags(*fed);
                 cosimFeds.push_back(std::move(fed));
             } else {
                 std::shared_ptr<fmi2ModelExchangeObject> obj =
@@ -257,7 +506,9 @@ int FmiRunner::load()
                 if (fedInfo.defName.empty()) {
                     fedInfo.defName = obj->getName();
                 }
+                setLocalOutputs(*obj, localOutputs);
                 auto fed = std::make_unique<FmiModelExchangeFederate>("", std::move(obj), fedInfo);
+                applyFlags(*fed);
                 meFeds.push_back(std::move(fed));
             }
         }
@@ -285,27 +536,212 @@ int FmiRunner::load()
         }
     }
     currentState = State::LOADED;
-    for (const auto& flag : flags) {
-        bool used{false};
+    // the flags were applied as each federate was created so they are in place before configure
+    for (std::size_t ii = 0; ii < flags.size(); ++ii) {
+        if (!flagsUsed[ii]) {
+            LOG_WARNING(fmt::format("flag {} was not recognized ", flags[ii]));
+        }
+    }
+    if (pacing > 0.0) {
+        // each federate steps on its own thread so consecutive processors are used for pinning
+        int processor = pacingProcessor;
         for (auto& fmu : cosimFeds) {
-            if (flag.front() == '-') {
-                used |= fmu->setFlag(flag.substr(1), false);
-            } else {
-                used |= fmu->setFlag(flag, true);
-            }
+            fmu->setRealTimePacing(pacing, pacingLockMemory, processor);
+            processor = (processor >= 0) ? processor + 1 : processor;
         }
         for (auto& fmu : meFeds) {
-            if (flag.front() == '-') {
-                used |= fmu->setFlag(flag.substr(1), false);
-            } else {
-                used |= fmu->setFlag(flag, true);
-            }
+            fmu->setRealTimePacing(pacing, pacingLockMemory, processor);
+            processor = (processor >= 0) ? processor + 1 : processor;
+        }
+    }
+    // each federate writes a separate file named with the federate name
+    if (!captureFile.empty()) {
+        for (auto& fmu : cosimFeds) {
+            fmu->setOutputCapture(true,
+                                  (cosimFeds.size() == 1) ?
+                                      captureFile :
+                                      federateFile(captureFile, (*fmu)->getName()));
+        }
+    }
+    if (!recordFile.empty()) {
+        for (auto& fmu : cosimFeds) {
+            fmu->setInputRecord((cosimFeds.size() == 1) ?
+                                    recordFile :
+                                    federateFile(recordFile, (*fmu)->getName()));
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int FmiRunner::loadSweep(const std::string& fmuFile)
+{
+    if (getFileType(fmuFile) != FileType::fmu) {
+        LOG_ERROR("a parameter sweep requires a single FMU");
+        return errorTerminate(INVALID_FILE);
+    }
+    const std::string tableFile = getFilePath(sweepFile);
+    if (tableFile.empty()) {
+        LOG_ERROR(fmt::format("unable to locate file {}", sweepFile));
+        return errorTerminate(MISSING_FILE);
+    }
+    ParameterTable table;
+    try {
+        table = loadParameterTable(tableFile);
+    }
+    catch (const Error& e) {
+        LOG_ERROR(e.what());
+        return errorTerminate(INVALID_FILE);
+    }
+    auto fmi = std::make_shared<FmiLibrary>();
+    try {
+        if (!fmi->loadFMU(fmuFile, extractPath)) {
+            LOG_ERROR(fmt::format("error loading fmu: error code={}", fmi->getErrorCode()));
+            return errorTerminate(INVALID_FMU);
+        }
+        sweep = std::make_unique<ParameterSweep>(std::move(fmi), std::move(table));
+    }
+    catch (const Error& e) {
+        LOG_ERROR(e.what());
+        return errorTerminate(INCORRECT_FMU);
+    }
+    catch (const std::exception& e) {
+        LOG_ERROR(fmt::format("error creating sweep instance: {}", e.what()));
+        return errorTerminate(FMU_ERROR);
+    }
+    sweep->setFlag("local_outputs", localOutputs != "none");
+    sweep->setFlag("default_local_outputs", localOutputs == "all");
+    for (const auto& flag : flags) {
+        if (!setFederateFlag(*sweep, flag)) {
+            LOG_WARNING(fmt::format("flag {} was not recognized ", flag));
+        }
+    }
+    if (!output_variables.empty()) {
+        sweep->setOutputs(output_variables);
+    }
+    sweep->setThreadCount(sweepThreads);
+    LOG_SUMMARY(fmt::format("loaded {} sweep cases from {}", sweep->size(), tableFile));
+    currentState = State::LOADED;
+    return EXIT_SUCCESS;
+}
+
+int FmiRunner::runSweep(helics::Time stop)
+{
+    const double duration = (stop > helics::timeZero) ? static_cast<double>(stop) : 0.0;
+    try {
+        const auto failures = sweep->run(duration, sweepOutput);
+        LOG_SUMMARY(fmt::format("ran {} sweep cases into {}", sweep->size(), sweepOutput));
+        if (failures > 0) {
+            LOG_WARNING(fmt::format("{} of {} sweep cases failed", failures, sweep->size()));
+        }
+    }
+    catch (const std::exception& e) {
+        LOG_ERROR(fmt::format("error running sweep: {}", e.what()));
+        return errorTerminate(FMU_ERROR);
+    }
+    currentState = State::RUNNING;
+    return EXIT_SUCCESS;
+}
+
+int FmiRunner::loadDirect(const std::string& fmuFile)
+{
+    if (inputs.size() > 1 || getFileType(fmuFile) != FileType::fmu) {
+        LOG_ERROR("direct execution requires a single FMU");
+        return errorTerminate(INVALID_FILE);
+    }
+    if (!connections.empty()) {
+        LOG_ERROR("connections cannot be made in direct execution");
+        return errorTerminate(INVALID_FILE);
+    }
+    // the same defaults as a federate so a run gives the same results in either mode
+    if (stepTime <= helics::timeZero) {
+        stepTime = fedInfo.checkTimeProperty(HELICS_PROPERTY_TIME_PERIOD, 0.001);
+    }
+    if (stopTime <= helics::timeZero) {
+        stopTime = fedInfo.checkTimeProperty(HELICS_PROPERTY_TIME_STOPTIME, 30.0);
+    }
+    FmiLibrary fmi;
+    try {
+        if (!fmi.loadFMU(fmuFile, extractPath)) {
+            LOG_ERROR(fmt::format("error loading fmu: error code={}", fmi.getErrorCode()));
+            return errorTerminate(INVALID_FMU);
+        }
+        if (!cosimFmu || !fmi.checkFlag(fmuCapabilityFlags::coSimulationCapable)) {
+            LOG_ERROR("direct execution requires a co-simulation FMU");
+            return errorTerminate(INCORRECT_FMU);
         }
-        if (!used) {
+        std::shared_ptr<fmi2CoSimObject> obj = fmi.createCoSimulationObject("obj1");
+        if (!obj) {
+            LOG_ERROR("unable to create cosim object ");
+            return errorTerminate(FMU_ERROR);
+        }
+        setLocalOutputs(*obj, localOutputs);
+        directFmu = std::make_unique<StandaloneCoSim>(std::move(obj));
+    }
+    catch (const std::exception& e) {
+        LOG_ERROR(fmt::format("error creating fmu: {}", e.what()));
+        return errorTerminate(FMU_ERROR);
+    }
+    for (const auto& flag : flags) {
+        if (!setFederateFlag(*directFmu, flag)) {
             LOG_WARNING(fmt::format("flag {} was not recognized ", flag));
         }
     }
+    if (!output_variables.empty()) {
+        directFmu->setOutputs(output_variables);
+    }
+    if (!replayFile.empty()) {
+        try {
+            replayInputs = std::make_unique<InputRecording>(loadInputRecording(replayFile));
+        }
+        catch (const Error& e) {
+            LOG_ERROR(e.what());
+            return errorTerminate(INVALID_FILE);
+        }
+    }
+    currentState = State::LOADED;
+    return EXIT_SUCCESS;
+}
 
+int FmiRunner::runDirect(helics::Time stop)
+{
+    std::unique_ptr<utilities::ColumnCapture> capture;
+    if (!captureFile.empty()) {
+        try {
+            capture = std::make_unique<utilities::ColumnCapture>(
+                captureFile,
+                directFmu->getOutputNames(),
+                utilities::getCaptureFormat(captureFile));
+        }
+        catch (const std::runtime_error& e) {
+            LOG_WARNING(e.what());
+        }
+    }
+    try {
+        // a replay takes the recorded steps so it ignores the stop time
+        const double reached = replayInputs ?
+            directFmu->replay(*replayInputs, capture.get()) :
+            directFmu->run(static_cast<double>(stop), capture.get());
+        LOG_SUMMARY(
+            fmt::format("stepped the FMU {} times to {}", directFmu->getStepCount(), reached));
+    }
+    catch (const std::exception& e) {
+        LOG_ERROR(fmt::format("error stepping fmu: {}", e.what()));
+        return errorTerminate(FMU_ERROR);
+    }
+    if (capture) {
+        try {
+            capture->close();
+            LOG_SUMMARY(fmt::format("captured {} rows of {} outputs to {}",
+                                    capture->rowCount(),
+                                    capture->columnCount(),
+                                    captureFile));
+        }
+        catch (const std::runtime_error& e) {
+            LOG_ERROR(fmt::format("error writing {}: {}", captureFile, e.what()));
+        }
+    }
+    currentState = State::RUNNING;
     return EXIT_SUCCESS;
 }
 
@@ -350,13 +786,19 @@ int FmiRunner::run(helics::Time stop)
     if (stop < helics::timeZero) {
         stop = stopTime;
     }
+    if (sweep) {
+        return runSweep(stop);
+    }
+    if (directFmu) {
+        return runDirect(stop);
+    }
     if (stop < stepTime) {
         LOG_WARNING(fmt::format("stoptime ({}) < steptime ({}), please check values ",
                                 static_cast<double>(stop),
                                 static_cast<double>(stepTime)));
     }
     // load each of the fmu's into its own thread
-    std::vector<std::thread> threads(cosimFeds.size() + meFeds.size());
+    std::vector<std::thread> threads(cosimFeds.size() + meFeds.size() + ensembleFeds.size());
     for (size_t ii = 0; ii < cosimFeds.size(); ++ii) {
         auto* tfed = cosimFeds[ii].get();
         threads[ii] = std::thread([tfed, stop]() { tfed->run(stop); });
@@ -365,9 +807,28 @@ int FmiRunner::run(helics::Time stop)
         auto* tfed = meFeds[jj].get();
         threads[jj + cosimFeds.size()] = std::thread([tfed, stop]() { tfed->run(stop); });
     }
+    for (size_t kk = 0; kk < ensembleFeds.size(); ++kk) {
+        auto* tfed = ensembleFeds[kk].get();
+        threads[kk + cosimFeds.size() + meFeds.size()] =
+            std::thread([tfed, stop]() { tfed->run(stop); });
+    }
+    if (systemFed) {
+        auto* tfed = systemFed.get();
+        threads.emplace_back([tfed, stop]() { tfed->run(stop); });
+    }
     for (auto& thread : threads) {
         thread.join();
     }
+    if (checkpoints) {
+        LOG_SUMMARY(fmt::format("wrote {} checkpoints to {}, the last at {}",
+                                checkpoints->getCount(),
+                                checkpointFile,
+                                checkpoints->getLastTime()));
+        if (checkpoints->getDiscardedCount() > 0) {
+            LOG_WARNING(fmt::format("discarded {} incomplete checkpoints",
+                                    checkpoints->getDiscardedCount()));
+        }
+    }
     if (core) {
         core->forceTerminate();
     }
@@ -391,9 +852,47 @@ int FmiRunner::initialize()
     if (currentState >= State::INITIALIZED) {
         return EXIT_SUCCESS;
     }
+    if (sweep) {
+        for (const auto& param : setParameters) {
+            auto eloc = param.find_first_of('=');
+            sweep->set(param.substr(0, eloc), param.substr(eloc + 1));
+        }
+        try {
+            sweep->configure(stepTime);
+        }
+        catch (const Error& e) {
+            LOG_ERROR(e.what());
+            return errorTerminate(INVALID_FILE);
+        }
+        currentState = State::INITIALIZED;
+        return EXIT_SUCCESS;
+    }
+    if (directFmu) {
+        for (const auto& param : setParameters) {
+            auto eloc = param.find_first_of('=');
+            try {
+                directFmu->set(param.substr(0, eloc), param.substr(eloc + 1));
+            }
+            catch (const fmiDiscardException&) {
+                return DISCARDED_PARAMETER_ERROR;
+            }
+        }
+        try {
+            directFmu->configure(static_cast<double>(stepTime));
+        }
+        catch (const Error& e) {
+            LOG_ERROR(e.what());
+            return errorTerminate(INVALID_FILE);
+        }
+        currentState = State::INITIALIZED;
+        return EXIT_SUCCESS;
+    }
     std::vector<int> paramUsed(setParameters.size(), 0);
     for (auto& csFed : cosimFeds) {
-        csFed->configure(stepTime);
+        // the federates from a system file are configured with their own settings when loaded
+        if (!csFed->isConfigured()) {
+            csFed->configure(stepTime);
+        }
         int index = 0;
         for (const auto& param : setParameters) {
             auto eloc = param.find_first_of('=');
@@ -408,7 +907,9 @@ int FmiRunner::initialize()
         }
     }
     for (auto& meFed : meFeds) {
-        meFed->configure(stepTime);
+        if (!meFed->isConfigured()) {
+            meFed->configure(stepTime);
+        }
         for (const auto& param : setParameters) {
             auto eloc = param.find_first_of('=');
             int index = 0;
@@ -422,12 +923,47 @@ int FmiRunner::initialize()
             ++index;
         }
     }
+    if (systemFed) {
+        int index = 0;
+        for (const auto& param : setParameters) {
+            auto eloc = param.find_first_of('=');
+            try {
+                systemFed->set(param.substr(0, eloc), param.substr(eloc + 1));
+                paramUsed[index] = 1;
+            }
+            catch (const fmiDiscardException&) {
+                return DISCARDED_PARAMETER_ERROR;
+            }
+            ++index;
+        }
+    }
+    // ensembles are configured when loaded so only the parameters are set here
+    for (auto& ensemble : ensembleFeds) {
+        int index = 0;
+        for (const auto& param : setParameters) {
+            auto eloc = param.find_first_of('=');
+            try {
+                ensemble->set(param.substr(0, eloc), param.substr(eloc + 1));
+                paramUsed[index] = 1;
+            }
+            catch (const fmiDiscardException&) {
+                return DISCARDED_PARAMETER_ERROR;
+            }
+            ++index;
+        }
+    }
 
     for (std::size_t ii = 0; ii < paramUsed.size(); ++ii) {
         if (paramUsed[ii] == 0) {
             LOG_WARNING(fmt::format("parameter ({}) is unused ", setParameters[ii]));
         }
     }
+    if (!checkpointFile.empty() || !restartFile.empty()) {
+        const int checkpointResult = loadCheckpoints();
+        if (checkpointResult != EXIT_SUCCESS) {
+            return checkpointResult;
+        }
+    }
     const int result = makeConnections();
     if (result != EXIT_SUCCESS) {
         return result;
@@ -436,10 +972,79 @@ int FmiRunner::initialize()
     return EXIT_SUCCESS;
 }
 
+int FmiRunner::loadCheckpoints()
+{
+    if (!meFeds.empty() || !ensembleFeds.empty() || systemFed) {
+        LOG_ERROR("checkpoints are only supported for runs of separate co-simulation federates");
+        return errorTerminate(INCORRECT_FMU);
+    }
+    for (auto& csFed : cosimFeds) {
+        if (!csFed->canCheckpoint()) {
+            LOG_ERROR(fmt::format("the FMU of {} cannot serialize its state", (*csFed)->getName()));
+            return errorTerminate(INCORRECT_FMU);
+        }
+    }
+    if (!restartFile.empty()) {
+        std::vector<FederateCheckpoint> points;
+        try {
+            points = loadCheckpoint(restartFile);
+        }
+        catch (const Error& e) {
+            LOG_ERROR(e.what());
+            return errorTerminate(INVALID_FILE);
+        }
+        if (points.size() != cosimFeds.size()) {
+            LOG_ERROR(fmt::format("the checkpoint has {} federates but the run has {}",
+                                  points.size(),
+                                  cosimFeds.size()));
+            return errorTerminate(INVALID_FILE);
+        }
+        for (auto& csFed : cosimFeds) {
+            const auto& name = (*csFed)->getName();
+            auto point = std::find_if(points.begin(), points.end(), [&name](const auto& record) {
+                return record.name == name;
+            });
+            if (point == points.end()) {
+                LOG_ERROR(fmt::format("{} is not in the checkpoint", name));
+                return errorTerminate(INVALID_FILE);
+            }
+            csFed->restoreCheckpoint(std::move(*point));
+        }
+        LOG_SUMMARY(fmt::format("restarting from {} at {}", restartFile, points.front().time));
+    }
+    if (!checkpointFile.empty()) {
+        try {
+            checkpoints = std::make_shared<CheckpointWriter>(
+                checkpointFile, static_cast<double>(checkpointInterval), cosimFeds.size());
+        }
+        catch (const Error& e) {
+            LOG_ERROR(e.what());
+            return errorTerminate(INVALID_FILE);
+        }
+        for (auto& csFed : cosimFeds) {
+            if (!csFed->reachesCheckpoints(checkpoints->getInterval())) {
+                LOG_ERROR(fmt::format("{} does not take fixed steps that divide the checkpoint "
+                                      "interval and start time",
+                                      (*csFed)->getName()));
+                checkpoints.reset();
+                return errorTerminate(INCORRECT_FMU);
+            }
+            csFed->setCheckpoint(checkpoints);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
 int FmiRunner::close()
 {
     cosimFeds.clear();
     meFeds.clear();
+    ensembleFeds.clear();
+    systemFed.reset();
+    sweep.reset();
+    directFmu.reset();
+    replayInputs.reset();
+    checkpoints.reset();
     if (broker) {
         broker->waitForDisconnect();
     }
@@ -571,6 +1176,55 @@ void FmiRunner::runnerLog(int loggingLevel, std::string_view message)
     }
 }
 
+static double
+    getAttributeValue(readerElement& elem, const std::string& attribute, double defaultValue)
+{
+    if (elem.hasAttribute(attribute)) {
+        const double val = elem.getAttributeValue(attribute);
+        if (val != readerNullVal) {
+            return val;
+        }
+    }
+    return defaultValue;
+}
+
+/** load the parameters of an fmu element into a federate*/
+template<class FedType>
+static void loadParameters(readerElement& elem, FedType& fed)
+{
+    elem.moveToFirstChild("parameters");
+    while (elem.isValid()) {
+        auto attr = elem.getFirstAttribute();
+        if (attr.getName() == "field") {
+            const std::string& str1 = attr.getText();
+            if (!str1.empty()) {
+                const double val = elem.getAttributeValue("value");
+                if (val != readerNullVal) {
+                    fed.set(str1, val);
+                } else {
+                    fed.set(str1, elem.getAttributeText("value"));
+                }
+            }
+        } else {
+            while (attr.isValid()) {
+                const std::string& str1 = attr.getName();
+                if (!str1.empty()) {
+                    const double val = attr.getValue();
+                    if (val != readerNullVal) {
+                        fed.set(str1, val);
+                    } else {
+                        fed.set(str1, attr.getText());
+                    }
+                }
+                attr = elem.getNextAttribute();
+            }
+        }
+
+        elem.moveToNextSibling("parameters");
+    }
+    elem.moveToParent();
+}
+
 int FmiRunner::loadFile(readerElement& elem)
 {
     if (stopTime == helics::Time::minVal() && elem.hasAttribute("stop")) {
@@ -599,6 +1253,22 @@ int FmiRunner::loadFile(readerElement& elem)
     if (elem.hasAttribute("extractpath")) {
         extractPath = elem.getAttributeText("extractpath");
     }
+    if (elem.hasAttribute("coupling")) {
+        coupling = elem.getAttributeText("coupling");
+    }
+    if (coupling != "none") {
+        try {
+            systemFed = std::make_unique<SystemFederate>(
+                fedInfo.defName.empty() ? std::string("system") : fedInfo.defName, fedInfo);
+            systemFed->setCoupling(getCouplingMethod(coupling));
+            // the FMUs are given the global flags as they are added
+            applyFlags(*systemFed);
+        }
+        catch (const Error& e) {
+            LOG_ERROR(e.what());
+            return errorTerminate(INVALID_FILE);
+        }
+    }
     elem.moveToFirstChild("fmus");
 
     std::vector<std::unique_ptr<FmiLibrary>> fmis;
@@ -610,6 +1280,14 @@ int FmiRunner::loadFile(readerElement& elem)
             return errorTerminate(MISSING_FILE);
         }
         fmilib->loadFMU(str, extractPath);
+        if (elem.hasAttribute("instances")) {
+            const int result = loadEnsemble(elem, std::move(fmilib));
+            if (result != EXIT_SUCCESS) {
+                return result;
+            }
+            elem.moveToNextSibling("fmus");
+            continue;
+        }
         if (fmilib->checkFlag(fmuCapabilityFlags::coSimulationCapable)) {
             std::shared_ptr<fmi2CoSimObject> obj =
                 fmilib->createCoSimulationObject(elem.getAttributeText("name"));
@@ -618,7 +1296,30 @@ int FmiRunner::loadFile(readerElement& elem)
                 return errorTerminate(FMU_ERROR);
             }
             auto name = obj->getName();
-
+            setLocalOutputs(*obj,
+                            elem.hasAttribute("locals") ? elem.getAttributeText("locals") :
+                                                          localOutputs);
+            if (systemFed) {
+                if (elem.hasAttribute("config")) {
+                    LOG_WARNING(fmt::format(
+                        "config attribute of {} is ignored for an fmu in a coupled system", name));
+                }
+                loadParameters(elem, *obj);
+                applyFlags(*obj);
+                if (elem.hasAttribute("flags")) {
+                    for (const auto& flag : gmlc::utilities::stringOps::splitline(
+                             elem.getAttributeText("flags"), ",")) {
+                        if (!setFederateFlag(*obj, gmlc::utilities::stringOps::trim(flag))) {
+                            LOG_WARNING(
+                                fmt::format("flag {} was not recognized for {}", flag, name));
+                        }
+                    }
+                }
+                systemFed->addFMU(std::move(obj));
+                fmis.push_back(std::move(fmilib));
+                elem.moveToNextSibling("fmus");
+                continue;
+            }
             std::unique_ptr<CoSimFederate> fed;
             if (elem.hasAttribute("config")) {
                 auto cfile = elem.getAttributeText("config");
@@ -627,37 +1328,59 @@ int FmiRunner::loadFile(readerElement& elem)
             } else {
                 fed = std::make_unique<CoSimFederate>(name, std::move(obj), fedInfo);
             }
-            elem.moveToFirstChild("parameters");
-            while (elem.isValid()) {
-                auto attr = elem.getFirstAttribute();
-                if (attr.getName() == "field") {
-                    const std::string& str1 = attr.getText();
-                    if (!str1.empty()) {
-                        const double val = elem.getAttributeValue("value");
-                        if (val != readerNullVal) {
-                            fed->set(str1, val);
-                        } else {
-                            fed->set(str1, elem.getAttributeText("value"));
-                        }
-                    }
-                } else {
-                    while (attr.isValid()) {
-                        const std::string& str1 = attr.getName();
-                        if (!str1.empty()) {
-                            const double val = attr.getValue();
-                            if (val != readerNullVal) {
-                                fed->set(str1, val);
-                            } else {
-                                fed->set(str1, attr.getText());
-                            }
-                        }
-                        attr = elem.getNextAttribute();
+            loadParameters(elem, *fed);
+            // the flags of the element override the global flags
+            applyFlags(*fed);
+            if (elem.hasAttribute("flags")) {
+                for (const auto& flag :
+                     gmlc::utilities::stringOps::splitline(elem.getAttributeText("flags"), ",")) {
+                    if (!setFederateFlag(*fed, gmlc::utilities::stringOps::trim(flag))) {
+                        LOG_WARNING(fmt::format("flag {} was not recognized for {}", flag, name));
                     }
                 }
-
-                elem.moveToNextSibling("parameters");
             }
-            elem.moveToParent();
+            fed->setOutputTolerance(getAttributeValue(elem, "output_abstol", outputAbsTolerance),
+                                    getAttributeValue(elem, "output_reltol", outputRelTolerance));
+            helics::Time localMinStep{minStepTime};
+            if (elem.hasAttribute("minstep")) {
+                localMinStep = loadTimeFromString(elem.getAttributeText("minstep"), time_units::s);
+            }
+            helics::Time localMaxStep{maxStepTime};
+            if (elem.hasAttribute("maxstep")) {
+                localMaxStep = loadTimeFromString(elem.getAttributeText("maxstep"), time_units::s);
+            }
+            fed->setAdaptiveStep(localMinStep,
+                                 localMaxStep,
+                                 getAttributeValue(elem, "step_tolerance", stepTolerance));
+            fed->setIterativeStep(
+                static_cast<int>(getAttributeValue(elem, "max_iterations", maxIterations)),
+                getAttributeValue(elem, "iteration_tolerance", iterationTolerance));
+            fed->setDiscardRetry(
+                static_cast<int>(getAttributeValue(elem, "discard_retries", discardRetries)));
+            fed->setRunAhead(static_cast<std::size_t>(
+                std::max(getAttributeValue(elem, "run_ahead", runAhead), 0.0)));
+            fed->setSpeculationTolerance(
+                getAttributeValue(elem, "speculation_tolerance", speculationTolerance));
+            if (elem.hasAttribute("record_inputs")) {
+                fed->setInputRecord(elem.getAttributeText("record_inputs"));
+            }
+            helics::Time localSubStep{subStepTime};
+            if (elem.hasAttribute("substep")) {
+                localSubStep = loadTimeFromString(elem.getAttributeText("substep"), time_units::s);
+            }
+            try {
+                fed->setInputExtrapolation(getInputExtrapolation(
+                    elem.hasAttribute("extrapolation") ? elem.getAttributeText("extrapolation") :
+                                                         extrapolation));
+                fed->setSubStep(localSubStep,
+                                getOutputAggregation(elem.hasAttribute("aggregation") ?
+                                                         elem.getAttributeText("aggregation") :
+                                                         aggregation));
+            }
+            catch (const Error& e) {
+                LOG_ERROR(e.what());
+                return errorTerminate(INVALID_FILE);
+            }
             helics::Time localStepTime{stepTime};
             if (elem.hasAttribute("steptime")) {
                 localStepTime =
@@ -679,6 +1402,9 @@ int FmiRunner::loadFile(readerElement& elem)
                 return errorTerminate(FMU_ERROR);
             }
             auto name = obj->getName();
+            setLocalOutputs(*obj,
+                            elem.hasAttribute("locals") ? elem.getAttributeText("locals") :
+                                                          localOutputs);
             auto fed = std::make_unique<FmiModelExchangeFederate>(name, std::move(obj), fedInfo);
             elem.moveToFirstChild("parameters");
             while (elem.isValid()) {
@@ -697,6 +1423,7 @@ int FmiRunner::loadFile(readerElement& elem)
                 fed->set(str1, str2);
             }
             elem.moveToParent();
+            applyFlags(*fed);
             fed->configure(1.0);
             meFeds.push_back(std::move(fed));
         }
@@ -704,7 +1431,59 @@ int FmiRunner::loadFile(readerElement& elem)
         elem.moveToNextSibling("fmus");
     }
     elem.moveToParent();
+    if (systemFed) {
+        systemFed->configure(stepTime);
+    }
     return 0;
 }
 
+int FmiRunner::loadEnsemble(readerElement& elem, std::shared_ptr<FmiLibrary> fmilib)
+{
+    const auto name = elem.getAttributeText("name");
+    const double count = elem.getAttributeValue("instances");
+    if (count == readerNullVal || count < 1.0) {
+        LOG_ERROR(fmt::format("invalid instance count for ensemble {}", name));
+        return errorTerminate(INVALID_FILE);
+    }
+    std::unique_ptr<EnsembleFederate> fed;
+    try {
+        fed = std::make_unique<EnsembleFederate>(name,
+                                                 std::move(fmilib),
+                                                 static_cast<std::size_t>(count),
+                                                 fedInfo);
+    }
+    catch (const Error& e) {
+        LOG_ERROR(e.what());
+        return errorTerminate(INCORRECT_FMU);
+    }
+    for (std::size_t ii = 0; ii < fed->size(); ++ii) {
+        setLocalOutputs(fed->getInstance(ii),
+                        elem.hasAttribute("locals") ? elem.getAttributeText("locals") :
+                                                      localOutputs);
+    }
+    fed->setThreadCount(static_cast<unsigned int>(getAttributeValue(elem, "threads", 0.0)));
+    loadParameters(elem, *fed);
+    applyFlags(*fed);
+    if (elem.hasAttribute("flags")) {
+        for (const auto& flag :
+             gmlc::utilities::stringOps::splitline(elem.getAttributeText("flags"), ",")) {
+            if (!setFederateFlag(*fed, gmlc::utilities::stringOps::trim(flag))) {
+                LOG_WARNING(fmt::format("flag {} was not recognized for {}", flag, name));
+            }
+        }
+    }
+    helics::Time localStepTime{stepTime};
+    if (elem.hasAttribute("steptime")) {
+        localStepTime = loadTimeFromString(elem.getAttributeText("steptime"), time_units::s);
+    }
+    if (elem.hasAttribute("starttime")) {
+        fed->configure(localStepTime,
+                       loadTimeFromString(elem.getAttributeText("starttime"), time_units::s));
+    } else {
+        fed->configure(localStepTime);
+    }
+    ensembleFeds.push_back(std::move(fed));
+    return EXIT_SUCCESS;
+}
+
 }  // namespace helicsfmi
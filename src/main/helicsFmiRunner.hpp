@@ -28,11 +28,18 @@ class Core;
 }  // namespace helics
 
 class readerElement;
+class FmiLibrary;
 
 namespace helicsfmi {
 
 class CoSimFederate;
+class EnsembleFederate;
+class SystemFederate;
 class FmiModelExchangeFederate;
+class ParameterSweep;
+class CheckpointWriter;
+struct InputRecording;
+class StandaloneCoSim;
 
 /// @brief  main runner class for helics-fmi
 class FmiRunner {
@@ -42,21 +49,62 @@ class FmiRunner {
     std::string brokerArgs;
     helics::Time stepTime{1.0};
     helics::Time stopTime{helics::Time::minVal()};
+    helics::Time minStepTime{helics::timeZero};
+    helics::Time maxStepTime{helics::timeZero};
+    double stepTolerance{1e-3};
+    helics::Time subStepTime{helics::timeZero};
+    /// the value published over sub-steps (last, average, min, max)
+    std::string aggregation{"last"};
+    int maxIterations{0};
+    double iterationTolerance{1e-6};
+    int discardRetries{0};  //!< the number of smaller steps tried after a discarded step
+    double speculationTolerance{1e-6};  //!< the input change that rolls back a speculative step
+    int runAhead{0};  //!< the steps an FMU without inputs is computed ahead of the grants
+    /// the default method for estimating inputs between updates (hold, linear, quadratic)
+    std::string extrapolation{"hold"};
+    double pacing{0.0};  //!< wall clock seconds per simulated second, 0 runs as fast as possible
+    int pacingProcessor{-1};  //!< the first processor to pin the paced stepping threads to
+    bool pacingLockMemory{false};  //!< lock the process memory for paced runs
+    double outputAbsTolerance{0.0};
+    double outputRelTolerance{0.0};
+    /// which local variables can be published (none, listed, all)
+    std::string localOutputs{"listed"};
     std::vector<std::string> inputs;
     std::vector<std::string> output_variables;
     std::vector<std::string> input_variables;
     std::vector<std::string> connections;
+    std::vector<std::string> outputGroups;  //!< vector publication groups (name=variables)
+    std::vector<std::string> inputGroups;  //!< vector input groups (name=variables)
     //!< paths to find the fmu or other files
     std::vector<std::string> paths;
     std::string extractPath;
+    std::string captureFile;  //!< file to capture the numeric outputs to
+    std::string recordFile;  //!< file recording the inputs applied to co-simulation FMUs
+    std::string replayFile;  //!< input recording replayed on a single FMU without HELICS
+    std::string sweepFile;  //!< parameter table for a standalone sweep of a single FMU
+    std::string sweepOutput{"sweep.csv"};  //!< file collecting the results of every sweep case
+    unsigned int sweepThreads{0};  //!< worker threads for a sweep, 0 for the hardware concurrency
+    /// the coupling method for FMUs in a single system federate (none, jacobi, gauss_seidel)
+    std::string coupling{"none"};
     bool cosimFmu{true};
+    bool directRun{false};  //!< step a single co-simulation FMU without any HELICS objects
+    std::string checkpointFile;  //!< file receiving the periodic checkpoints of the run
+    helics::Time checkpointInterval{helics::timeZero};  //!< simulated time between checkpoints
+    std::string restartFile;  //!< checkpoint to resume the run from
     helics::FederateInfo fedInfo;
     std::unique_ptr<helics::BrokerApp> broker;
     std::unique_ptr<helics::CoreApp> core;
     std::vector<std::unique_ptr<CoSimFederate>> cosimFeds;
     std::vector<std::unique_ptr<FmiModelExchangeFederate>> meFeds;
+    std::vector<std::unique_ptr<EnsembleFederate>> ensembleFeds;
+    std::unique_ptr<SystemFederate> systemFed;  //!< the FMUs coupled within the runner
+    std::unique_ptr<ParameterSweep> sweep;  //!< runs an FMU for each case without HELICS
+    std::unique_ptr<StandaloneCoSim> directFmu;  //!< the FMU stepped directly in direct mode
+    std::unique_ptr<InputRecording> replayInputs;  //!< the recording replayed on the direct FMU
+    std::shared_ptr<CheckpointWriter> checkpoints;  //!< collects the checkpoints of the federates
     std::vector<std::string> setParameters;
     std::vector<std::string> flags;
+    std::vector<bool> flagsUsed;  //!< the global flags recognized by at least one federate
     enum class State { CREATED, LOADED, INITIALIZED, RUNNING, CLOSED, ERROR };
     State currentState{State::CREATED};
     int returnCode{EXIT_SUCCESS};
@@ -92,6 +140,18 @@ class FmiRunner {
   private:
     void runnerLog(int loggingLevel, std::string_view message);
     int loadFile(readerElement& elem);
+    /// @brief load an fmu element with an instance count as an ensemble federate
+    int loadEnsemble(readerElement& elem, std::shared_ptr<FmiLibrary> fmilib);
+    /// @brief load an fmu and parameter table for a sweep without a broker, core, or federate
+    int loadSweep(const std::string& fmuFile);
+    /// @brief run every case of a parameter sweep
+    int runSweep(helics::Time stop);
+    /// @brief load a single co-simulation fmu to be stepped without a broker, core, or federate
+    int loadDirect(const std::string& fmuFile);
+    /// @brief step the directly executed fmu to the stop time
+    int runDirect(helics::Time stop);
+    /// @brief set up the periodic checkpoints and restore the federates from a checkpoint
+    int loadCheckpoints();
     int errorTerminate(int errorCode);
     /// @brief  find the full path for a file name
     /// @param file the filename
@@ -100,6 +160,9 @@ class FmiRunner {
 
     int startBroker();
     int loadSystemFile(readerElement& system, const std::string& inputFile);
+    /// @brief apply the global flags to a federate before it is configured
+    template<class FedType>
+    void applyFlags(FedType& fed);
 
     /// @brief  make any specified connections
     /// @return EXIT_SUCCESS if no errors, other if something went wrong
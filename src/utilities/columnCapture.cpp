@@ -0,0 +1,359 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "columnCapture.h"
+
+#include "zlib.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+namespace utilities {
+
+static constexpr char captureMagic[8] = {'H', 'F', 'M', 'I', 'C', 'A', 'P', '1'};
+static constexpr std::uint32_t compressedFlag{1U};
+
+CaptureFormat getCaptureFormat(const std::string& fileName)
+{
+    auto ext = std::filesystem::path(fileName).extension().string();
+    if (ext == ".hcap") {
+        return CaptureFormat::binary;
+    }
+    if (ext == ".hcapz") {
+        return CaptureFormat::compressed;
+    }
+    return CaptureFormat::csv;
+}
+
+ColumnCapture::ColumnCapture(const std::string& fileName,
+                             std::vector<std::string> columnNames,
+                             CaptureFormat captureFormat,
+                             std::size_t rowsPerBlock):
+    names(std::move(columnNames)), format(captureFormat), blockRows(rowsPerBlock)
+{
+    if (blockRows == 0) {
+        blockRows = 1;
+    }
+    file.open(fileName,
+              (format == CaptureFormat::csv) ? std::ios::out : std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        throw(std::runtime_error("unable to open capture file " + fileName));
+    }
+    writeHeader();
+    if (!file) {
+        throw(std::runtime_error("unable to write capture file " + fileName));
+    }
+    // two blocks are enough unless the writer falls behind
+    freeBlocks.push_back(getFreeBlock());
+    active = getFreeBlock();
+    writer = std::thread([this]() { writerLoop(); });
+}
+
+ColumnCapture::~ColumnCapture()
+{
+    try {
+        close();
+    }
+    catch (const std::runtime_error&) {
+        // a destructor cannot report the failure, call close to check for it
+    }
+}
+
+std::unique_ptr<ColumnCapture::Block> ColumnCapture::getFreeBlock()
+{
+    {
+        std::lock_guard<std::mutex> lock(blockLock);
+        if (!freeBlocks.empty()) {
+            auto block = std::move(freeBlocks.back());
+            freeBlocks.pop_back();
+            return block;
+        }
+    }
+    auto block = std::make_unique<Block>();
+    block->time.resize(blockRows);
+    block->data.resize(blockRows * names.size());
+    return block;
+}
+
+void ColumnCapture::addRow(double time, const double* values)
+{
+    if (!active) {
+        active = getFreeBlock();
+    }
+    const std::size_t row = active->rows;
+    active->time[row] = time;
+    double* column = active->data.data() + row;
+    for (std::size_t ii = 0; ii < names.size(); ++ii) {
+        *column = values[ii];
+        column += blockRows;
+    }
+    ++rows;
+    if (++active->rows == blockRows) {
+        {
+            std::lock_guard<std::mutex> lock(blockLock);
+            fullBlocks.push_back(std::move(active));
+        }
+        blockReady.notify_one();
+    }
+}
+
+void ColumnCapture::close()
+{
+    if (!writer.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(blockLock);
+        if (active && active->rows > 0) {
+            fullBlocks.push_back(std::move(active));
+        }
+        halt = true;
+    }
+    blockReady.notify_one();
+    writer.join();
+    file.close();
+    if (writeError.empty() && file.fail()) {
+        writeError = "unable to write the capture file";
+    }
+    if (!writeError.empty()) {
+        throw(std::runtime_error(writeError));
+    }
+}
+
+void ColumnCapture::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(blockLock);
+    while (true) {
+        blockReady.wait(lock, [this]() { return halt || !fullBlocks.empty(); });
+        if (fullBlocks.empty()) {
+            break;
+        }
+        auto block = std::move(fullBlocks.front());
+        fullBlocks.pop_front();
+        lock.unlock();
+        // once a block fails the file is incomplete so the remaining blocks are dropped
+        auto error = writeError.empty() ? writeBlock(*block) : std::string{};
+        block->rows = 0;
+        lock.lock();
+        if (!error.empty()) {
+            writeError = std::move(error);
+        }
+        freeBlocks.push_back(std::move(block));
+    }
+    file.flush();
+}
+
+void ColumnCapture::writeHeader()
+{
+    if (format == CaptureFormat::csv) {
+        std::string header{"time"};
+        for (const auto& name : names) {
+            header.push_back(',');
+            header.append(name);
+        }
+        header.push_back('\n');
+        file.write(header.data(), static_cast<std::streamsize>(header.size()));
+        return;
+    }
+    const std::uint32_t flags = (format == CaptureFormat::compressed) ? compressedFlag : 0U;
+    const auto count = static_cast<std::uint32_t>(names.size());
+    file.write(captureMagic, sizeof(captureMagic));
+    file.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const auto& name : names) {
+        const auto length = static_cast<std::uint32_t>(name.size());
+        file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        file.write(name.data(), length);
+    }
+}
+
+std::string ColumnCapture::writeBlock(const Block& block)
+{
+    const std::size_t columns = names.size();
+    if (format == CaptureFormat::csv) {
+        buffer.clear();
+        char value[32];
+        auto append = [this, &value](double val) {
+            const int len = std::snprintf(value, sizeof(value), "%.15g", val);
+            buffer.insert(buffer.end(), value, value + len);
+        };
+        for (std::size_t row = 0; row < block.rows; ++row) {
+            append(block.time[row]);
+            for (std::size_t col = 0; col < columns; ++col) {
+                buffer.push_back(',');
+                append(block.data[col * blockRows + row]);
+            }
+            buffer.push_back('\n');
+        }
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        return file ? std::string{} : std::string{"unable to write the capture file"};
+    }
+    const auto rowCount = static_cast<std::uint32_t>(block.rows);
+    const std::size_t columnBytes = block.rows * sizeof(double);
+    std::uint64_t payloadBytes = columnBytes * (columns + 1);
+    if (format == CaptureFormat::binary) {
+        file.write(reinterpret_cast<const char*>(&rowCount), sizeof(rowCount));
+        file.write(reinterpret_cast<const char*>(&payloadBytes), sizeof(payloadBytes));
+        file.write(reinterpret_cast<const char*>(block.time.data()),
+                   static_cast<std::streamsize>(columnBytes));
+        for (std::size_t col = 0; col < columns; ++col) {
+            file.write(reinterpret_cast<const char*>(block.data.data() + col * blockRows),
+                       static_cast<std::streamsize>(columnBytes));
+        }
+        return file ? std::string{} : std::string{"unable to write the capture file"};
+    }
+    // the columns of a partial block are not contiguous so they are packed before compression
+    buffer.resize(payloadBytes);
+    std::memcpy(buffer.data(), block.time.data(), columnBytes);
+    for (std::size_t col = 0; col < columns; ++col) {
+        std::memcpy(buffer.data() + (col + 1) * columnBytes,
+                    block.data.data() + col * blockRows,
+                    columnBytes);
+    }
+    uLongf compressedBytes = compressBound(static_cast<uLong>(payloadBytes));
+    compressBuffer.resize(compressedBytes);
+    const int result = compress2(compressBuffer.data(),
+                                 &compressedBytes,
+                                 reinterpret_cast<const Bytef*>(buffer.data()),
+                                 static_cast<uLong>(payloadBytes),
+                                 Z_BEST_SPEED);
+    if (result != Z_OK) {
+        return "unable to compress a capture block, zlib error " + std::to_string(result);
+    }
+    payloadBytes = compressedBytes;
+    file.write(reinterpret_cast<const char*>(&rowCount), sizeof(rowCount));
+    file.write(reinterpret_cast<const char*>(&payloadBytes), sizeof(payloadBytes));
+    file.write(reinterpret_cast<const char*>(compressBuffer.data()),
+               static_cast<std::streamsize>(compressedBytes));
+    return file ? std::string{} : std::string{"unable to write the capture file"};
+}
+
+ColumnCaptureReader::ColumnCaptureReader(const std::string& fileName)
+{
+    std::ifstream input(fileName, std::ios::in | std::ios::binary);
+    if (!input.is_open()) {
+        throw(std::runtime_error("unable to open capture file " + fileName));
+    }
+    char magic[sizeof(captureMagic)] = {};
+    input.read(magic, sizeof(magic));
+    if (input.gcount() == sizeof(magic) &&
+        std::memcmp(magic, captureMagic, sizeof(captureMagic)) == 0) {
+        loadBinary(input);
+    } else {
+        input.clear();
+        input.seekg(0);
+        loadCsv(input);
+    }
+}
+
+template<class T>
+static T readValue(std::ifstream& input)
+{
+    T value{};
+    input.read(reinterpret_cast<char*>(&value), sizeof(T));
+    if (!input) {
+        throw(std::runtime_error("capture file is truncated"));
+    }
+    return value;
+}
+
+void ColumnCaptureReader::loadBinary(std::ifstream& input)
+{
+    const auto flags = readValue<std::uint32_t>(input);
+    const auto count = readValue<std::uint32_t>(input);
+    names.emplace_back("time");
+    for (std::uint32_t ii = 0; ii < count; ++ii) {
+        const auto length = readValue<std::uint32_t>(input);
+        std::string name(length, '\0');
+        input.read(name.data(), length);
+        names.push_back(std::move(name));
+    }
+    columns.resize(names.size());
+    std::vector<unsigned char> payload;
+    std::vector<double> values;
+    while (input.peek() != std::ifstream::traits_type::eof()) {
+        const auto rowCount = readValue<std::uint32_t>(input);
+        const auto payloadBytes = readValue<std::uint64_t>(input);
+        payload.resize(payloadBytes);
+        input.read(reinterpret_cast<char*>(payload.data()),
+                   static_cast<std::streamsize>(payloadBytes));
+        if (!input) {
+            throw(std::runtime_error("capture file is truncated"));
+        }
+        values.resize(static_cast<std::size_t>(rowCount) * columns.size());
+        const std::size_t valueBytes = values.size() * sizeof(double);
+        if ((flags & compressedFlag) != 0U) {
+            auto outputBytes = static_cast<uLongf>(valueBytes);
+            if (uncompress(reinterpret_cast<Bytef*>(values.data()),
+                           &outputBytes,
+                           payload.data(),
+                           static_cast<uLong>(payloadBytes)) != Z_OK ||
+                outputBytes != valueBytes) {
+                throw(std::runtime_error("invalid compressed block in capture file"));
+            }
+        } else {
+            if (payloadBytes != valueBytes) {
+                throw(std::runtime_error("invalid block in capture file"));
+            }
+            std::memcpy(values.data(), payload.data(), valueBytes);
+        }
+        for (std::size_t col = 0; col < columns.size(); ++col) {
+            const double* start = values.data() + col * rowCount;
+            columns[col].insert(columns[col].end(), start, start + rowCount);
+        }
+    }
+}
+
+void ColumnCaptureReader::loadCsv(std::ifstream& input)
+{
+    std::string line;
+    if (!std::getline(input, line)) {
+        throw(std::runtime_error("capture file is empty"));
+    }
+    std::size_t start{0};
+    while (start <= line.size()) {
+        auto end = line.find(',', start);
+        if (end == std::string::npos) {
+            end = line.size();
+        }
+        names.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+    columns.resize(names.size());
+    while (std::getline(input, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        const char* position = line.c_str();
+        for (auto& column : columns) {
+            char* next{nullptr};
+            column.push_back(std::strtod(position, &next));
+            position = (*next == ',') ? next + 1 : next;
+        }
+    }
+}
+
+void ColumnCaptureReader::writeCsv(std::ostream& output) const
+{
+    for (std::size_t col = 0; col < names.size(); ++col) {
+        output << ((col == 0) ? "" : ",") << names[col];
+    }
+    output << '\n';
+    char value[32];
+    for (std::size_t row = 0; row < rowCount(); ++row) {
+        for (std::size_t col = 0; col < columns.size(); ++col) {
+            std::snprintf(value, sizeof(value), "%.15g", columns[col][row]);
+            output << ((col == 0) ? "" : ",") << value;
+        }
+        output << '\n';
+    }
+}
+
+}  // namespace utilities
@@ -0,0 +1,136 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+/** @file
+@brief classes for capturing time series of values to a file in blocks written by a background
+thread
+
+@details the binary format is a header followed by a sequence of chunks, all values are stored in
+the native byte order
+header: "HFMICAP1" | uint32 flags | uint32 column count | (uint32 length + name) for each column
+chunk: uint32 row count | uint64 payload bytes | payload
+the payload is the time column followed by each value column, as doubles, and is zlib compressed
+if the compression flag is set
+*/
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace utilities {
+/** the file formats for captured data*/
+enum class CaptureFormat {
+    csv,  //!< comma separated text with a header row
+    binary,  //!< chunked binary columns
+    compressed  //!< chunked binary columns compressed with zlib
+};
+
+/** get the capture format matching a file extension (.csv, .hcap, .hcapz)
+@details unrecognized extensions use csv*/
+CaptureFormat getCaptureFormat(const std::string& fileName);
+
+/** capture rows of values into columnar blocks that are written to a file by a background thread
+@details rows are copied into the active block, full blocks are handed to the writer thread and
+replaced from a pool of recycled blocks so the capturing thread never waits on the file*/
+class ColumnCapture {
+  public:
+    /** open a capture file and start the writer thread
+    @param fileName the name of the file to write
+    @param columnNames the names of the value columns, a time column is always added
+    @param format the format of the file
+    @param blockRows the number of rows in each block
+    @throw std::runtime_error if the file cannot be opened
+    */
+    ColumnCapture(const std::string& fileName,
+                  std::vector<std::string> columnNames,
+                  CaptureFormat format = CaptureFormat::csv,
+                  std::size_t blockRows = 1024);
+    ~ColumnCapture();
+    ColumnCapture(const ColumnCapture&) = delete;
+    ColumnCapture& operator=(const ColumnCapture&) = delete;
+
+    /** capture a row of values
+    @param time the time of the row
+    @param values pointer to an array with a value for each column
+    */
+    void addRow(double time, const double* values);
+    /** write any remaining rows and stop the writer thread
+    @throw std::runtime_error if any block could not be compressed or written to the file
+    */
+    void close();
+    /** get the number of value columns*/
+    [[nodiscard]] std::size_t columnCount() const { return names.size(); }
+    /** get the total number of rows captured*/
+    [[nodiscard]] std::uint64_t rowCount() const { return rows; }
+
+  private:
+    /** a block of rows stored by column*/
+    struct Block {
+        std::vector<double> time;
+        std::vector<double> data;  //!< column major storage of the values
+        std::size_t rows{0};
+    };
+    void writerLoop();
+    void writeHeader();
+    /** write a block to the file
+    @return an empty string on success or a description of the failure*/
+    std::string writeBlock(const Block& block);
+    std::unique_ptr<Block> getFreeBlock();
+
+    std::ofstream file;
+    std::vector<std::string> names;
+    CaptureFormat format;
+    std::size_t blockRows;
+    std::uint64_t rows{0};
+    std::unique_ptr<Block> active;  //!< the block being filled
+    std::mutex blockLock;  //!< protects the queues and the halt flag
+    std::condition_variable blockReady;
+    std::deque<std::unique_ptr<Block>> fullBlocks;  //!< blocks waiting to be written
+    std::vector<std::unique_ptr<Block>> freeBlocks;  //!< written blocks available for reuse
+    std::vector<char> buffer;  //!< buffer for formatting the output, only used by the writer
+    std::vector<unsigned char> compressBuffer;  //!< buffer for compressed chunks
+    std::string writeError;  //!< the first write failure, protected by blockLock
+    bool halt{false};
+    std::thread writer;
+};
+
+/** read a capture file written in either the csv or the binary formats*/
+class ColumnCaptureReader {
+  public:
+    /** load a capture file
+    @throw std::runtime_error if the file cannot be read or is not a valid capture file*/
+    explicit ColumnCaptureReader(const std::string& fileName);
+    /** get the column names, the first column is the time*/
+    [[nodiscard]] const std::vector<std::string>& getNames() const { return names; }
+    /** get the values of a column, column 0 is the time*/
+    [[nodiscard]] const std::vector<double>& getColumn(std::size_t index) const
+    {
+        return columns[index];
+    }
+    [[nodiscard]] std::size_t columnCount() const { return columns.size(); }
+    [[nodiscard]] std::size_t rowCount() const
+    {
+        return columns.empty() ? 0 : columns.front().size();
+    }
+    /** write the captured data as csv*/
+    void writeCsv(std::ostream& output) const;
+
+  private:
+    void loadBinary(std::ifstream& input);
+    void loadCsv(std::ifstream& input);
+
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> columns;
+};
+}  // namespace utilities
@@ -0,0 +1,88 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "frameRing.h"
+
+#include <algorithm>
+
+namespace utilities {
+
+FrameRing::FrameRing(std::size_t frameCount, std::size_t frameValues):
+    values(frameValues), data(std::max<std::size_t>(frameCount, 1) * frameValues),
+    times(std::max<std::size_t>(frameCount, 1), 0.0)
+{
+}
+
+double* FrameRing::beginWrite()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [this]() { return closed || filled < times.size(); });
+    if (closed) {
+        return nullptr;
+    }
+    return data.data() + ((readIndex + filled) % times.size()) * values;
+}
+
+void FrameRing::endWrite(double time)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        times[(readIndex + filled) % times.size()] = time;
+        ++filled;
+    }
+    changed.notify_all();
+}
+
+void FrameRing::finish()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        finished = true;
+    }
+    changed.notify_all();
+}
+
+const double* FrameRing::beginRead(double& time)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    if (filled == 0 && !finished) {
+        ++stalls;
+    }
+    changed.wait(guard, [this]() { return closed || finished || filled > 0; });
+    if (closed || filled == 0) {
+        return nullptr;
+    }
+    time = times[readIndex];
+    return data.data() + readIndex * values;
+}
+
+void FrameRing::endRead()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        readIndex = (readIndex + 1) % times.size();
+        --filled;
+    }
+    changed.notify_all();
+}
+
+std::uint64_t FrameRing::readStalls() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stalls;
+}
+
+void FrameRing::close()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closed = true;
+    }
+    changed.notify_all();
+}
+
+}  // namespace utilities
@@ -0,0 +1,66 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+/** @file
+@brief a bounded ring of fixed size frames of values passed from a producer thread to a consumer
+*/
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace utilities {
+/** a bounded ring of frames with a time and a fixed number of values for a single producer and a
+single consumer
+@details the producer fills the frame returned by beginWrite in place and the consumer reads the
+frame returned by beginRead in place, a frame is only reused after endRead so neither side copies
+the values through the lock, the producer waits while the ring is full and the consumer waits while
+it is empty*/
+class FrameRing {
+  public:
+    /** create a ring
+    @param frameCount the number of frames in the ring, at least 1
+    @param frameValues the number of values in each frame*/
+    FrameRing(std::size_t frameCount, std::size_t frameValues);
+    /** get the next frame to fill, waiting while the ring is full
+    @return the values of the frame or nullptr if the ring was closed*/
+    double* beginWrite();
+    /** make the frame from beginWrite available to the consumer*/
+    void endWrite(double time);
+    /** mark that the producer will not add any more frames*/
+    void finish();
+    /** get the next frame to read, waiting while the ring is empty
+    @param[out] time the time of the frame
+    @return the values of the frame or nullptr if the producer finished and every frame was read*/
+    const double* beginRead(double& time);
+    /** release the frame from beginRead to the producer*/
+    void endRead();
+    /** stop the producer and the consumer, waiting threads return nullptr*/
+    void close();
+    /** get the number of values in each frame*/
+    [[nodiscard]] std::size_t frameSize() const { return values; }
+    /** get the number of frames in the ring*/
+    [[nodiscard]] std::size_t capacity() const { return times.size(); }
+    /** get the number of reads that had to wait for the producer*/
+    [[nodiscard]] std::uint64_t readStalls() const;
+
+  private:
+    std::size_t values{0};
+    std::vector<double> data;  //!< the values of every frame
+    std::vector<double> times;  //!< the time of each frame
+    std::size_t readIndex{0};  //!< the frame read next
+    std::size_t filled{0};  //!< the number of frames written and not released
+    std::uint64_t stalls{0};  //!< the reads that found the ring empty
+    mutable std::mutex lock;
+    std::condition_variable changed;  //!< signals a written or released frame
+    bool finished{false};  //!< the producer has no more frames
+    bool closed{false};
+};
+}  // namespace utilities
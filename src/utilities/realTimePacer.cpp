@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "realTimePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef __linux__
+#    include <pthread.h>
+#    include <sched.h>
+#    include <sys/mman.h>
+#endif
+
+namespace utilities {
+
+/// sleeps can overshoot by a scheduler tick so the end of each wait is spent spinning
+static constexpr std::chrono::microseconds spinTime{200};
+
+static double toSeconds(RealTimePacer::clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+void RealTimePacer::start(double simTime)
+{
+    anchor = clock::now();
+    stepStart = anchor;
+    startTime = simTime;
+    lastTime = simTime;
+}
+
+void RealTimePacer::pace(double simTime)
+{
+    const auto now = clock::now();
+    const auto offset = std::chrono::duration<double>((simTime - startTime) * timeScale);
+    const auto deadline = anchor + std::chrono::duration_cast<clock::duration>(offset);
+    const double compute = toSeconds(now - stepStart);
+    const double budget = (simTime - lastTime) * timeScale;
+    lastTime = simTime;
+    ++stats.steps;
+    stats.totalCompute += compute;
+    stats.maxCompute = std::max(stats.maxCompute, compute);
+
+    double lateness{0.0};
+    if (now >= deadline) {
+        ++stats.overruns;
+        ++stats.histogram.back();
+        lateness = toSeconds(now - deadline);
+    } else {
+        const auto bin = (budget > 0.0) ? static_cast<std::size_t>(10.0 * compute / budget) : 0;
+        ++stats.histogram[std::min(bin, PacingStatistics::histogramBins - 2)];
+        if (deadline - now > spinTime) {
+            std::this_thread::sleep_until(deadline - spinTime);
+        }
+        while (clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        lateness = toSeconds(clock::now() - deadline);
+    }
+    stats.totalLateness += lateness;
+    stats.maxLateness = std::max(stats.maxLateness, lateness);
+}
+
+bool RealTimePacer::lockMemory()
+{
+#ifdef __linux__
+    return mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+#else
+    return false;
+#endif
+}
+
+bool RealTimePacer::pinCurrentThread([[maybe_unused]] int processor)
+{
+#ifdef __linux__
+    if (processor < 0 || processor >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(processor, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus) == 0;
+#else
+    return false;
+#endif
+}
+
+}  // namespace utilities
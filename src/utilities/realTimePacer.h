@@ -0,0 +1,70 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+/** @file
+@brief pacing of a simulation loop to the wall clock with timing statistics for each step
+*/
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace utilities {
+/** the timing statistics of the steps of a paced loop*/
+struct PacingStatistics {
+    /// the number of bins of the compute time histogram, the last bin counts overruns
+    static constexpr std::size_t histogramBins{11};
+    std::uint64_t steps{0};  //!< the number of paced steps
+    std::uint64_t overruns{0};  //!< the steps whose computation ended after the deadline
+    double maxLateness{0.0};  //!< the largest delay past a deadline in seconds
+    double totalLateness{0.0};  //!< the sum of the delays past the deadlines in seconds
+    double maxCompute{0.0};  //!< the longest computation of a step in seconds
+    double totalCompute{0.0};  //!< the sum of the step computation times in seconds
+    /// the compute time of the steps as a fraction of the step budget in 10% bins
+    std::array<std::uint64_t, histogramBins> histogram{};
+};
+
+/** align the steps of a simulation loop with the wall clock
+@details the loop calls startStep when it begins computing a step and pace with the simulation time
+the step computes, pace sleeps until the wall clock reaches that time, missed deadlines are not
+carried forward so the loop catches up after an overrun
+*/
+class RealTimePacer {
+  public:
+    using clock = std::chrono::steady_clock;
+    /** create a pacer
+    @param scale the wall clock seconds per simulated second, 1.0 is real time*/
+    explicit RealTimePacer(double scale = 1.0): timeScale(scale) {}
+    /** anchor a simulation time to the current wall clock time*/
+    void start(double simTime);
+    /** mark the start of the computation of a step*/
+    void startStep() { stepStart = clock::now(); }
+    /** record the computation of a step and sleep until the wall clock reaches a simulation time
+    @param simTime the simulation time at the end of the step*/
+    void pace(double simTime);
+    /** get the timing statistics*/
+    [[nodiscard]] const PacingStatistics& getStatistics() const { return stats; }
+    /** get the wall clock seconds per simulated second*/
+    [[nodiscard]] double getScale() const { return timeScale; }
+
+    /** lock the current and future memory of the process into RAM
+    @return false if memory locking failed or is not supported on the platform*/
+    static bool lockMemory();
+    /** pin the calling thread to a processor
+    @return false if the thread could not be pinned or pinning is not supported on the platform*/
+    static bool pinCurrentThread(int processor);
+
+  private:
+    double timeScale{1.0};
+    double startTime{0.0};  //!< the simulation time at the anchor
+    double lastTime{0.0};  //!< the simulation time of the previous deadline
+    clock::time_point anchor;
+    clock::time_point stepStart;
+    PacingStatistics stats;
+};
+}  // namespace utilities
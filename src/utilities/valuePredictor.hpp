@@ -75,4 +75,60 @@ class valuePredictor {
     /** get the rate of change*/
     SlopeType getSlope() const { return slope_; }
 };
+
+/** @brief class implementing a second order prediction
+ *@details the prediction is the quadratic through the last three known points, with only two known
+ *points it falls back to a linear prediction, the slope is the rate of change at the last known
+ *point
+ */
+template<typename InputType, typename OutputType = InputType, typename SlopeType = OutputType>
+class quadraticPredictor: public valuePredictor<InputType, OutputType, SlopeType> {
+  private:
+    using base = valuePredictor<InputType, OutputType, SlopeType>;
+    InputType previousInput_;  //!< the known time before the last known time
+    SlopeType secant_{0};  //!< the rate of change between the last two known points
+    SlopeType curvature_{0};  //!< half the second derivative
+    bool hasSecant_{false};  //!< at least two points are known
+
+  public:
+    /** construct the predictor
+    * @param[in] input0 the initial input
+    @param[in] output0 the initial output
+    @param[in] slope0 [optional] the initial rate of change
+    */
+    quadraticPredictor(InputType input0, OutputType output0, SlopeType slope0 = SlopeType(0)):
+        base(input0, output0, slope0), previousInput_(input0)
+    {
+    }
+    /** update the known values
+     *@details sets the known values and computes the rate of change and curvature
+     *@param[in] input  the actual input value
+     *@param[in] output the actual output value
+     */
+    void update(InputType input, OutputType output) override
+    {
+        const InputType lastInput = base::getKnownInput();
+        if (input - lastInput > InputType{0}) {
+            const SlopeType secant = (output - base::getKnownOutput()) / (input - lastInput);
+            if (hasSecant_) {
+                curvature_ = (secant - secant_) / (input - previousInput_);
+            }
+            secant_ = secant;
+            hasSecant_ = true;
+            previousInput_ = lastInput;
+            base::update(input, output);
+            // the derivative of the quadratic at the newest point
+            base::setSlope(secant + curvature_ * (input - lastInput));
+            return;
+        }
+        base::update(input, output);
+    }
+    OutputType predict(InputType input) const override
+    {
+        const InputType delta = input - base::getKnownInput();
+        return base::getKnownOutput() + delta * base::getSlope() + delta * delta * curvature_;
+    }
+    /** get half the second derivative*/
+    SlopeType getCurvature() const { return curvature_; }
+};
 }  // namespace utilities
@@ -0,0 +1,152 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "workStealingPool.h"
+
+#include <algorithm>
+
+namespace utilities {
+
+WorkStealingPool::WorkStealingPool(unsigned int threadCount)
+{
+    if (threadCount == 0) {
+        const auto hardware = std::thread::hardware_concurrency();
+        threadCount = (hardware > 1) ? hardware - 1 : 0;
+    }
+    for (unsigned int ii = 0; ii <= threadCount; ++ii) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    workers.reserve(threadCount);
+    for (unsigned int ii = 0; ii < threadCount; ++ii) {
+        workers.emplace_back([this, ii]() { workerLoop(ii); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateLock);
+        halt = true;
+    }
+    batchReady.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& task)
+{
+    if (count == 0) {
+        return;
+    }
+    const std::size_t callerQueue = queues.size() - 1;
+    if (workers.empty() || count == 1) {
+        for (std::size_t ii = 0; ii < count; ++ii) {
+            task(ii);
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(stateLock);
+        currentTask = &task;
+        error = nullptr;
+        remaining.store(count);
+        // contiguous ranges keep neighboring tasks on the same thread unless they are stolen
+        const std::size_t queueCount = queues.size();
+        for (std::size_t qq = 0; qq < queueCount; ++qq) {
+            std::lock_guard<std::mutex> queueLock(queues[qq]->lock);
+            for (std::size_t ii = qq * count / queueCount; ii < (qq + 1) * count / queueCount;
+                 ++ii) {
+                queues[qq]->tasks.push_back(ii);
+            }
+        }
+        ++generation;
+    }
+    batchReady.notify_all();
+    runTasks(callerQueue);
+    std::unique_lock<std::mutex> lock(stateLock);
+    batchComplete.wait(lock, [this]() { return remaining.load() == 0; });
+    currentTask = nullptr;
+    if (error) {
+        auto batchError = error;
+        error = nullptr;
+        std::rethrow_exception(batchError);
+    }
+}
+
+void WorkStealingPool::workerLoop(std::size_t queueIndex)
+{
+    std::uint64_t lastGeneration{0};
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stateLock);
+            batchReady.wait(lock, [this, lastGeneration]() {
+                return halt || generation != lastGeneration;
+            });
+            if (halt) {
+                return;
+            }
+            lastGeneration = generation;
+        }
+        runTasks(queueIndex);
+    }
+}
+
+void WorkStealingPool::runTasks(std::size_t queueIndex)
+{
+    std::size_t task{0};
+    while (popLocal(queueIndex, task) || steal(queueIndex, task)) {
+        try {
+            (*currentTask)(task);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(stateLock);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        completeTask();
+    }
+}
+
+bool WorkStealingPool::popLocal(std::size_t queueIndex, std::size_t& task)
+{
+    auto& queue = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.lock);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(std::size_t queueIndex, std::size_t& task)
+{
+    const std::size_t queueCount = queues.size();
+    for (std::size_t offset = 1; offset < queueCount; ++offset) {
+        auto& queue = *queues[(queueIndex + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(queue.lock);
+        if (!queue.tasks.empty()) {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::completeTask()
+{
+    if (remaining.fetch_sub(1) == 1) {
+        // lock so the notification cannot be lost between the check and the wait in parallelFor
+        std::lock_guard<std::mutex> lock(stateLock);
+        batchComplete.notify_all();
+    }
+}
+
+}  // namespace utilities
@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+/** @file
+@brief a fixed size thread pool for running batches of independent tasks with work stealing
+*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utilities {
+/** a pool of threads that runs indexed batches of tasks
+@details each batch is split into contiguous ranges with one range queued per thread, a thread
+works from the back of its own queue and steals from the front of the other queues when it runs
+out so uneven task costs are balanced without a shared queue, the thread calling parallelFor also
+runs tasks
+*/
+class WorkStealingPool {
+  public:
+    /** create the pool
+    @param threadCount the number of worker threads in addition to the calling thread, 0 uses one
+    less than the hardware concurrency
+    */
+    explicit WorkStealingPool(unsigned int threadCount = 0);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /** run a task for every index in [0,count) and wait for all of them to complete
+    @details only one batch can run at a time, if any task throws the first exception is rethrown
+    after the batch completes
+    */
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& task);
+    /** get the number of threads running tasks including the calling thread*/
+    [[nodiscard]] std::size_t threadCount() const { return queues.size(); }
+
+  private:
+    struct TaskQueue {
+        std::mutex lock;
+        std::deque<std::size_t> tasks;
+    };
+    void workerLoop(std::size_t queueIndex);
+    /** run tasks from the local queue and then from the other queues until all are empty*/
+    void runTasks(std::size_t queueIndex);
+    bool popLocal(std::size_t queueIndex, std::size_t& task);
+    bool steal(std::size_t queueIndex, std::size_t& task);
+    void completeTask();
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;  //!< the last queue belongs to the caller
+    std::vector<std::thread> workers;
+    const std::function<void(std::size_t)>* currentTask{nullptr};
+    std::atomic<std::size_t> remaining{0};  //!< the number of incomplete tasks in the batch
+    std::mutex stateLock;  //!< protects the batch generation, halt flag, and error
+    std::condition_variable batchReady;
+    std::condition_variable batchComplete;
+    std::uint64_t generation{0};
+    std::exception_ptr error;
+    bool halt{false};
+};
+}  // namespace utilities
@@ -8,10 +8,13 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 #include "helics-fmi/helics-fmi-config.h"
 #include "helics/application_api/ValueFederate.hpp"
 #include "helics/application_api/queryFunctions.hpp"
+#include "helicsFMI/FmiCheckpoint.hpp"
 #include "helicsFmiRunner.hpp"
+#include "utilities/columnCapture.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include <algorithm>
 #include <filesystem>
 #include <fmt/format.h>
 #include <future>
@@ -279,3 +282,120 @@ TEST(runnerTests, setfieldFileToml)
     auto str = fut.get();
     EXPECT_EQ(str, 0);
 }
+
+TEST(runnerTests, systemFileGlobalFlags)
+{
+    static const std::string testFile = std::string(TEST_DIR) + "test1.json";
+    helics::cleanupHelicsLibrary();
+    FmiRunner runner;
+    // the global flags reach the federates of a system file before they are configured
+    runner.parse(
+        fmt::format("--fmupath={} --flags=-variable_queries {}", FMI_REFERENCE_DIR, testFile));
+    int ret = runner.load();
+    ASSERT_EQ(ret, 0);
+    ret = runner.initialize();
+    ASSERT_EQ(ret, 0);
+
+    auto fut = runner.runAsync();
+
+    helics::ValueFederate vFed("fed1", "--coretype=zmq --forcenewcore");
+
+    vFed.enterInitializingModeIterative();
+
+    auto stats = vFed.query("bbfed", "stats");
+    EXPECT_EQ(stats.find("\"steps\""), std::string::npos);
+
+    vFed.enterExecutingMode();
+    vFed.requestTime(2.0);
+    vFed.finalize();
+    auto str = fut.get();
+    EXPECT_EQ(str, 0);
+}
+
+TEST(runnerTests, directExecution)
+{
+    FmiRunner runner;
+    runner.parse(std::string("--direct --step=0.1s --stoptime=1.0s --capture=directOut.csv "
+                             "--set Float64_continuous_input=2.5 ") +
+                 ftFile);
+    int ret = runner.load();
+    ASSERT_EQ(ret, 0);
+    ret = runner.initialize();
+    ASSERT_EQ(ret, 0);
+    ret = runner.run();
+    ASSERT_EQ(ret, 0);
+    ret = runner.close();
+    EXPECT_EQ(ret, 0);
+
+    ASSERT_TRUE(std::filesystem::exists("directOut.csv"));
+    const utilities::ColumnCaptureReader reader("directOut.csv");
+    EXPECT_EQ(reader.rowCount(), 11U);
+    EXPECT_NEAR(reader.getColumn(0).back(), 1.0, 1e-9);
+    const auto& names = reader.getNames();
+    const auto output = std::find(names.begin(), names.end(), "Float64_continuous_output");
+    ASSERT_NE(output, names.end());
+    EXPECT_DOUBLE_EQ(
+        reader.getColumn(static_cast<std::size_t>(output - names.begin())).back(), 2.5);
+    std::filesystem::remove("directOut.csv");
+}
+
+TEST(runnerTests, checkpointRestart)
+{
+    FmiRunner runner;
+    runner.parse(std::string("--autobroker --step=0.1s --stoptime=1.0s --name=bball "
+                             "--capture=fullRun.csv --checkpoint=bball.hfcp "
+                             "--checkpoint-interval=0.6s ") +
+                 bballFile);
+    int ret = runner.load();
+    ASSERT_EQ(ret, 0);
+    ret = runner.initialize();
+    ASSERT_EQ(ret, 0);
+    ret = runner.run();
+    ASSERT_EQ(ret, 0);
+    runner.close();
+
+    ASSERT_TRUE(std::filesystem::exists("bball.hfcp"));
+    const auto points = helicsfmi::loadCheckpoint("bball.hfcp");
+    ASSERT_EQ(points.size(), 1U);
+    EXPECT_EQ(points[0].name, "bball");
+    EXPECT_NEAR(points[0].time, 0.6, 1e-9);
+    EXPECT_FALSE(points[0].state.empty());
+
+    FmiRunner restart;
+    restart.parse(std::string("--autobroker --step=0.1s --stoptime=1.0s --name=bball "
+                              "--capture=restartRun.csv --restart-from=bball.hfcp ") +
+                  bballFile);
+    ret = restart.load();
+    ASSERT_EQ(ret, 0);
+    ret = restart.initialize();
+    ASSERT_EQ(ret, 0);
+    ret = restart.run();
+    ASSERT_EQ(ret, 0);
+    restart.close();
+
+    const utilities::ColumnCaptureReader full("fullRun.csv");
+    const utilities::ColumnCaptureReader resumed("restartRun.csv");
+    ASSERT_EQ(resumed.rowCount(), 5U);
+    EXPECT_NEAR(resumed.getColumn(0).front(), 0.6, 1e-9);
+    EXPECT_NEAR(resumed.getColumn(0).back(), 1.0, 1e-9);
+    // the resumed run reaches the same state as the uninterrupted run
+    for (std::size_t col = 1; col < full.getNames().size(); ++col) {
+        EXPECT_NEAR(resumed.getColumn(col).back(), full.getColumn(col).back(), 1e-9);
+    }
+    std::filesystem::remove("bball.hfcp");
+    std::filesystem::remove("fullRun.csv");
+    std::filesystem::remove("restartRun.csv");
+}
+
+TEST(runnerTests, checkpointUnaligned)
+{
+    // steps of 0.25 never reach the checkpoint at 0.6 so the checkpoint could never complete
+    FmiRunner runner;
+    runner.parse(std::string("--autobroker --step=0.25s --stoptime=1.0s --name=bball "
+                             "--checkpoint=unaligned.hfcp --checkpoint-interval=0.6s ") +
+                 bballFile);
+    ASSERT_EQ(runner.load(), 0);
+    EXPECT_EQ(runner.initialize(), FmiRunner::INCORRECT_FMU);
+    runner.close();
+    EXPECT_FALSE(std::filesystem::exists("unaligned.hfcp"));
+}
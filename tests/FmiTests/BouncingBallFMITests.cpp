@@ -166,3 +166,27 @@ TEST(bouncingBall, csExecution)
 
     fmi.reset();
 }
+
+TEST(bouncingBall, localOutputs)
+{
+    auto fmi = std::make_shared<FmiLibrary>();
+    EXPECT_NO_THROW(fmi->loadFMU(inputFile));
+
+    auto fmiObj = fmi->createCoSimulationObject("model_cs");
+    ASSERT_TRUE(fmiObj);
+    auto locals = fmi->getInfo()->getVariableNames("local");
+    ASSERT_EQ(locals.size(), 2U);
+
+    EXPECT_EQ(fmiObj->getOutputNames().size(), 2U);
+    EXPECT_TRUE(fmiObj->setFlag("default_local_outputs", true));
+    EXPECT_EQ(fmiObj->getOutputNames().size(), 4U);
+
+    EXPECT_GE(fmiObj->addOutputVariable(locals[0]).index, 0);
+    EXPECT_TRUE(fmiObj->setFlag("local_outputs", false));
+    EXPECT_LT(fmiObj->addOutputVariable(locals[1]).index, 0);
+    EXPECT_EQ(fmiObj->outputSize(), 1);
+
+    fmiObj.reset();
+    fmi->deleteFMUdirectory();
+    fmi.reset();
+}
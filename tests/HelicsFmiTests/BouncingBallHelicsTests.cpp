@@ -10,12 +10,44 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 
 #include "gtest/gtest.h"
 #include <filesystem>
+#include <fstream>
 #include <future>
+#include <iterator>
+#include <string>
+#include <vector>
 
 static const std::string inputFile = std::string(FMI_REFERENCE_DIR) + "BouncingBall.fmu";
 
 using helicsfmi::CoSimFederate;
 
+/** get the values of the first publication of the ball at each step of a run*/
+static std::vector<double> subscribedValues(std::size_t runAhead, const std::string& captureFile)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    auto csFed = std::make_shared<CoSimFederate>("bball", inputFile, fedInfo);
+    fedInfo.coreInitString.clear();
+    helics::ValueFederate vFed("fed1", fedInfo);
+    csFed->setRunAhead(runAhead);
+    csFed->setOutputCapture(true, captureFile);
+    csFed->configure(0.1, 0.0);
+
+    auto result = std::async(std::launch::async, [csFed]() { csFed->run(2.0); });
+    vFed.enterInitializingModeIterative();
+    auto qres = helics::vectorizeQueryResult(vFed.query("root", "publications"));
+    auto& sub = vFed.registerSubscription(qres[0]);
+    vFed.enterExecutingMode();
+    std::vector<double> values;
+    for (int step = 1; step <= 20; ++step) {
+        vFed.requestTime(0.1 * step);
+        values.push_back(sub.getValue<double>());
+    }
+    vFed.finalize();
+    result.get();
+    return values;
+}
+
 TEST(bouncingBall, simpleRun)
 {
     helics::FederateInfo fedInfo(helics::CoreType::INPROC);
@@ -120,6 +152,30 @@ TEST(bouncingBall, checkPubsExtra)
     result.get();
 }
 
+TEST(bouncingBall, runAhead)
+{
+    EXPECT_TRUE(std::filesystem::exists(inputFile));
+    const auto stepped = subscribedValues(0, "stepped.csv");
+    const auto buffered = subscribedValues(4, "buffered.csv");
+    ASSERT_EQ(stepped.size(), buffered.size());
+    for (std::size_t ii = 0; ii < stepped.size(); ++ii) {
+        EXPECT_DOUBLE_EQ(stepped[ii], buffered[ii]);
+    }
+    // the steps computed ahead are captured at the times of the steps
+    std::ifstream steppedFile("stepped.csv");
+    std::ifstream bufferedFile("buffered.csv");
+    const std::string steppedText((std::istreambuf_iterator<char>(steppedFile)),
+                                  std::istreambuf_iterator<char>());
+    const std::string bufferedText((std::istreambuf_iterator<char>(bufferedFile)),
+                                   std::istreambuf_iterator<char>());
+    EXPECT_FALSE(steppedText.empty());
+    EXPECT_EQ(steppedText, bufferedText);
+    steppedFile.close();
+    bufferedFile.close();
+    std::filesystem::remove("stepped.csv");
+    std::filesystem::remove("buffered.csv");
+}
+
 TEST(bouncingBall, setHeight)
 {
     helics::FederateInfo fedInfo(helics::CoreType::INPROC);
@@ -240,3 +296,33 @@ TEST(bouncingBall, setHeightRemoteCommand)
     vFed.finalize();
     result.get();
 }
+
+TEST(bouncingBall, runAheadCommand)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    auto csFed = std::make_shared<CoSimFederate>("bball", inputFile, fedInfo);
+    fedInfo.coreInitString.clear();
+    helics::ValueFederate vFed("fed1", fedInfo);
+    csFed->setRunAhead(2);
+    csFed->configure(0.1, 0.0);
+
+    auto result = std::async(std::launch::async, [csFed]() { csFed->run(2.0); });
+    auto& sub = vFed.registerSubscription("bball/h");
+    vFed.enterExecutingMode();
+    std::vector<double> values;
+    for (int step = 1; step <= 20; ++step) {
+        vFed.requestTime(0.1 * step);
+        if (step == 1) {
+            // the ball stops at the next bounce without restitution
+            vFed.sendCommand("bball", "set e 0.0");
+        }
+        values.push_back(sub.getValue<double>());
+    }
+    vFed.finalize();
+    result.get();
+    for (std::size_t ii = 14; ii < values.size(); ++ii) {
+        EXPECT_LT(values[ii], 1e-3);
+    }
+}
@@ -6,12 +6,19 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 */
 
 #include "FmiCoSimFederate.hpp"
+#include "FmiEnsembleFederate.hpp"
+#include "FmiStandalone.hpp"
+#include "FmiSystemFederate.hpp"
+#include "formatInterpreters/JsonProcessingFunctions.hpp"
 #include "helics/application_api/helicsTypes.hpp"
 #include "helics/application_api/queryFunctions.hpp"
 
 #include "gtest/gtest.h"
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
 #include <future>
+#include <vector>
 
 static const std::string inputFile = std::string(FMI_REFERENCE_DIR) + "Feedthrough.fmu";
 
@@ -33,6 +40,384 @@ TEST(feedthrough, simpleRun)
     std::filesystem::remove("testOut.csv");
 }
 
+TEST(feedthrough, binaryCapture)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    csFed->setOutputCapture(true, "testOut.hcapz");
+    csFed->configure(0.1, 0.0);
+    csFed->run(2.0);
+
+    ASSERT_TRUE(std::filesystem::exists("testOut.hcapz"));
+    const utilities::ColumnCaptureReader reader("testOut.hcapz");
+    EXPECT_GT(reader.columnCount(), 1U);
+    EXPECT_EQ(reader.rowCount(), 21U);
+    EXPECT_DOUBLE_EQ(reader.getColumn(0).back(), 2.0);
+    std::filesystem::remove("testOut.hcapz");
+}
+
+TEST(feedthrough, outputDeadband)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    EXPECT_TRUE(std::filesystem::exists(inputFile));
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    csFed->setOutputTolerance(0.01);
+    csFed->configure(0.1, 0.0);
+    csFed->run(2.0);
+    // the inputs never change so only the initial numeric values should be published
+    const auto& stats = csFed->getOutputStatistics();
+    EXPECT_GT(stats.published, 0U);
+    EXPECT_GT(stats.suppressed, 0U);
+    EXPECT_GT(stats.suppressed, stats.published);
+}
+
+TEST(feedthrough, adaptiveStep)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    EXPECT_TRUE(std::filesystem::exists(inputFile));
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    csFed->setAdaptiveStep(0.1, 1.0);
+    csFed->configure(0.1, 0.0);
+    csFed->run(10.0);
+    // the outputs are constant so the step grows to the maximum and far fewer steps are taken
+    const auto& stats = csFed->getOutputStatistics();
+    EXPECT_GT(stats.published, 0U);
+    EXPECT_LT(stats.published + stats.suppressed, 100U);
+}
+
+TEST(feedthrough, eventTriggered)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    EXPECT_TRUE(std::filesystem::exists(inputFile));
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    EXPECT_TRUE(csFed->setFlag("event_triggered", true));
+    csFed->configure(0.1, 0.0);
+    csFed->run(2.0);
+    // without any input updates the FMU is stepped to the stop time in a single step
+    const auto& stats = csFed->getOutputStatistics();
+    EXPECT_GT(stats.published, 0U);
+    EXPECT_LT(stats.published + stats.suppressed, 20U);
+}
+
+TEST(feedthrough, iterativeStep)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    auto fmi = std::make_shared<FmiLibrary>();
+    ASSERT_TRUE(fmi->loadFMU(inputFile));
+    std::shared_ptr<fmi2CoSimObject> obj = fmi->createCoSimulationObject("fthrough");
+    ASSERT_TRUE(obj);
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", obj, fedInfo));
+    csFed->setIterativeStep(5);
+    csFed->setInputs({"Float64_continuous_input"});
+    csFed->setOutputs({"Float64_continuous_output"});
+    csFed->setOutputCapture(true, "iterativeStep.csv");
+
+    fedInfo.coreInitString.clear();
+    helics::ValueFederate vFed("fed1", fedInfo);
+    csFed->configure(0.1, 0.0);
+
+    auto sync = std::async(std::launch::async, [csFed]() { csFed->run(2.0); });
+
+    auto& sub = vFed.registerSubscription("fthrough.Float64_continuous_output");
+    auto& pub = vFed.registerPublication<double>("");
+    pub.addInputTarget("fthrough.Float64_continuous_input");
+    vFed.enterExecutingMode();
+    EXPECT_DOUBLE_EQ(vFed.requestTime(0.1), 0.1);
+    // a new input at the end of the step makes the federate repeat the step with it
+    pub.publish(5.0);
+    auto result = vFed.requestTimeIterative(0.1, helics::IterationRequest::ITERATE_IF_NEEDED);
+    EXPECT_EQ(result.state, helics::IterationResult::ITERATING);
+    EXPECT_DOUBLE_EQ(sub.getValue<double>(), 5.0);
+    vFed.requestTime(2.0);
+    vFed.finalize();
+    sync.get();
+    EXPECT_GE(csFed->getStepIterations(), 1U);
+
+    // the rows are stamped with the granted times so the FMU must end at the last of them
+    const utilities::ColumnCaptureReader reader("iterativeStep.csv");
+    ASSERT_GE(reader.rowCount(), 2U);
+    const auto& times = reader.getColumn(0);
+    for (std::size_t ii = 1; ii < times.size(); ++ii) {
+        EXPECT_GT(times[ii], times[ii - 1]);
+    }
+    EXPECT_NEAR(times.back(), 2.0, 1e-9);
+    EXPECT_NEAR(obj->getLastStepTime(), times.back(), 1e-9);
+    EXPECT_DOUBLE_EQ(reader.getColumn(1).back(), 5.0);
+    std::filesystem::remove("iterativeStep.csv");
+}
+
+TEST(feedthrough, speculativeStep)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    EXPECT_TRUE(csFed->setFlag("speculative_step", true));
+    csFed->setInputs({"Float64_continuous_input"});
+    csFed->setOutputs({"Float64_continuous_output"});
+
+    fedInfo.coreInitString.clear();
+    helics::ValueFederate vFed("fed1", fedInfo);
+    csFed->configure(0.1, 0.0);
+
+    auto sync = std::async(std::launch::async, [csFed]() { csFed->run(1.0); });
+
+    auto& sub = vFed.registerSubscription("fthrough.Float64_continuous_output");
+    auto& pub = vFed.registerPublication<double>("");
+    pub.addInputTarget("fthrough.Float64_continuous_input");
+    vFed.setProperty(HELICS_PROPERTY_TIME_PERIOD, 0.1);
+    vFed.enterExecutingMode();
+    pub.publish(2.0);
+    std::vector<double> values;
+    for (int step = 1; step <= 10; ++step) {
+        vFed.requestTime(0.1 * step);
+        values.push_back(sub.getValue<double>());
+        if (step == 5) {
+            pub.publish(5.0);
+        }
+    }
+    vFed.finalize();
+    sync.get();
+    // the held input matches the prediction until it changes
+    EXPECT_DOUBLE_EQ(values[3], 2.0);
+    EXPECT_DOUBLE_EQ(values.back(), 5.0);
+    const auto& stats = csFed->getSpeculationStatistics();
+    EXPECT_GT(stats.steps, 0U);
+    EXPECT_EQ(stats.kept + stats.rolledBack, stats.steps);
+    EXPECT_GE(stats.kept, 1U);
+    EXPECT_GE(stats.rolledBack, 1U);
+}
+
+TEST(feedthrough, variableQueries)
+{
+    using helicsfmi::fileops::loadJsonStr;
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    csFed->setInputs({"Float64_continuous_input"});
+    csFed->setOutputs({"Float64_continuous_output"});
+
+    fedInfo.coreInitString.clear();
+    helics::ValueFederate vFed("fed1", fedInfo);
+    csFed->configure(0.1, 0.0);
+
+    auto sync = std::async(std::launch::async, [csFed]() { csFed->run(1.0); });
+
+    auto& pub = vFed.registerPublication<double>("");
+    pub.addInputTarget("fthrough.Float64_continuous_input");
+    vFed.setProperty(HELICS_PROPERTY_TIME_PERIOD, 0.1);
+    vFed.enterExecutingMode();
+    pub.publish(3.0);
+    // a variable is read after the steps following its first query
+    auto first = loadJsonStr(vFed.query("fthrough", "value/Float64_continuous_input"));
+    EXPECT_TRUE(first["pending"].asBool());
+    vFed.requestTime(0.5);
+    auto second = loadJsonStr(vFed.query("fthrough", "value/Float64_continuous_input"));
+    EXPECT_FALSE(second.isMember("pending"));
+    EXPECT_DOUBLE_EQ(second["value"].asDouble(), 3.0);
+    EXPECT_GT(second["time"].asDouble(), 0.0);
+
+    auto values = loadJsonStr(vFed.query("fthrough", "values/Float64_continuous_*"));
+    EXPECT_TRUE(values["values"].isMember("Float64_continuous_input"));
+    EXPECT_TRUE(values.isMember("pending"));
+
+    auto stats = loadJsonStr(vFed.query("fthrough", "stats"));
+    EXPECT_GT(stats["steps"].asUInt64(), 0U);
+    EXPECT_GE(stats["variables"].asUInt64(), 1U);
+    EXPECT_TRUE(stats.isMember("discarded_steps"));
+
+    auto invalid = loadJsonStr(vFed.query("fthrough", "value/not_a_variable"));
+    EXPECT_TRUE(invalid.isMember("error"));
+    vFed.finalize();
+    sync.get();
+}
+
+TEST(feedthrough, discardRetry)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    csFed->setDiscardRetry(3);
+    csFed->setOutputCapture(true, "discardRetry.csv");
+    csFed->configure(0.1, 0.0);
+    EXPECT_NO_THROW(csFed->run(1.0));
+    // steps that are never discarded take the full step
+    EXPECT_EQ(csFed->getDiscardedSteps(), 0U);
+    const utilities::ColumnCaptureReader reader("discardRetry.csv");
+    EXPECT_EQ(reader.rowCount(), 11U);
+    std::filesystem::remove("discardRetry.csv");
+}
+
+TEST(feedthrough, interfaceTiming)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    std::shared_ptr<CoSimFederate> source;
+    EXPECT_NO_THROW(source = std::make_shared<CoSimFederate>("source", inputFile, fedInfo));
+    EXPECT_TRUE(source->setFlag("interface_timing", true));
+    source->setInputs({});
+    source->configure(0.1, 0.0);
+    EXPECT_TRUE((*source)->getFlagOption(HELICS_FLAG_SOURCE_ONLY));
+    EXPECT_FALSE((*source)->getFlagOption(HELICS_FLAG_OBSERVER));
+    source->run(0.5);
+
+    std::shared_ptr<CoSimFederate> sink;
+    EXPECT_NO_THROW(sink = std::make_shared<CoSimFederate>("sink", inputFile, fedInfo));
+    EXPECT_TRUE(sink->setFlag("interface_timing", true));
+    sink->setOutputs({});
+    sink->configure(0.1, 0.0);
+    EXPECT_TRUE((*sink)->getFlagOption(HELICS_FLAG_OBSERVER));
+    EXPECT_FALSE((*sink)->getFlagOption(HELICS_FLAG_SOURCE_ONLY));
+    sink->run(0.5);
+
+    std::shared_ptr<CoSimFederate> manual;
+    EXPECT_NO_THROW(manual = std::make_shared<CoSimFederate>("manual", inputFile, fedInfo));
+    // the timing flags are only changed when the flag is set
+    manual->setInputs({});
+    manual->configure(0.1, 0.0);
+    EXPECT_FALSE((*manual)->getFlagOption(HELICS_FLAG_SOURCE_ONLY));
+    manual->run(0.5);
+}
+
+TEST(feedthrough, inputExtrapolation)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    csFed->setInputExtrapolation(helicsfmi::InputExtrapolation::linear);
+    // a speculative step would compare the received values with the held values
+    EXPECT_TRUE(csFed->setFlag("speculative_step", true));
+    csFed->setInputs({"Float64_continuous_input"});
+    csFed->setOutputs({"Float64_continuous_output"});
+
+    fedInfo.coreInitString.clear();
+    helics::ValueFederate vFed("fed1", fedInfo);
+    csFed->configure(0.1, 0.0);
+
+    auto sync = std::async(std::launch::async, [csFed]() { csFed->run(3.0); });
+
+    auto& sub = vFed.registerSubscription("fthrough.Float64_continuous_output");
+    auto& pub = vFed.registerPublication<double>("");
+    pub.addInputTarget("fthrough.Float64_continuous_input");
+    vFed.enterExecutingMode();
+    EXPECT_DOUBLE_EQ(vFed.requestTime(1.0), 1.0);
+    pub.publish(1.0);
+    EXPECT_DOUBLE_EQ(vFed.requestTime(2.0), 2.0);
+    pub.publish(2.0);
+    // the ramp continues between the updates instead of holding the last value
+    vFed.requestTime(2.5);
+    const auto value = sub.getValue<double>();
+    EXPECT_GT(value, 2.2);
+    EXPECT_LT(value, 2.6);
+    vFed.requestTime(3.0);
+    vFed.finalize();
+    sync.get();
+    EXPECT_EQ(csFed->getSpeculationStatistics().steps, 0U);
+}
+
+TEST(feedthrough, variablePatterns)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f1";
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    csFed->setInputs({"Float64_*_input"});
+    csFed->setOutputs({"regex:(Int32|Boolean)_output", "Float64_continuous_output"});
+    csFed->configure(0.1, 0.0);
+    EXPECT_TRUE(csFed->isConfigured());
+    EXPECT_EQ((*csFed)->getInputCount(), 2);
+    EXPECT_EQ((*csFed)->getPublicationCount(), 3);
+    csFed->run(1.0);
+}
+
+TEST(feedthrough, vectorGroups)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    csFed->setInputs({"Float64_*_input"});
+    csFed->setOutputs({"Float64_*_output", "Int32_output"});
+    csFed->addInputGroup("inputs", {"Float64_continuous_input", "Float64_discrete_input"});
+    csFed->addOutputGroup("outputs", {"Float64_*_output"});
+
+    fedInfo.coreInitString.clear();
+    helics::ValueFederate vFed("fed1", fedInfo);
+    csFed->configure(0.1, 0.0);
+    // the grouped variables only have the vector interfaces
+    EXPECT_EQ((*csFed)->getInputCount(), 1);
+    EXPECT_EQ((*csFed)->getPublicationCount(), 2);
+
+    auto sync = std::async(std::launch::async, [csFed]() { csFed->run(1.0); });
+
+    auto& sub = vFed.registerSubscription("fthrough.outputs");
+    auto& pub = vFed.registerPublication<std::vector<double>>("");
+    pub.addInputTarget("fthrough.inputs");
+    vFed.enterExecutingMode();
+    pub.publish(std::vector<double>{3.0, 4.0});
+    vFed.requestTime(0.5);
+    const auto values = sub.getValue<std::vector<double>>();
+    ASSERT_EQ(values.size(), 2U);
+    EXPECT_DOUBLE_EQ(values[0], 3.0);
+    vFed.requestTime(1.0);
+    vFed.finalize();
+    sync.get();
+}
+
+TEST(feedthrough, subSteps)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    csFed->setSubStep(0.1, helicsfmi::OutputAggregation::average);
+    csFed->setInputExtrapolation(helicsfmi::InputExtrapolation::linear);
+    csFed->setInputs({"Float64_continuous_input"});
+    csFed->setOutputs({"Float64_continuous_output"});
+
+    fedInfo.coreInitString.clear();
+    helics::ValueFederate vFed("fed1", fedInfo);
+    csFed->configure(0.5, 0.0);
+    EXPECT_EQ(csFed->getSubStepCount(), 5);
+
+    auto sync = std::async(std::launch::async, [csFed]() { csFed->run(2.0); });
+
+    auto& sub = vFed.registerSubscription("fthrough.Float64_continuous_output");
+    auto& pub = vFed.registerPublication<double>("");
+    pub.addInputTarget("fthrough.Float64_continuous_input");
+    vFed.enterExecutingMode();
+    EXPECT_DOUBLE_EQ(vFed.requestTime(0.5), 0.5);
+    pub.publish(1.0);
+    EXPECT_DOUBLE_EQ(vFed.requestTime(1.0), 1.0);
+    pub.publish(2.0);
+    // the ramp is extrapolated over the sub-steps from 1.0 to 1.5 and the average is published
+    vFed.requestTime(1.6);
+    EXPECT_NEAR(sub.getValue<double>(), 2.5, 1e-9);
+    vFed.requestTime(2.0);
+    vFed.finalize();
+    sync.get();
+}
+
 TEST(feedthrough, checkIO)
 {
     helics::FederateInfo fedInfo(helics::CoreType::INPROC);
@@ -76,6 +461,130 @@ TEST(feedthrough, checkIO)
     sync.get();
 }
 
+TEST(feedthrough, connectedOutputsOnly)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    EXPECT_TRUE(std::filesystem::exists(inputFile));
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    EXPECT_TRUE(csFed->setFlag("connected_outputs_only", true));
+
+    fedInfo.coreInitString.clear();
+
+    helics::ValueFederate vFed("fed1", fedInfo);
+    csFed->configure(0.1, 0.0);
+
+    auto sync = std::async(std::launch::async, [csFed]() { csFed->run(2.0); });
+
+    vFed.enterInitializingModeIterative();
+
+    auto qres = helics::vectorizeQueryResult(vFed.query("fthrough", "publications"));
+    ASSERT_EQ(qres.size(), 5U);
+
+    auto& sub1 = vFed.registerSubscription(qres[0]);
+    sub1.setDefault(-20.0);
+
+    vFed.enterExecutingMode();
+    auto time = vFed.requestTime(2.0);
+    EXPECT_LT(time, 2.0);
+    EXPECT_NE(sub1.getValue<double>(), -20.0);
+    vFed.finalize();
+    sync.get();
+    // only the single subscribed output is read and published each step
+    const auto& stats = csFed->getOutputStatistics();
+    EXPECT_GT(stats.published, 0U);
+    EXPECT_LE(stats.published + stats.suppressed, 25U);
+}
+
+TEST(feedthrough, ensemble)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    auto fmi = std::make_shared<FmiLibrary>();
+    ASSERT_TRUE(fmi->loadFMU(inputFile));
+    std::shared_ptr<helicsfmi::EnsembleFederate> ensemble;
+    EXPECT_NO_THROW(ensemble =
+                        std::make_shared<helicsfmi::EnsembleFederate>("ens", fmi, 3, fedInfo));
+    ASSERT_EQ(ensemble->size(), 3U);
+    ensemble->setThreadCount(2);
+    ensemble->setInputs({"Float64_continuous_input"});
+    ensemble->setOutputs({"Float64_continuous_output"});
+    ensemble->set("Float64_tunable_parameter[2]", 4.5);
+    EXPECT_THROW(ensemble->set("Float64_tunable_parameter[3]", 4.5), helicsfmi::Error);
+
+    fedInfo.coreInitString.clear();
+
+    helics::ValueFederate vFed("fed1", fedInfo);
+    ensemble->configure(0.1, 0.0);
+
+    auto sync = std::async(std::launch::async, [ensemble]() { ensemble->run(2.0); });
+
+    vFed.enterInitializingModeIterative();
+    auto qres = helics::vectorizeQueryResult(vFed.query("ens", "publications"));
+    EXPECT_EQ(qres.size(), 3U);
+    auto& sub0 = vFed.registerSubscription("ens.Float64_continuous_output[0]");
+    sub0.setDefault(-20.0);
+    auto& sub1 = vFed.registerSubscription("ens.Float64_continuous_output[1]");
+    sub1.setDefault(-20.0);
+    auto& pub1 = vFed.registerPublication<double>("");
+    pub1.addInputTarget("ens.Float64_continuous_input[1]");
+
+    vFed.enterInitializingMode();
+    pub1.publish(13.56);
+    vFed.enterExecutingMode();
+
+    auto time = vFed.requestTime(2.0);
+    EXPECT_LT(time, 2.0);
+    // only the instance with the connected input has a changed output
+    EXPECT_DOUBLE_EQ(sub1.getValue<double>(), 13.56);
+    EXPECT_NE(sub0.getValue<double>(), 13.56);
+    EXPECT_DOUBLE_EQ(ensemble->getInstance(2).get<double>("Float64_tunable_parameter"), 4.5);
+
+    vFed.finalize();
+    sync.get();
+}
+
+TEST(feedthrough, localCoupling)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    FmiLibrary fmi;
+    ASSERT_TRUE(fmi.loadFMU(inputFile));
+    auto system = std::make_shared<helicsfmi::SystemFederate>("system", fedInfo);
+    // added in reverse order so the step order has to come from the connections
+    system->addFMU(fmi.createCoSimulationObject("ft2"));
+    system->addFMU(fmi.createCoSimulationObject("ft1"));
+    system->configure(0.1, 0.0);
+    auto& coupled = (*system)->getInput("ft2.Float64_continuous_input");
+    coupled.addPublication("ft1.Float64_continuous_output");
+
+    fedInfo.coreInitString.clear();
+    helics::ValueFederate vFed("fed1", fedInfo);
+
+    auto sync = std::async(std::launch::async, [system]() { system->run(2.0); });
+
+    auto& sub = vFed.registerSubscription("ft2.Float64_continuous_output");
+    sub.setDefault(-20.0);
+    auto& pub = vFed.registerPublication<double>("");
+    pub.addInputTarget("ft1.Float64_continuous_input");
+    vFed.enterInitializingMode();
+    pub.publish(13.56);
+    vFed.enterExecutingMode();
+
+    auto time = vFed.requestTime(2.0);
+    EXPECT_LT(time, 2.0);
+    // the value passes through both FMUs within a single step
+    EXPECT_DOUBLE_EQ(sub.getValue<double>(), 13.56);
+    EXPECT_EQ(system->localConnectionCount(), 1U);
+
+    vFed.finalize();
+    sync.get();
+}
+
 TEST(feedthrough, checkFeedthrough)
 {
     helics::FederateInfo fedInfo(helics::CoreType::INPROC);
@@ -193,3 +702,165 @@ TEST(feedthrough, pubTypes)
     vFed.finalize();
     sync.get();
 }
+
+TEST(feedthrough, outputDependencies)
+{
+    auto fmi = std::make_shared<FmiLibrary>();
+    EXPECT_TRUE(fmi->loadFMU(inputFile));
+    auto obj = fmi->createCoSimulationObject("ft1");
+    ASSERT_TRUE(obj);
+
+    helicsfmi::OutputDependencies deps;
+    deps.build(*obj);
+    EXPECT_TRUE(deps.hasFeedthrough());
+    EXPECT_EQ(deps.staticCount(), 0U);
+
+    const auto& info = obj->fmuInformation();
+    const auto inputCount = static_cast<std::size_t>(obj->inputSize());
+    std::size_t continuousInput{inputCount};
+    for (std::size_t ii = 0; ii < inputCount; ++ii) {
+        const auto index = obj->getInput(static_cast<int>(ii)).index;
+        if (info.getVariableInfo(index).name == "Float64_continuous_input") {
+            continuousInput = ii;
+        }
+    }
+    ASSERT_LT(continuousInput, inputCount);
+    const auto& affected = deps.getFeedthrough(continuousInput);
+    ASSERT_FALSE(affected.empty());
+    bool found{false};
+    for (auto output : affected) {
+        if (info.getVariableInfo(obj->getOutput(static_cast<int>(output)).index).name ==
+            "Float64_continuous_output") {
+            found = true;
+        }
+    }
+    EXPECT_TRUE(found);
+    EXPECT_EQ(deps.getAffectedOutputs({continuousInput}), affected);
+}
+
+TEST(feedthrough, outputUpdates)
+{
+    auto fmi = std::make_shared<FmiLibrary>();
+    EXPECT_TRUE(fmi->loadFMU(inputFile));
+    auto obj = fmi->createCoSimulationObject("ft1");
+    ASSERT_TRUE(obj);
+
+    helicsfmi::OutputDependencies deps;
+    deps.build(*obj);
+    const auto& info = obj->fmuInformation();
+    const auto outputCount = static_cast<std::size_t>(obj->outputSize());
+    int checked{0};
+    for (std::size_t ii = 0; ii < outputCount; ++ii) {
+        const auto& name = info.getVariableInfo(obj->getOutput(static_cast<int>(ii)).index).name;
+        if (name == "Float64_continuous_output") {
+            EXPECT_EQ(deps.getUpdate(ii), helicsfmi::OutputUpdate::continuous);
+            ++checked;
+        } else if (name == "Float64_discrete_output") {
+            EXPECT_EQ(deps.getUpdate(ii), helicsfmi::OutputUpdate::discrete);
+            ++checked;
+        }
+    }
+    EXPECT_EQ(checked, 2);
+    const auto discrete = deps.getOutputs(helicsfmi::OutputUpdate::discrete);
+    const auto continuous = deps.getOutputs(helicsfmi::OutputUpdate::continuous);
+    EXPECT_EQ(discrete.size() + continuous.size() + deps.staticCount() +
+                  deps.getOutputs(helicsfmi::OutputUpdate::tunable).size(),
+              outputCount);
+}
+
+TEST(feedthrough, parameterSweep)
+{
+    {
+        std::ofstream table("sweepCases.csv");
+        table << "Float64_continuous_input,Int32_input\n";
+        for (int ii = 0; ii < 8; ++ii) {
+            table << ii * 0.5 << ',' << ii << '\n';
+        }
+    }
+    auto fmi = std::make_shared<FmiLibrary>();
+    ASSERT_TRUE(fmi->loadFMU(inputFile));
+    helicsfmi::ParameterSweep sweep(fmi, helicsfmi::loadParameterTable("sweepCases.csv"));
+    EXPECT_EQ(sweep.size(), 8U);
+    sweep.setOutputs({"Float64_continuous_output", "Int32_output"});
+    sweep.setThreadCount(3);
+    sweep.configure(0.1);
+    EXPECT_EQ(sweep.run(1.0, "sweepResults.csv"), 0U);
+
+    const utilities::ColumnCaptureReader reader("sweepResults.csv");
+    ASSERT_EQ(reader.columnCount(), 5U);
+    ASSERT_EQ(reader.rowCount(), 8U);
+    for (std::size_t ii = 0; ii < 8; ++ii) {
+        // the rows are in case order and every output follows its own case input
+        EXPECT_DOUBLE_EQ(reader.getColumn(0)[ii], static_cast<double>(ii));
+        EXPECT_DOUBLE_EQ(reader.getColumn(3)[ii], reader.getColumn(1)[ii]);
+        EXPECT_DOUBLE_EQ(reader.getColumn(4)[ii], reader.getColumn(2)[ii]);
+    }
+    std::filesystem::remove("sweepCases.csv");
+    std::filesystem::remove("sweepResults.csv");
+}
+
+TEST(feedthrough, inputReplay)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("fthrough", inputFile, fedInfo));
+    csFed->setInputs({"Float64_continuous_input"});
+    csFed->setOutputs({"Float64_continuous_output"});
+    csFed->setOutputCapture(true, "recordedRun.csv");
+    csFed->setInputRecord("recordedInputs.hrec");
+    csFed->set("Float64_tunable_parameter", 3.5);
+
+    fedInfo.coreInitString.clear();
+    helics::ValueFederate vFed("fed1", fedInfo);
+    csFed->configure(0.1, 0.0);
+
+    auto sync = std::async(std::launch::async, [csFed]() { csFed->run(1.0); });
+
+    auto& pub = vFed.registerPublication<double>("");
+    pub.addInputTarget("fthrough.Float64_continuous_input");
+    vFed.setProperty(HELICS_PROPERTY_TIME_PERIOD, 0.1);
+    vFed.enterExecutingMode();
+    pub.publish(2.0);
+    for (int step = 1; step <= 10; ++step) {
+        vFed.requestTime(0.1 * step);
+        if (step % 3 == 0) {
+            pub.publish(2.0 + step);
+        }
+    }
+    vFed.finalize();
+    sync.get();
+
+    const auto recording = helicsfmi::loadInputRecording("recordedInputs.hrec");
+    const auto& names = recording.names;
+    EXPECT_NE(std::find(names.begin(), names.end(), "Float64_continuous_input"), names.end());
+    // parameters set before the run are recorded so the replay does not need them again
+    EXPECT_NE(std::find(names.begin(), names.end(), "Float64_tunable_parameter"), names.end());
+    auto fmi = std::make_shared<FmiLibrary>();
+    ASSERT_TRUE(fmi->loadFMU(inputFile));
+    helicsfmi::StandaloneCoSim replay(fmi->createCoSimulationObject("ft1"));
+    replay.setOutputs({"Float64_continuous_output"});
+    replay.configure(0.0);
+    {
+        utilities::ColumnCapture capture("replayedRun.csv",
+                                         replay.getOutputNames(),
+                                         utilities::getCaptureFormat("replayedRun.csv"));
+        EXPECT_NEAR(replay.replay(recording, &capture), 1.0, 1e-9);
+        capture.close();
+    }
+    EXPECT_EQ(replay.getStepCount(), 10U);
+    EXPECT_DOUBLE_EQ(replay->get<double>("Float64_tunable_parameter"), 3.5);
+
+    // the replay reproduces the outputs of the federate at every step
+    const utilities::ColumnCaptureReader recorded("recordedRun.csv");
+    const utilities::ColumnCaptureReader replayed("replayedRun.csv");
+    ASSERT_EQ(replayed.rowCount(), recorded.rowCount());
+    for (std::size_t ii = 0; ii < recorded.rowCount(); ++ii) {
+        EXPECT_NEAR(replayed.getColumn(0)[ii], recorded.getColumn(0)[ii], 1e-9);
+        EXPECT_DOUBLE_EQ(replayed.getColumn(1)[ii], recorded.getColumn(1)[ii]);
+    }
+    std::filesystem::remove("recordedInputs.hrec");
+    std::filesystem::remove("recordedRun.csv");
+    std::filesystem::remove("replayedRun.csv");
+}
@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2017-2023,
+Battelle Memorial Institute; Lawrence Livermore National Security, LLC; Alliance
+for Sustainable Energy, LLC.  See the top-level NOTICE for additional details.
+All rights reserved. SPDX-License-Identifier: BSD-3-Clause
+*/
+
+#include "FmiCoSimFederate.hpp"
+
+#include "gtest/gtest.h"
+#include <filesystem>
+#include <future>
+#include <vector>
+
+static const std::string inputFile = std::string(FMI_REFERENCE_DIR) + "Stair.fmu";
+
+using helicsfmi::CoSimFederate;
+
+/** the counter of the stair FMU is a discrete output incremented by a time event every second,
+the FMU has no inputs and declares no event indicators*/
+TEST(Stair, timeEvents)
+{
+    helics::FederateInfo fedInfo(helics::CoreType::INPROC);
+    fedInfo.coreInitString = "--autobroker";
+    fedInfo.brokerInitString = "-f2";
+    EXPECT_TRUE(std::filesystem::exists(inputFile));
+    std::shared_ptr<CoSimFederate> csFed;
+    EXPECT_NO_THROW(csFed = std::make_shared<CoSimFederate>("stair", inputFile, fedInfo));
+    csFed->setOutputs({"counter"});
+
+    fedInfo.coreInitString.clear();
+    helics::ValueFederate vFed("fed1", fedInfo);
+    csFed->configure(0.1, 0.0);
+
+    auto result = std::async(std::launch::async, [csFed]() { csFed->run(3.0); });
+
+    auto& sub = vFed.registerSubscription("stair.counter");
+    vFed.setProperty(HELICS_PROPERTY_TIME_PERIOD, 0.1);
+    vFed.enterExecutingMode();
+    std::vector<int> values;
+    int updates{0};
+    for (int step = 1; step <= 30; ++step) {
+        vFed.requestTime(0.1 * step);
+        if (sub.isUpdated()) {
+            ++updates;
+        }
+        values.push_back(sub.getValue<int>());
+    }
+    vFed.finalize();
+    result.get();
+    // the counter follows the time events although no input or parameter changed
+    EXPECT_EQ(values[4] + 1, values[14]);
+    EXPECT_EQ(values[14] + 1, values[24]);
+    // unchanged values are not published again
+    EXPECT_LT(updates, 10);
+    EXPECT_GT(csFed->getOutputStatistics().suppressed, 0U);
+}
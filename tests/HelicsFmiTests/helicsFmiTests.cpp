@@ -6,8 +6,394 @@ All rights reserved. SPDX-License-Identifier: BSD-3-Clause
 */
 
 #include "FmiCoSimFederate.hpp"
+#include "FmiHelics.hpp"
+#include "FmiRecorder.hpp"
 #include "helics/application_api/queryFunctions.hpp"
+#include "utilities/columnCapture.h"
+#include "utilities/frameRing.h"
+#include "utilities/realTimePacer.h"
+#include "utilities/valuePredictor.hpp"
+#include "utilities/workStealingPool.h"
 
 #include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
 #include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(outputFilter, inactive)
+{
+    helicsfmi::OutputFilter filter;
+    EXPECT_FALSE(filter.isActive());
+    EXPECT_TRUE(filter.update(1.0));
+    EXPECT_TRUE(filter.update(1.0));
+}
+
+TEST(outputFilter, absolute)
+{
+    helicsfmi::OutputFilter filter(0.1, 0.0);
+    EXPECT_TRUE(filter.isActive());
+    EXPECT_TRUE(filter.update(1.0));
+    EXPECT_FALSE(filter.update(1.05));
+    EXPECT_FALSE(filter.update(0.95));
+    EXPECT_TRUE(filter.update(1.15));
+    // the reference value moves to the last published value
+    EXPECT_FALSE(filter.update(1.2));
+    filter.reset();
+    EXPECT_TRUE(filter.update(1.2));
+}
+
+TEST(outputFilter, relative)
+{
+    helicsfmi::OutputFilter filter(0.0, 0.01, 10.0);
+    EXPECT_TRUE(filter.update(1000.0));
+    EXPECT_FALSE(filter.update(1005.0));
+    EXPECT_TRUE(filter.update(1011.0));
+    // small values are scaled by the nominal value
+    EXPECT_TRUE(filter.update(0.0));
+    EXPECT_FALSE(filter.update(0.05));
+    EXPECT_TRUE(filter.update(0.15));
+}
+
+TEST(stepController, grow)
+{
+    helicsfmi::StepController control(0.1, 1.0, 1e-3);
+    // linear signals have no error so the step grows up to the limit
+    double step = control.update({0.0}, 0.1);
+    EXPECT_DOUBLE_EQ(step, 0.1);
+    step = control.update({step}, step);
+    EXPECT_DOUBLE_EQ(step, 0.1);
+    double value{0.2};
+    for (int ii = 0; ii < 5; ++ii) {
+        step = control.update({value}, 0.1);
+        value += 0.1;
+    }
+    EXPECT_DOUBLE_EQ(step, 0.2);
+    EXPECT_DOUBLE_EQ(control.getError(), 0.0);
+}
+
+TEST(stepController, shrink)
+{
+    helicsfmi::StepController control(0.01, 1.0, 1e-3);
+    control.update({1.0}, 0.5);
+    control.update({1.0}, 0.5);
+    // a sudden change in slope shrinks the step
+    const double step = control.update({2.0}, 0.5);
+    EXPECT_GT(control.getError(), 1e-3);
+    EXPECT_LT(step, 0.5);
+    EXPECT_GE(step, 0.1);
+}
+
+TEST(columnCapture, formats)
+{
+    for (const std::string file : {"capture.csv", "capture.hcap", "capture.hcapz"}) {
+        {
+            utilities::ColumnCapture capture(
+                file, {"a", "b"}, utilities::getCaptureFormat(file), 16);
+            for (int ii = 0; ii < 100; ++ii) {
+                const double values[2] = {ii * 0.5, -ii * 2.0};
+                capture.addRow(ii * 0.1, values);
+            }
+            EXPECT_EQ(capture.rowCount(), 100U);
+        }
+        const utilities::ColumnCaptureReader reader(file);
+        ASSERT_EQ(reader.columnCount(), 3U);
+        EXPECT_EQ(reader.getNames()[1], "a");
+        ASSERT_EQ(reader.rowCount(), 100U);
+        EXPECT_DOUBLE_EQ(reader.getColumn(0)[99], 9.9);
+        EXPECT_DOUBLE_EQ(reader.getColumn(1)[37], 18.5);
+        EXPECT_DOUBLE_EQ(reader.getColumn(2)[64], -128.0);
+        std::filesystem::remove(file);
+    }
+}
+
+TEST(columnCapture, writeFailure)
+{
+    if (!std::filesystem::exists("/dev/full")) {
+        GTEST_SKIP() << "no device to simulate a full disk";
+    }
+    utilities::ColumnCapture capture("/dev/full", {"a"}, utilities::CaptureFormat::binary, 16);
+    for (int ii = 0; ii < 100; ++ii) {
+        const double value = ii;
+        capture.addRow(ii * 0.1, &value);
+    }
+    EXPECT_THROW(capture.close(), std::runtime_error);
+}
+
+TEST(workStealingPool, parallelFor)
+{
+    utilities::WorkStealingPool pool(3);
+    EXPECT_EQ(pool.threadCount(), 4U);
+    std::vector<int> values(1000, 0);
+    for (int pass = 1; pass <= 10; ++pass) {
+        pool.parallelFor(values.size(), [&values](std::size_t index) { ++values[index]; });
+    }
+    for (auto value : values) {
+        EXPECT_EQ(value, 10);
+    }
+    std::atomic<int> count{0};
+    EXPECT_THROW(pool.parallelFor(50,
+                                  [&count](std::size_t index) {
+                                      ++count;
+                                      if (index == 17) {
+                                          throw(std::runtime_error("task failure"));
+                                      }
+                                  }),
+                 std::runtime_error);
+    // every task still runs after a failure
+    EXPECT_EQ(count.load(), 50);
+}
+
+TEST(realTimePacer, pacing)
+{
+    using std::chrono::milliseconds;
+    utilities::RealTimePacer pacer(1.0);
+    const auto start = utilities::RealTimePacer::clock::now();
+    pacer.start(0.0);
+    for (int step = 1; step <= 3; ++step) {
+        pacer.startStep();
+        pacer.pace(0.02 * step);
+    }
+    EXPECT_GE(utilities::RealTimePacer::clock::now() - start, milliseconds(60));
+    // a step that takes longer than its budget is an overrun and the next step catches up
+    pacer.startStep();
+    std::this_thread::sleep_for(milliseconds(80));
+    pacer.pace(0.08);
+    pacer.startStep();
+    pacer.pace(0.2);
+    const auto& stats = pacer.getStatistics();
+    EXPECT_EQ(stats.steps, 5U);
+    // a loaded machine can overrun the short budgets of the other steps as well
+    EXPECT_GE(stats.overruns, 1U);
+    EXPECT_GE(stats.histogram.back(), 1U);
+    EXPECT_GE(stats.maxCompute, 0.08);
+    EXPECT_GE(stats.maxLateness, 0.0);
+}
+
+TEST(frameRing, producerConsumer)
+{
+    utilities::FrameRing ring(3, 2);
+    EXPECT_EQ(ring.capacity(), 3U);
+    EXPECT_EQ(ring.frameSize(), 2U);
+    std::thread producer([&ring]() {
+        for (int frame = 1; frame <= 20; ++frame) {
+            double* values = ring.beginWrite();
+            if (values == nullptr) {
+                return;
+            }
+            values[0] = frame;
+            values[1] = -frame;
+            ring.endWrite(0.5 * frame);
+        }
+        ring.finish();
+    });
+    double time{0.0};
+    int count{0};
+    while (const double* values = ring.beginRead(time)) {
+        ++count;
+        EXPECT_DOUBLE_EQ(values[0], count);
+        EXPECT_DOUBLE_EQ(values[1], -count);
+        EXPECT_DOUBLE_EQ(time, 0.5 * count);
+        ring.endRead();
+    }
+    producer.join();
+    EXPECT_EQ(count, 20);
+}
+
+TEST(frameRing, close)
+{
+    utilities::FrameRing ring(2, 1);
+    // the producer blocks on the full ring until it is closed
+    std::thread producer([&ring]() {
+        while (double* values = ring.beginWrite()) {
+            values[0] = 1.0;
+            ring.endWrite(1.0);
+        }
+    });
+    double time{0.0};
+    ASSERT_NE(ring.beginRead(time), nullptr);
+    ring.endRead();
+    ring.close();
+    producer.join();
+    EXPECT_EQ(ring.beginRead(time), nullptr);
+}
+
+TEST(valuePredictor, linear)
+{
+    utilities::valuePredictor<double> predictor(0.0, 1.0);
+    EXPECT_DOUBLE_EQ(predictor.predict(5.0), 1.0);
+    predictor.update(1.0, 3.0);
+    EXPECT_DOUBLE_EQ(predictor.getSlope(), 2.0);
+    EXPECT_DOUBLE_EQ(predictor.predict(1.5), 4.0);
+}
+
+TEST(valuePredictor, quadratic)
+{
+    // points on 1+2t+t^2
+    utilities::quadraticPredictor<double> predictor(0.0, 1.0);
+    predictor.update(1.0, 4.0);
+    EXPECT_DOUBLE_EQ(predictor.getCurvature(), 0.0);
+    EXPECT_DOUBLE_EQ(predictor.predict(2.0), 7.0);
+    predictor.update(2.0, 9.0);
+    EXPECT_DOUBLE_EQ(predictor.getCurvature(), 1.0);
+    EXPECT_DOUBLE_EQ(predictor.getSlope(), 6.0);
+    EXPECT_DOUBLE_EQ(predictor.predict(3.0), 16.0);
+    EXPECT_DOUBLE_EQ(predictor.predict(2.5), 12.25);
+    // an update at the same time replaces the value without changing the rates
+    predictor.update(2.0, 10.0);
+    EXPECT_DOUBLE_EQ(predictor.predict(3.0), 17.0);
+}
+
+TEST(variablePatterns, expand)
+{
+    const std::vector<std::string> candidates{"a.x", "a.y", "b.x", "b.y[1]", "b.y[2]", "c"};
+    EXPECT_TRUE(helicsfmi::isVariablePattern("a.*"));
+    EXPECT_TRUE(helicsfmi::isVariablePattern("regex:a"));
+    EXPECT_FALSE(helicsfmi::isVariablePattern("b.y[1]"));
+
+    auto names = helicsfmi::expandVariablePatterns({"c", "?.x", "b.y*"}, candidates);
+    EXPECT_EQ(names, (std::vector<std::string>{"c", "a.x", "b.x", "b.y[1]", "b.y[2]"}));
+    // a variable selected by several patterns is only included once
+    names = helicsfmi::expandVariablePatterns({"regex:a\\..", "*.x", "missing"}, candidates);
+    EXPECT_EQ(names, (std::vector<std::string>{"a.x", "a.y", "b.x", "missing"}));
+    EXPECT_THROW(helicsfmi::expandVariablePatterns({"regex:(a"}, candidates), helicsfmi::Error);
+}
+
+TEST(outputDependencies, emptyDependencies)
+{
+    {
+        std::ofstream description("generatorDescription.xml");
+        description << R"(<?xml version="1.0" encoding="UTF-8"?>
+<fmiModelDescription fmiVersion="2.0" modelName="generator" guid="{generator}">
+  <CoSimulation modelIdentifier="generator"/>
+  <ModelVariables>
+    <ScalarVariable name="amplitude" valueReference="1" causality="parameter" variability="tunable">
+      <Real start="1"/>
+    </ScalarVariable>
+    <ScalarVariable name="u" valueReference="2" causality="input" variability="continuous">
+      <Real start="0"/>
+    </ScalarVariable>
+    <ScalarVariable name="wave" valueReference="3" causality="output" variability="continuous">
+      <Real/>
+    </ScalarVariable>
+    <ScalarVariable name="scaled" valueReference="4" causality="output" variability="continuous">
+      <Real/>
+    </ScalarVariable>
+    <ScalarVariable name="echo" valueReference="5" causality="output" variability="continuous">
+      <Real/>
+    </ScalarVariable>
+  </ModelVariables>
+  <ModelStructure>
+    <Outputs>
+      <Unknown index="3" dependencies=""/>
+      <Unknown index="4" dependencies="1"/>
+      <Unknown index="5" dependencies="2"/>
+    </Outputs>
+  </ModelStructure>
+</fmiModelDescription>
+)";
+    }
+    const FmiInfo info("generatorDescription.xml");
+    std::filesystem::remove("generatorDescription.xml");
+    const std::vector<int> inputs{info.getVariableInfo("u").index};
+    const std::vector<int> outputs{info.getVariableInfo("wave").index,
+                                   info.getVariableInfo("scaled").index,
+                                   info.getVariableInfo("echo").index};
+    helicsfmi::OutputDependencies deps;
+    deps.build(info, inputs, outputs);
+    // a generator of a function of time declares no dependencies but changes every step
+    EXPECT_EQ(deps.getUpdate(0), helicsfmi::OutputUpdate::continuous);
+    EXPECT_EQ(deps.getUpdate(1), helicsfmi::OutputUpdate::tunable);
+    EXPECT_EQ(deps.getUpdate(2), helicsfmi::OutputUpdate::continuous);
+    EXPECT_EQ(deps.staticCount(), 0U);
+    EXPECT_EQ(deps.getFeedthrough(0), (std::vector<std::size_t>{2}));
+}
+
+TEST(checkpointWriter, discardIncomplete)
+{
+    helicsfmi::CheckpointWriter writer("discard.hfcp", 1.0, 2);
+    EXPECT_DOUBLE_EQ(writer.nextTime(1.0), 2.0);
+    helicsfmi::FederateCheckpoint first;
+    first.name = "first";
+    helicsfmi::FederateCheckpoint second;
+    second.name = "second";
+    // the second federate misses the checkpoint at 1 so it is discarded when 2 completes
+    first.time = 1.0;
+    EXPECT_TRUE(writer.add(first));
+    first.time = 2.0;
+    EXPECT_TRUE(writer.add(first));
+    EXPECT_EQ(writer.getCount(), 0U);
+    second.time = 2.0;
+    EXPECT_TRUE(writer.add(second));
+    EXPECT_EQ(writer.getCount(), 1U);
+    EXPECT_EQ(writer.getDiscardedCount(), 1U);
+    EXPECT_DOUBLE_EQ(writer.getLastTime(), 2.0);
+    const auto points = helicsfmi::loadCheckpoint("discard.hfcp");
+    ASSERT_EQ(points.size(), 2U);
+    EXPECT_DOUBLE_EQ(points[1].time, 2.0);
+    std::filesystem::remove("discard.hfcp");
+}
+
+TEST(inputRecording, rollback)
+{
+    {
+        helicsfmi::InputRecorder recorder("rollback.hrec", 0.0, 1.0);
+        const auto input = recorder.variable("u");
+        recorder.value(0.0, input, 1.0);
+        recorder.step(0.0, 0.5);
+        recorder.value(0.5, input, 2.0);
+        recorder.savepoint(0.5);
+        recorder.value(0.5, input, 2.5);
+        recorder.step(0.5, 0.5);
+        // the repeated step replaces the value and the step recorded after the savepoint
+        recorder.rollback(0.5);
+        recorder.value(0.5, input, 3.0);
+        recorder.step(0.5, 0.5);
+        recorder.close();
+        EXPECT_EQ(recorder.getCount(), 9U);
+    }
+    const auto recording = helicsfmi::loadInputRecording("rollback.hrec");
+    std::filesystem::remove("rollback.hrec");
+    ASSERT_EQ(recording.names.size(), 1U);
+    ASSERT_EQ(recording.entries.size(), 5U);
+    EXPECT_EQ(recording.entries[2].kind, helicsfmi::RecordKind::value);
+    EXPECT_DOUBLE_EQ(recording.entries[2].value, 2.0);
+    EXPECT_EQ(recording.entries[3].kind, helicsfmi::RecordKind::value);
+    EXPECT_DOUBLE_EQ(recording.entries[3].value, 3.0);
+    EXPECT_EQ(recording.entries[4].kind, helicsfmi::RecordKind::step);
+    EXPECT_DOUBLE_EQ(recording.entries[4].time, 0.5);
+}
+
+TEST(unitConversion, linear)
+{
+    helicsfmi::UnitConversion conv;
+    EXPECT_TRUE(helicsfmi::getUnitConversion(units::unit_from_string("km"),
+                                             units::unit_from_string("m"),
+                                             conv));
+    EXPECT_DOUBLE_EQ(conv.factor, 1000.0);
+    EXPECT_DOUBLE_EQ(conv.offset, 0.0);
+}
+
+TEST(unitConversion, offset)
+{
+    helicsfmi::UnitConversion conv;
+    EXPECT_TRUE(helicsfmi::getUnitConversion(units::unit_from_string("degC"),
+                                             units::unit_from_string("K"),
+                                             conv));
+    EXPECT_NEAR(conv.factor, 1.0, 1e-12);
+    EXPECT_NEAR(conv.offset, 273.15, 1e-9);
+}
+
+TEST(unitConversion, incompatible)
+{
+    helicsfmi::UnitConversion conv;
+    EXPECT_FALSE(helicsfmi::getUnitConversion(units::unit_from_string("m"),
+                                              units::unit_from_string("s"),
+                                              conv));
+    EXPECT_DOUBLE_EQ(conv.factor, 1.0);
+    EXPECT_DOUBLE_EQ(conv.offset, 0.0);
+}